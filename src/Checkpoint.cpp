@@ -3,18 +3,34 @@
 #include "Checkpoint.hpp"
 #include "io/binary_io.hpp"
 #include "io/file_io.hpp"
+#include "Tracer.hpp"
+#include "EventLog.hpp"
 
 using namespace std;
 
 void CheckpointManager::write(const std::string& ckp_fname) const
 {
+  RAXML_TRACE_SPAN("checkpoint_write");
+
+  const double start_time = sysutil_gettime();
+
   backup();
 
-  BinaryFileStream fs(ckp_fname, std::ios::out);
+  {
+    BinaryFileStream fs(ckp_fname, std::ios::out);
 
-  fs << _checkp;
+    fs << _checkp;
+  }
 
   remove_backup();
+
+  if (EventLog::enabled())
+  {
+    EventLog::write(LogEvent("checkpoint")("file", ckp_fname)
+                    ("duration", sysutil_gettime() - start_time)
+                    ("ml_trees", _checkp.ml_trees.size())("bs_trees", _checkp.num_bs_trees()),
+                    true);
+  }
 }
 
 bool CheckpointManager::read(const std::string& ckp_fname)
@@ -74,7 +90,10 @@ void CheckpointManager::reset_search_state()
   ParallelContext::thread_barrier();
 
   if (ParallelContext::master_thread())
+  {
     _checkp.search_state = SearchState();
+    _search_written = false;
+  }
 
   ParallelContext::thread_barrier();
 };
@@ -84,8 +103,11 @@ void CheckpointManager::save_ml_tree()
   if (ParallelContext::master_thread())
   {
     _checkp.save_ml_tree();
-    if (_active)
+    append_tree(_ml_trees_writer.get(), _checkp.ml_trees_file);
+    if (_active && ParallelContext::master())
       write();
+    if (_active && ParallelContext::group_master())
+      _last_write_time = global_timer().elapsed_seconds();
   }
 }
 
@@ -93,15 +115,91 @@ void CheckpointManager::save_bs_tree()
 {
   if (ParallelContext::master_thread())
   {
-    _checkp.save_bs_tree();
-    if (_active)
+    append_tree(_bs_trees_writer.get(), _checkp.bs_trees_file);
+    if (_active && ParallelContext::master())
       write();
+    if (_active && ParallelContext::group_master())
+      _last_write_time = global_timer().elapsed_seconds();
+  }
+}
+
+void CheckpointManager::save_bs_tree(const TreeTopology& topol)
+{
+  assert(ParallelContext::master_thread());
+
+  _checkp.tree.topology(topol);
+  save_bs_tree();
+}
+
+void CheckpointManager::append_tree(TreeFileWriter * writer, TreeFileState& state)
+{
+  /* NB: tree must be on disk before the checkpoint which refers to it is written */
+  if (writer)
+  {
+    if (_prepare_tree_cb)
+    {
+      /* output tree is modified (e.g. re-rooted) -> work on a copy */
+      Tree tree = _checkp.tree;
+      _prepare_tree_cb(tree);
+      writer->append(tree, state);
+    }
+    else
+      writer->append(_checkp.tree, state);
   }
+  else
+    state.tree_count++;
+}
+
+void CheckpointManager::open_tree_files(const std::string& ml_trees_fname,
+                                        const std::string& bs_trees_fname,
+                                        TreeOutputCallback prepare_cb)
+{
+  /* only master process writes the output files */
+  if (!ParallelContext::master())
+    return;
+
+  _prepare_tree_cb = prepare_cb;
+
+  if (!ml_trees_fname.empty())
+    _ml_trees_writer.reset(new TreeFileWriter(ml_trees_fname, _checkp.ml_trees_file));
+
+  if (!bs_trees_fname.empty())
+    _bs_trees_writer.reset(new TreeFileWriter(bs_trees_fname, _checkp.bs_trees_file));
+}
+
+void CheckpointManager::close_tree_files()
+{
+  _ml_trees_writer.reset(nullptr);
+  _bs_trees_writer.reset(nullptr);
+}
+
+bool CheckpointManager::skip_write()
+{
+  if (ParallelContext::num_ranks() == 1)
+    return false;
+
+  /* collecting models from all ranks is expensive, so intermediate checkpoints are written
+   * at most every RAXML_CKP_MPI_INTERVAL seconds; decision is made by the master and shared
+   * with all ranks, since model collection is a collective operation */
+  bool skip = false;
+  if (ParallelContext::group_master())
+  {
+    /* NB: first write after the search (re)start is never skipped */
+    const auto step = _checkp.search_state.step;
+    skip = _search_written && step != CheckpointStep::finish &&
+        global_timer().elapsed_seconds() - _last_write_time < RAXML_CKP_MPI_INTERVAL;
+    if (!skip)
+      _search_written = true;
+  }
+
+  ParallelContext::broadcast(&skip, sizeof(bool));
+
+  return skip;
 }
 
 void CheckpointManager::update_and_write(const TreeInfo& treeinfo)
 {
-  if (!_active)
+  if (!_active || skip_write())
     return;
 
   if (ParallelContext::master_thread())
@@ -131,18 +229,61 @@ void CheckpointManager::update_and_write(const TreeInfo& treeinfo)
     assign_tree(_checkp, treeinfo);
     write();
   }
+
+  /* NB: must be the same thread which decides in skip_write() */
+  if (ParallelContext::group_master())
+    _last_write_time = global_timer().elapsed_seconds();
 }
 
 void CheckpointManager::gather_model_params()
 {
+  /* this is a collective operation between ranks: master threads only */
+  if (!ParallelContext::master_thread())
+    return;
+
+  /* worker ranks: only send models which have changed since the last time */
+  IDVector changed_models;
+  if (!ParallelContext::master_rank())
+  {
+    for (auto p: _updated_models)
+    {
+      const auto& model = _checkp.models.at(p);
+      size_t model_size = 0;
+      for (;;)
+      {
+        try
+        {
+          BinaryStream bs(_model_buf.data(), _model_buf.size());
+          bs << model;
+          model_size = bs.pos();
+          break;
+        }
+        catch (out_of_range&)
+        {
+          _model_buf.resize(std::max<size_t>(4096, 2 * _model_buf.size()));
+        }
+      }
+
+      auto& sent_model = _sent_models[p];
+      if (sent_model.size() != model_size ||
+          !std::equal(sent_model.cbegin(), sent_model.cend(), _model_buf.cbegin()))
+      {
+        sent_model.assign(_model_buf.cbegin(), _model_buf.cbegin() + model_size);
+        changed_models.push_back(p);
+      }
+    }
+  }
+
   /* send callback -> worker ranks */
-  auto worker_cb = [this](void * buf, size_t buf_size) -> int
+  auto worker_cb = [this,&changed_models](void * buf, size_t buf_size) -> int
       {
         BinaryStream bs((char*) buf, buf_size);
-        bs << _updated_models.size();
-        for (auto p: _updated_models)
+        bs << changed_models.size();
+        for (auto p: changed_models)
         {
-          bs << p << _checkp.models.at(p);
+          const auto& sent_model = _sent_models.at(p);
+          bs << p;
+          bs.put(sent_model.data(), sent_model.size());
         }
         return (int) bs.pos();
       };
@@ -165,9 +306,50 @@ void CheckpointManager::gather_model_params()
   ParallelContext::mpi_gather_custom(worker_cb, master_cb);
 }
 
+CheckpointDataInfo::CheckpointDataInfo(const PartitionedMSA& parted_msa) :
+    taxon_count(parted_msa.taxon_count()), part_count(parted_msa.part_count()), hash(0)
+{
+  /* FNV-1a, to be stable across platforms and builds */
+  uint64_t h = 14695981039346656037ULL;
+  auto update = [&h](const void * data, size_t size)
+      {
+        auto bytes = (const unsigned char *) data;
+        for (size_t i = 0; i < size; ++i)
+        {
+          h ^= bytes[i];
+          h *= 1099511628211ULL;
+        }
+      };
+
+  for (const auto& taxon: parted_msa.taxon_names())
+    update(taxon.c_str(), taxon.size() + 1);
+
+  for (const auto& pinfo: parted_msa.part_list())
+  {
+    /* NB: number of sites does not depend on pattern compression */
+    const uint64_t sites = pinfo.msa().num_sites();
+    const uint64_t states = pinfo.model().num_states();
+    update(pinfo.name().c_str(), pinfo.name().size() + 1);
+    update(&sites, sizeof(sites));
+    update(&states, sizeof(states));
+  }
+
+  hash = h;
+}
+
+static void throw_mismatch(const CheckpointDataInfo& found)
+{
+  throw CheckpointMismatchException("Checkpoint file was created for a different alignment "
+      "or partitioning (taxa: " + to_string(found.taxon_count) + ", partitions: " +
+      to_string(found.part_count) + ").\nPlease use --redo option to start a new analysis.");
+}
+
 BasicBinaryStream& operator<<(BasicBinaryStream& stream, const Checkpoint& ckp)
 {
-  stream << ckp.version;
+  /* NB: always write in the current format, also if checkpoint was read from an older one */
+  stream << CKP_VERSION;
+
+  stream << ckp.data_info.taxon_count << ckp.data_info.part_count << ckp.data_info.hash;
 
   // NB: accumulated runtime from past runs + current elapsed time
   stream << ckp.elapsed_seconds + global_timer().elapsed_seconds();
@@ -182,7 +364,7 @@ BasicBinaryStream& operator<<(BasicBinaryStream& stream, const Checkpoint& ckp)
 
   stream << ckp.ml_trees;
 
-  stream << ckp.bs_trees;
+  stream << ckp.ml_trees_file << ckp.bs_trees_file;
 
   return stream;
 }
@@ -196,6 +378,15 @@ BasicBinaryStream& operator>>(BasicBinaryStream& stream, Checkpoint& ckp)
     throw runtime_error("Unsupported checkpoint file version!");
   }
 
+  if (ckp.version >= 4)
+  {
+    CheckpointDataInfo data_info;
+    stream >> data_info.taxon_count >> data_info.part_count >> data_info.hash;
+    if (!ckp.data_info.empty() && ckp.data_info != data_info)
+      throw_mismatch(data_info);
+    ckp.data_info = data_info;
+  }
+
   stream >> ckp.elapsed_seconds;
 
   stream >> ckp.search_state;
@@ -208,7 +399,12 @@ BasicBinaryStream& operator>>(BasicBinaryStream& stream, Checkpoint& ckp)
 
   size_t num_models, part_id;
   stream >> num_models;
-  assert(num_models == ckp.models.size());
+  if (num_models != ckp.models.size())
+  {
+    CheckpointDataInfo data_info = ckp.data_info;
+    data_info.part_count = num_models;
+    throw_mismatch(data_info);
+  }
   for (size_t m = 0; m < num_models; ++m)
   {
     stream >> part_id;
@@ -217,11 +413,50 @@ BasicBinaryStream& operator>>(BasicBinaryStream& stream, Checkpoint& ckp)
 
   stream >> ckp.ml_trees;
 
-  stream >> ckp.bs_trees;
+  stream >> ckp.ml_trees_file >> ckp.bs_trees_file;
 
   return stream;
 }
 
+static std::ios_base::openmode tree_file_mode(const std::string& fname,
+                                              const TreeFileState& state)
+{
+  if (state.fpos > 0)
+  {
+    /* resuming: discard incomplete output written after the last checkpoint */
+    if (!sysutil_file_exists(fname) || sysutil_file_size(fname) < state.fpos)
+    {
+      throw runtime_error("Tree file is missing or shorter than recorded in the checkpoint: " +
+                          fname);
+    }
+
+    sysutil_truncate_file(fname, state.fpos);
+
+    return std::ios::out | std::ios::app;
+  }
+  else
+    return std::ios::out | std::ios::trunc;
+}
+
+TreeFileWriter::TreeFileWriter(const std::string& fname, const TreeFileState& state) :
+    _fname(fname), _stream(fname, tree_file_mode(fname, state))
+{
+  if (!_stream)
+    throw runtime_error("Cannot open file for writing: " + fname);
+}
+
+void TreeFileWriter::append(const Tree& tree, TreeFileState& state)
+{
+  /* NB: NewickStream flushes after every tree */
+  _stream << tree;
+
+  if (!_stream)
+    throw runtime_error("Error writing to file: " + _fname);
+
+  state.fpos = _stream.tellp();
+  state.tree_count++;
+}
+
 void assign_tree(Checkpoint& ckp, const TreeInfo& treeinfo)
 {
   ckp.tree = treeinfo.tree();
@@ -1,12 +1,15 @@
 #ifndef RAXML_CHECKPOINT_HPP_
 #define RAXML_CHECKPOINT_HPP_
 
+#include <functional>
+
 #include "common.h"
 #include "TreeInfo.hpp"
 #include "io/binary_io.hpp"
+#include "io/file_io.hpp"
 
-constexpr int CKP_VERSION = 1;
-constexpr int CKP_MIN_SUPPORTED_VERSION = 1;
+constexpr int CKP_VERSION = 4;
+constexpr int CKP_MIN_SUPPORTED_VERSION = 3;
 
 enum class CheckpointStep
 {
@@ -34,9 +37,47 @@ struct SearchState
   int fast_spr_radius;
 };
 
+/* number of trees committed to a streamed output file, and file size right after the last one */
+struct TreeFileState
+{
+  TreeFileState() : tree_count(0), fpos(0) {}
+
+  size_t tree_count;
+  size_t fpos;
+};
+
+/* Identifies the input data a checkpoint belongs to (taxa, partitions, site counts and data
+ * types). NB: parallel setup (#threads, #ranks, site distribution) is deliberately not part of
+ * it, such that a run can be resumed with a different one */
+struct CheckpointDataInfo
+{
+  CheckpointDataInfo() : taxon_count(0), part_count(0), hash(0) {}
+  CheckpointDataInfo(const PartitionedMSA& parted_msa);
+
+  bool empty() const { return taxon_count == 0; }
+
+  bool operator==(const CheckpointDataInfo& other) const
+  {
+    return taxon_count == other.taxon_count && part_count == other.part_count &&
+        hash == other.hash;
+  }
+  bool operator!=(const CheckpointDataInfo& other) const { return !(*this == other); }
+
+  size_t taxon_count;
+  size_t part_count;
+  uint64_t hash;
+};
+
+class CheckpointMismatchException : public RaxmlException
+{
+public:
+  CheckpointMismatchException(const std::string& message) : RaxmlException(message) {}
+};
+
 struct Checkpoint
 {
-  Checkpoint() : version(CKP_VERSION), elapsed_seconds(0.), search_state(), tree(), models() {}
+  Checkpoint() : version(CKP_VERSION), data_info(), elapsed_seconds(0.), search_state(), tree(),
+    models(), ml_trees(), ml_trees_file(), bs_trees_file() {}
 
   Checkpoint(const Checkpoint&) = delete;
   Checkpoint& operator=(const Checkpoint&) = delete;
@@ -45,6 +86,8 @@ struct Checkpoint
 
   int version;
 
+  CheckpointDataInfo data_info;
+
   double elapsed_seconds;
 
   SearchState search_state;
@@ -53,18 +96,41 @@ struct Checkpoint
   std::unordered_map<size_t, Model> models;
 
   TreeCollection ml_trees;
-  TreeCollection bs_trees;
+
+  /* bootstrap trees are not kept in memory, they are streamed to the output file instead */
+  TreeFileState ml_trees_file;
+  TreeFileState bs_trees_file;
 
   double loglh() const { return search_state.loglh; }
+  size_t num_bs_trees() const { return bs_trees_file.tree_count; }
 
   void save_ml_tree() { ml_trees.push_back(loglh(), tree); }
-  void save_bs_tree() { bs_trees.push_back(loglh(), tree); }
+};
+
+typedef std::function<void(Tree&)> TreeOutputCallback;
+
+/* Newick file which grows by one tree at a time. Its content is only valid up to the position
+ * recorded in the checkpoint: trees appended after the last checkpoint write are truncated
+ * on resume, and the respective searches are then repeated */
+class TreeFileWriter
+{
+public:
+  TreeFileWriter(const std::string& fname, const TreeFileState& state);
+
+  const std::string& fname() const { return _fname; }
+
+  void append(const Tree& tree, TreeFileState& state);
+
+private:
+  std::string _fname;
+  NewickStream _stream;
 };
 
 class CheckpointManager
 {
 public:
-  CheckpointManager(const std::string& ckp_fname) : _active(true), _ckp_fname(ckp_fname) {}
+  CheckpointManager(const std::string& ckp_fname) : _active(true), _ckp_fname(ckp_fname),
+    _last_write_time(0.), _search_written(false) {}
 
   const Checkpoint& checkpoint() { return _checkp; }
   void checkpoint(Checkpoint&& ckp) { _checkp = std::move(ckp); }
@@ -80,6 +146,13 @@ public:
 
   void save_ml_tree();
   void save_bs_tree();
+  /* bootstrap tree inferred elsewhere (MPI farm mode): set as current tree and save */
+  void save_bs_tree(const TreeTopology& topol);
+
+  /* start streaming ML/bootstrap trees to the respective files (empty name = do not save) */
+  void open_tree_files(const std::string& ml_trees_fname, const std::string& bs_trees_fname,
+                       TreeOutputCallback prepare_cb = nullptr);
+  void close_tree_files();
 
   bool read() { return read(_ckp_fname); }
   bool read(const std::string& ckp_fname);
@@ -95,9 +168,20 @@ private:
   std::string _ckp_fname;
   Checkpoint _checkp;
   IDSet _updated_models;
+  /* model parameters (serialized) as last sent to the master rank */
+  std::unordered_map<size_t, std::vector<char>> _sent_models;
+  std::vector<char> _model_buf;
+  double _last_write_time;
+  /* checkpoint was written since the current search has been started */
+  bool _search_written;
   SearchState _empty_search_state;
+  std::unique_ptr<TreeFileWriter> _ml_trees_writer;
+  std::unique_ptr<TreeFileWriter> _bs_trees_writer;
+  TreeOutputCallback _prepare_tree_cb;
 
+  bool skip_write();
   void gather_model_params();
+  void append_tree(TreeFileWriter * writer, TreeFileState& state);
   std::string backup_fname() const { return _ckp_fname + ".bk"; }
 };
 
@@ -1,5 +1,6 @@
 #include "CommandLineParser.hpp"
 
+#include <cctype>
 #include <getopt.h>
 
 #ifdef _RAXML_PTHREADS
@@ -67,6 +68,15 @@ static struct option long_options[] =
   {"bsconverge",         no_argument,       0, 0 },  /*  45 */
   {"extra",              required_argument, 0, 0 },  /*  46 */
   {"bs-metric",          required_argument, 0, 0 },  /*  47 */
+  {"rfdist",             no_argument,       0, 0 },  /*  48 */
+  {"bs-farm",            required_argument, 0, 0 },  /*  49 */
+  {"trace",              no_argument,       0, 0 },  /*  50 */
+  {"bench",              no_argument,       0, 0 },  /*  51 */
+  {"bench-data",         required_argument, 0, 0 },  /*  52 */
+  {"stats",              no_argument,       0, 0 },  /*  53 */
+  {"events",             no_argument,       0, 0 },  /*  54 */
+  {"mem-limit",          required_argument, 0, 0 },  /*  55 */
+  {"prob-digits",        required_argument, 0, 0 },  /*  56 */
 
   { 0, 0, 0, 0 }
 };
@@ -104,7 +114,7 @@ void CommandLineParser::check_options(Options &opts)
   }
 
   if (opts.command == Command::evaluate || opts.command == Command::support ||
-      opts.command == Command::terrace)
+      opts.command == Command::terrace || opts.command == Command::rfdist)
   {
     if (opts.tree_file.empty())
       throw OptionException("Please provide a valid Newick file as an argument of --tree option.");
@@ -142,6 +152,25 @@ void CommandLineParser::check_options(Options &opts)
       opts.outfile_prefix = opts.outfile_names.bootstrap_trees;
   }
 
+  if (opts.command == Command::rfdist)
+  {
+    assert(!opts.tree_file.empty());
+
+    if (opts.outfile_prefix.empty())
+      opts.outfile_prefix = opts.tree_file;
+  }
+
+  if (opts.trace_mode && opts.command != Command::search && opts.command != Command::all &&
+      opts.command != Command::bootstrap)
+  {
+    throw OptionException("Execution trace (--trace) is only supported for "
+                          "--search, --bootstrap and --all commands.");
+  }
+
+  /* benchmark on synthetic data: nothing to name the output files after */
+  if (opts.command == Command::bench && opts.msa_file.empty() && opts.outfile_prefix.empty())
+    opts.nofiles_mode = true;
+
   if (opts.simd_arch > sysutil_simd_autodetect())
   {
     if (opts.force_mode)
@@ -209,6 +238,7 @@ void CommandLineParser::parse_options(int argc, char** argv, Options &opts)
 
   /* use probabilistic MSA _if available_ (e.g. CATG file was provided) */
   opts.use_prob_msa = true;
+  opts.prob_msa_digits = 0;
 
   /* optimize model and branch lengths */
   opts.optimize_model = true;
@@ -255,12 +285,20 @@ void CommandLineParser::parse_options(int argc, char** argv, Options &opts)
   // autodetect CPU instruction set and use respective SIMD kernels
   opts.simd_arch = sysutil_simd_autodetect();
   opts.load_balance_method = LoadBalancing::benoit;
+  opts.bs_farm_ranks = 0;
+  opts.mem_limit = 0;
+  opts.bench_taxa = RAXML_BENCH_TAXA;
+  opts.bench_sites = RAXML_BENCH_SITES;
+  opts.bench_states = RAXML_BENCH_STATES;
 
   opts.num_searches = 0;
 
   opts.redo_mode = false;
   opts.force_mode = false;
   opts.nofiles_mode = false;
+  opts.trace_mode = false;
+  opts.stats_mode = false;
+  opts.events_mode = false;
 
   bool log_level_set = false;
 
@@ -374,7 +412,6 @@ void CommandLineParser::parse_options(int argc, char** argv, Options &opts)
         if (!optarg || (strcasecmp(optarg, "off") != 0))
         {
           opts.use_prob_msa = true;
-          opts.use_pattern_compression = false;
           opts.use_tip_inner = false;
           opts.use_repeats = false;
         }
@@ -712,6 +749,90 @@ void CommandLineParser::parse_options(int argc, char** argv, Options &opts)
         }
         break;
 
+      case 48: /* RF distance */
+        opts.command = Command::rfdist;
+        num_commands++;
+        break;
+
+      case 49: /* MPI bootstrap farm: number of ranks per worker group */
+#ifdef _RAXML_MPI
+        if (sscanf(optarg, "%u", &opts.bs_farm_ranks) != 1 || opts.bs_farm_ranks == 0)
+        {
+          throw InvalidOptionValueException("Invalid number of ranks per bootstrap group: " +
+                                            string(optarg) + ", please provide a positive integer!");
+        }
+#else
+        throw  OptionException("Unsupported option: --bs-farm.\n"
+            "Please build RAxML-NG with MPI support.");
+#endif
+        break;
+
+      case 50: /* execution trace */
+        opts.trace_mode = true;
+        break;
+
+      case 51: /* likelihood kernel benchmark */
+        opts.command = Command::bench;
+        num_commands++;
+        break;
+
+      case 52: /* synthetic dataset for benchmark: taxa,sites,states */
+        if (sscanf(optarg, "%u,%u,%u", &opts.bench_taxa, &opts.bench_sites,
+                   &opts.bench_states) != 3 ||
+            opts.bench_taxa < 4 || opts.bench_sites == 0 ||
+            opts.bench_states < 2 || opts.bench_states > 32)
+        {
+          throw InvalidOptionValueException("Invalid benchmark dataset: " + string(optarg) +
+                                            ", please use TAXA,SITES,STATES format (e.g. 50,10000,4)"
+                                            " with TAXA >= 4 and 2 <= STATES <= 32");
+        }
+        break;
+
+      case 53: /* hot-path statistics */
+        opts.stats_mode = true;
+        break;
+
+      case 54: /* structured event log */
+        opts.events_mode = true;
+        break;
+
+      case 55: /* memory limit */
+      {
+        double value;
+        char unit = 'M';
+        const int n = sscanf(optarg, "%lf%c", &value, &unit);
+        size_t multiplier = 0;
+        switch (toupper(unit))
+        {
+          case 'K':
+            multiplier = 1024;
+            break;
+          case 'M':
+            multiplier = 1024 * 1024;
+            break;
+          case 'G':
+            multiplier = 1024 * 1024 * 1024;
+            break;
+        }
+        if (n < 1 || value <= 0. || !multiplier)
+        {
+          throw InvalidOptionValueException("Invalid memory limit: " + string(optarg) +
+                                            ", please provide a positive number followed by "
+                                            "K, M or G (e.g. 16G)");
+        }
+        opts.mem_limit = (size_t) (value * multiplier);
+        break;
+      }
+
+      case 56: /* round state probabilities to improve pattern compression */
+        if (sscanf(optarg, "%u", &opts.prob_msa_digits) != 1 || opts.prob_msa_digits == 0 ||
+            opts.prob_msa_digits > 15)
+        {
+          throw InvalidOptionValueException("Invalid number of decimal places: " + string(optarg) +
+                                            ", please provide an integer between 1 and 15");
+        }
+        break;
+
       default:
         throw  OptionException("Internal error in option parsing");
     }
@@ -766,12 +887,14 @@ void CommandLineParser::print_help()
             "  --parse                                    parse alignment, compress patterns and create binary MSA file\n"
             "  --start                                    generate parsimony/random starting trees and exit\n"
             "  --loglh                                    compute the likelihood of a fixed tree (no model/brlen optimization)\n"
+            "  --rfdist                                   compute pairwise RF distances between the trees in --tree file\n"
+            "  --bench                                    benchmark likelihood kernels on --msa or synthetic data (see --bench-data)\n"
             "\n"
             "Input and output options:\n"
             "  --tree         FILE | rand{N} | pars{N}    starting tree: rand(om), pars(imony) or user-specified (newick file)\n"
             "                                             N = number of trees (default: 20 in 'all-in-one' mode, 1 otherwise)\n"
             "  --msa             FILE                     alignment file\n"
-            "  --msa-format      VALUE                    alignment file format: FASTA, PHYLIP, CATG or AUTO-detect (default)\n"
+            "  --msa-format      VALUE                    alignment file format: FASTA, PHYLIP, CATG, VCF or AUTO-detect (default)\n"
             "  --data-type       VALUE                    data type: DNA, AA, BIN(ary) or AUTO-detect (default)\n"
             "  --tree-constraint FILE                     constraint tree\n"
             "  --prefix          STRING                   prefix for output files (default: MSA file name)\n"
@@ -780,6 +903,7 @@ void CommandLineParser::print_help()
             "  --nofiles                                  do not create any output files, print results to the terminal only\n"
             "  --precision       VALUE                    number of decimal places to print (default: 6)\n"
             "  --outgroup        o1,o2,..,oN              comma-separated list of outgroup taxon names (it's just a drawing option!)\n"
+            "  --bench-data      TAXA,SITES,STATES        synthetic alignment for --bench (default: 50,10000,4)\n"
             "\n"
             "General options:\n"
             "  --seed         VALUE                       seed for pseudo-random number generator (default: current time)\n"
@@ -789,7 +913,13 @@ void CommandLineParser::print_help()
             "  --threads      VALUE                       number of parallel threads to use (default: 2).\n"
             "  --simd         none | sse3 | avx | avx2    vector instruction set to use (default: auto-detect).\n"
             "  --rate-scalers on | off                    use individual CLV scalers for each rate category (default: OFF)\n"
+            "  --mem-limit    VALUE[K|M|G]                maximum memory usage per MPI rank (default: OFF, unit: M)\n"
             "  --force                                    disable all safety checks (please think twice!)\n"
+            "  --trace                                    record execution trace (Chrome trace format, one file per MPI rank,\n"
+            "                                             --search/--bootstrap/--all only, default: OFF)\n"
+            "  --stats                                    print CLV/p-matrix update counts of direct likelihood evaluations and\n"
+            "                                             call counts/times of SPR, branch length and model optimizers (default: OFF)\n"
+            "  --events                                   write machine-readable event log (JSON lines, default: OFF)\n"
             "\n"
             "Model options:\n"
             "  --model        <name>+G[n]+<Freqs> | FILE  model specification OR partition file (default: GTR+G4)\n"
@@ -800,7 +930,9 @@ void CommandLineParser::print_help()
             "                 nr_oldfast | nr_oldsafe     \n"
             "  --opt-model    on | off                    ML optimization of all model parameters (default: ON)\n"
             "  --opt-branches on | off                    ML optimization of all branch lengths (default: ON)\n"
-            "  --prob-msa     on | off                    use probabilistic alignment (works with CATG and VCF)\n"
+            "  --prob-msa     on | off                    use probabilistic alignment (works with CATG)\n"
+            "  --prob-digits  VALUE                       round state probabilities to VALUE decimal places to improve\n"
+            "                                             pattern compression of probabilistic alignments (default: OFF)\n"
             "  --lh-epsilon   VALUE                       log-likelihood epsilon for optimization/tree search (default: 0.1)\n"
             "\n"
             "Topology search options:\n"
@@ -812,7 +944,11 @@ void CommandLineParser::print_help()
             "  --bs-trees     autoMRE                     use MRE-based bootstrap convergence criterion\n"
             "  --bs-trees     FILE                        Newick file containing set of bootstrap replicate trees (with --support)\n"
             "  --bs-cutoff    VALUE                       cutoff threshold for the MRE-based bootstopping criteria (default: 0.03)\n"
-            "  --bs-metric    fbp | tbe                   branch support metric: fbp = Felsenstein bootstrap (default), tbe = transfer distance\n";
+            "  --bs-metric    fbp | tbe                   branch support metric: fbp = Felsenstein bootstrap (default), tbe = transfer distance\n"
+#ifdef _RAXML_MPI
+            "  --bs-farm      VALUE                       infer replicates independently on groups of VALUE MPI ranks (default: OFF)\n"
+#endif
+            ;
 
   cout << "\n"
             "EXAMPLES:\n"
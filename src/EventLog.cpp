@@ -0,0 +1,181 @@
+#include <cmath>
+#include <cstdio>
+
+#include "EventLog.hpp"
+#include "common.h"
+
+using namespace std;
+
+bool EventLog::_enabled = false;
+ofstream EventLog::_stream;
+string EventLog::_buffer;
+
+static void append_escaped(string& json, const char * str)
+{
+  json += '"';
+  for (const char * c = str; *c; ++c)
+  {
+    switch (*c)
+    {
+      case '"':
+        json += "\\\"";
+        break;
+      case '\\':
+        json += "\\\\";
+        break;
+      case '\n':
+        json += "\\n";
+        break;
+      case '\t':
+        json += "\\t";
+        break;
+      default:
+        if ((unsigned char) *c < 0x20)
+        {
+          char buf[8];
+          snprintf(buf, sizeof(buf), "\\u%04x", (unsigned int) *c);
+          json += buf;
+        }
+        else
+          json += *c;
+    }
+  }
+  json += '"';
+}
+
+static void append_double(string& json, double value)
+{
+  /* JSON has no representation for NaN/Inf */
+  if (!std::isfinite(value))
+  {
+    json += "null";
+    return;
+  }
+
+  char buf[32];
+  snprintf(buf, sizeof(buf), "%.10g", value);
+  json += buf;
+}
+
+LogEvent::LogEvent(const char * type) : _json("{\"time\":")
+{
+  append_double(_json, global_timer().elapsed_seconds());
+  (*this)("event", type);
+}
+
+void LogEvent::key(const char * key)
+{
+  _json += ',';
+  append_escaped(_json, key);
+  _json += ':';
+}
+
+LogEvent& LogEvent::operator()(const char * key, const string& value)
+{
+  return (*this)(key, value.c_str());
+}
+
+LogEvent& LogEvent::operator()(const char * key, const char * value)
+{
+  this->key(key);
+  append_escaped(_json, value);
+  return *this;
+}
+
+LogEvent& LogEvent::operator()(const char * key, double value)
+{
+  this->key(key);
+  append_double(_json, value);
+  return *this;
+}
+
+LogEvent& LogEvent::operator()(const char * key, int value)
+{
+  this->key(key);
+  _json += to_string(value);
+  return *this;
+}
+
+LogEvent& LogEvent::operator()(const char * key, unsigned int value)
+{
+  this->key(key);
+  _json += to_string(value);
+  return *this;
+}
+
+LogEvent& LogEvent::operator()(const char * key, long value)
+{
+  this->key(key);
+  _json += to_string(value);
+  return *this;
+}
+
+LogEvent& LogEvent::operator()(const char * key, unsigned long value)
+{
+  this->key(key);
+  _json += to_string(value);
+  return *this;
+}
+
+LogEvent& LogEvent::operator()(const char * key, long long value)
+{
+  this->key(key);
+  _json += to_string(value);
+  return *this;
+}
+
+LogEvent& LogEvent::operator()(const char * key, unsigned long long value)
+{
+  this->key(key);
+  _json += to_string(value);
+  return *this;
+}
+
+LogEvent& LogEvent::operator()(const char * key, bool value)
+{
+  this->key(key);
+  _json += value ? "true" : "false";
+  return *this;
+}
+
+void EventLog::open(const string& fname, ios_base::openmode mode)
+{
+  _stream.open(fname, mode);
+  if (!_stream)
+    throw runtime_error("Unable to open event log file for writing: " + fname);
+
+  _buffer.reserve(RAXML_EVENTLOG_BUFSIZE + 1024);
+  _enabled = true;
+}
+
+void EventLog::close()
+{
+  if (!_enabled)
+    return;
+
+  flush();
+  _stream.close();
+  _enabled = false;
+}
+
+void EventLog::write(const LogEvent& event, bool flush)
+{
+  if (!_enabled || !ParallelContext::master())
+    return;
+
+  _buffer += event.str();
+  _buffer += '\n';
+
+  if (flush || _buffer.size() > RAXML_EVENTLOG_BUFSIZE)
+    EventLog::flush();
+}
+
+void EventLog::flush()
+{
+  if (!_enabled || _buffer.empty())
+    return;
+
+  _stream.write(_buffer.data(), _buffer.size());
+  _stream.flush();
+  _buffer.clear();
+}
@@ -0,0 +1,57 @@
+#ifndef RAXML_EVENTLOG_HPP_
+#define RAXML_EVENTLOG_HPP_
+
+#include <fstream>
+#include <string>
+
+/* single-line JSON object: {"time":<seconds since start>,"event":"<type>",<fields>...} */
+class LogEvent
+{
+public:
+  explicit LogEvent(const char * type);
+
+  LogEvent& operator()(const char * key, const std::string& value);
+  LogEvent& operator()(const char * key, const char * value);
+  LogEvent& operator()(const char * key, double value);
+  /* NB: one overload per fundamental integer type (size_t etc. are aliases of one of them) */
+  LogEvent& operator()(const char * key, int value);
+  LogEvent& operator()(const char * key, unsigned int value);
+  LogEvent& operator()(const char * key, long value);
+  LogEvent& operator()(const char * key, unsigned long value);
+  LogEvent& operator()(const char * key, long long value);
+  LogEvent& operator()(const char * key, unsigned long long value);
+  LogEvent& operator()(const char * key, bool value);
+
+  std::string str() const { return _json + "}"; }
+
+private:
+  std::string _json;
+
+  void key(const char * key);
+};
+
+/* Structured run log in JSON-lines format (one LogEvent per line), intended for workflow
+ * managers and other tools that track the progress of a run.
+ *
+ * Events are collected in memory and written out only when the buffer is full or a
+ * milestone event (phase end, checkpoint, replicate) is logged, so that frequent events
+ * (e.g. likelihood updates) do not cause any I/O on the hot path.
+ * Only the master thread of the master rank writes events, calls from other threads are
+ * ignored. */
+class EventLog
+{
+public:
+  static void open(const std::string& fname, std::ios_base::openmode mode = std::ios::out);
+  static void close();
+  static bool enabled() { return _enabled; }
+
+  static void write(const LogEvent& event, bool flush = false);
+  static void flush();
+
+private:
+  static bool _enabled;
+  static std::ofstream _stream;
+  static std::string _buffer;
+};
+
+#endif /* RAXML_EVENTLOG_HPP_ */
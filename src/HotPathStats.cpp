@@ -0,0 +1,303 @@
+#include <cassert>
+#include <chrono>
+#include <cstring>
+
+#include "HotPathStats.hpp"
+
+using namespace std;
+
+bool HotPathStats::_enabled = false;
+vector<HotPathStats::ThreadCounters> HotPathStats::_threads;
+
+PartitionCounters& PartitionCounters::operator+=(const PartitionCounters& other)
+{
+  clv_tip_tip += other.clv_tip_tip;
+  clv_tip_inner += other.clv_tip_inner;
+  clv_inner_inner += other.clv_inner_inner;
+  pmatrix_updates += other.pmatrix_updates;
+  scaled_sites += other.scaled_sites;
+  repeats_sites += other.repeats_sites;
+  repeats_computed += other.repeats_computed;
+  return *this;
+}
+
+static const char * OPT_ROUTINE_NAMES[] = {"branch lengths", "brlen scalers", "subst. rates",
+                                           "frequencies", "alpha", "p-inv", "free rates",
+                                           "SPR rounds"};
+
+const char * opt_routine_name(OptRoutine routine)
+{
+  return OPT_ROUTINE_NAMES[(size_t) routine];
+}
+
+RoutineCounters& RoutineCounters::operator+=(const RoutineCounters& other)
+{
+  calls += other.calls;
+  seconds += other.seconds;
+  return *this;
+}
+
+static double now()
+{
+  return chrono::duration<double>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void HotPathStats::enable(size_t num_threads)
+{
+  assert(num_threads > 0);
+
+  _threads.resize(num_threads);
+  for (auto& t: _threads)
+  {
+    t.parts.clear();
+    t.routines.fill(RoutineCounters());
+    t.pending.clear();
+  }
+
+  _enabled = true;
+}
+
+void HotPathStats::disable()
+{
+  _enabled = false;
+  _threads.clear();
+}
+
+/* mirrors the partial traversal in pllmod_treeinfo_compute_loglh(): a valid CLV implies
+ * that the whole subtree below it is valid as well */
+static void count_subtree(const pllmod_treeinfo_t& treeinfo, unsigned int p,
+                          const pll_unode_t * node, bool incremental, PartitionCounters& pc,
+                          vector<pair<unsigned int, const pll_unode_t *>>& pending)
+{
+  if (!node->next || (incremental && treeinfo.clv_valid[p][node->clv_index]))
+    return;
+
+  const pll_unode_t * left = node->next->back;
+  const pll_unode_t * right = node->next->next->back;
+
+  count_subtree(treeinfo, p, left, incremental, pc, pending);
+  count_subtree(treeinfo, p, right, incremental, pc, pending);
+
+  for (auto child: {left, right})
+  {
+    if (!incremental || !treeinfo.pmatrix_valid[p][child->pmatrix_index])
+      pc.pmatrix_updates++;
+  }
+
+  const size_t tip_children = (left->next ? 0 : 1) + (right->next ? 0 : 1);
+  if (tip_children == 2)
+    pc.clv_tip_tip++;
+  else if (tip_children == 1)
+    pc.clv_tip_inner++;
+  else
+    pc.clv_inner_inner++;
+
+  pending.emplace_back(p, node);
+}
+
+void HotPathStats::count_loglh_begin(const pllmod_treeinfo_t& treeinfo, bool incremental)
+{
+  const size_t thread_id = ParallelContext::world_thread_id();
+  if (thread_id >= _threads.size())
+    return;
+
+  auto& tc = _threads[thread_id];
+  tc.pending.clear();
+  if (tc.parts.size() < treeinfo.partition_count)
+    tc.parts.resize(treeinfo.partition_count, PartitionCounters());
+
+  const pll_unode_t * root = treeinfo.root;
+  for (unsigned int p = 0; p < treeinfo.partition_count; ++p)
+  {
+    if (!treeinfo.partitions[p])
+      continue;
+
+    auto& pc = tc.parts[p];
+    count_subtree(treeinfo, p, root, incremental, pc, tc.pending);
+    count_subtree(treeinfo, p, root->back, incremental, pc, tc.pending);
+
+    if (!incremental || !treeinfo.pmatrix_valid[p][root->pmatrix_index])
+      pc.pmatrix_updates++;
+  }
+}
+
+void HotPathStats::count_loglh_end(const pllmod_treeinfo_t& treeinfo)
+{
+  const size_t thread_id = ParallelContext::world_thread_id();
+  if (thread_id >= _threads.size())
+    return;
+
+  auto& tc = _threads[thread_id];
+  for (const auto& entry: tc.pending)
+  {
+    const pll_partition_t * partition = treeinfo.partitions[entry.first];
+    const pll_unode_t * node = entry.second;
+    auto& pc = tc.parts[entry.first];
+
+    const pll_repeats_t * repeats = (partition->attributes & PLL_ATTRIB_SITE_REPEATS) ?
+                                    partition->repeats : nullptr;
+
+    /* number of unique site classes is only known after the CLV has been updated */
+    if (repeats)
+    {
+      const size_t ids = repeats->pernode_ids[node->clv_index];
+      pc.repeats_sites += partition->sites;
+      pc.repeats_computed += ids ? ids : partition->sites;
+    }
+
+    if (node->scaler_index != PLL_SCALE_BUFFER_NONE)
+    {
+      size_t span = partition->sites;
+      if (repeats && repeats->perscale_ids[node->scaler_index])
+        span = repeats->perscale_ids[node->scaler_index];
+      if (partition->attributes & PLL_ATTRIB_RATE_SCALERS)
+        span *= partition->rate_cats;
+
+      const unsigned int * scaler = partition->scale_buffer[node->scaler_index];
+      for (size_t i = 0; i < span; ++i)
+        pc.scaled_sites += scaler[i] ? 1 : 0;
+    }
+  }
+  tc.pending.clear();
+}
+
+HotPathStats::RoutineScope::RoutineScope(OptRoutine routine) : _counters(nullptr), _start(0.)
+{
+  const size_t thread_id = ParallelContext::world_thread_id();
+  if (_enabled && thread_id < _threads.size())
+  {
+    _counters = &_threads[thread_id].routines[(size_t) routine];
+    _start = now();
+  }
+}
+
+HotPathStats::RoutineScope::~RoutineScope()
+{
+  if (_counters)
+  {
+    _counters->calls++;
+    _counters->seconds += now() - _start;
+  }
+}
+
+const vector<PartitionCounters>& HotPathStats::counters(size_t thread_id)
+{
+  return _threads.at(thread_id).parts;
+}
+
+const RoutineCountersArray& HotPathStats::routine_counters(size_t thread_id)
+{
+  return _threads.at(thread_id).routines;
+}
+
+HotPathTotals HotPathStats::aggregate(size_t part_count)
+{
+  HotPathTotals result;
+  result.parts.assign(part_count, PartitionCounters());
+  result.routines.fill(RoutineCounters());
+  for (const auto& t: _threads)
+  {
+    for (size_t p = 0; p < t.parts.size() && p < part_count; ++p)
+      result.parts[p] += t.parts[p];
+    for (size_t r = 0; r < OPT_ROUTINE_COUNT; ++r)
+      result.routines[r] += t.routines[r];
+  }
+
+  /* worker ranks send their totals to the master rank */
+  if (ParallelContext::num_ranks() > 1)
+  {
+    const size_t parts_size = part_count * sizeof(PartitionCounters);
+    const size_t data_size = parts_size + sizeof(RoutineCountersArray);
+
+    auto worker_cb = [&result, parts_size, data_size](void * buf, int buf_size) -> int
+        {
+          if (data_size > (size_t) buf_size)
+            throw out_of_range("Statistics buffer too small");
+          memcpy(buf, result.parts.data(), parts_size);
+          memcpy((char *) buf + parts_size, result.routines.data(), sizeof(RoutineCountersArray));
+          return (int) data_size;
+        };
+
+    auto master_cb = [&result, data_size](void * buf, int buf_size)
+        {
+          assert((size_t) buf_size == data_size);
+          RAXML_UNUSED(buf_size);
+          const char * data = (const char *) buf;
+          for (auto& pc: result.parts)
+          {
+            PartitionCounters rank_pc;
+            memcpy(&rank_pc, data, sizeof(PartitionCounters));
+            pc += rank_pc;
+            data += sizeof(PartitionCounters);
+          }
+
+          RoutineCountersArray rank_routines;
+          memcpy(rank_routines.data(), data, sizeof(RoutineCountersArray));
+          for (size_t r = 0; r < OPT_ROUTINE_COUNT; ++r)
+            result.routines[r] += rank_routines[r];
+        };
+
+    ParallelContext::mpi_gather_custom(worker_cb, master_cb);
+  }
+
+  return result;
+}
+
+static string percent(size_t part, size_t total)
+{
+  ostringstream ss;
+  ss << fixed << setprecision(1) << (total ? 100. * part / total : 0.) << "%";
+  return ss.str();
+}
+
+string hotpath_stats_report(const HotPathTotals& totals, const NameList& part_names)
+{
+  const auto& counters = totals.parts;
+  assert(counters.size() == part_names.size());
+
+  ostringstream ss;
+  ss << "Hot-path statistics, kernel calls of direct likelihood evaluations "
+        "(not including the optimizers below):" << endl << endl;
+  ss << left << setw(20) << "Partition" << right << setw(14) << "CLV updates" <<
+      setw(10) << "tip-tip" << setw(11) << "tip-inner" << setw(13) << "inner-inner" <<
+      setw(14) << "P-matrices" << setw(14) << "scaled sites" << setw(14) << "repeats hit" <<
+      endl;
+
+  PartitionCounters total = PartitionCounters();
+  auto print_row = [&ss](const string& name, const PartitionCounters& pc)
+      {
+        const size_t clvs = pc.clv_updates();
+        ss << left << setw(20) << name.substr(0, 19) << right << setw(14) << clvs <<
+            setw(10) << percent(pc.clv_tip_tip, clvs) <<
+            setw(11) << percent(pc.clv_tip_inner, clvs) <<
+            setw(13) << percent(pc.clv_inner_inner, clvs) <<
+            setw(14) << pc.pmatrix_updates << setw(14) << pc.scaled_sites <<
+            setw(14) << (pc.repeats_sites ? percent(pc.repeats_sites - pc.repeats_computed,
+                                                    pc.repeats_sites) : "n/a") << endl;
+      };
+
+  for (size_t p = 0; p < counters.size(); ++p)
+  {
+    print_row(part_names[p], counters[p]);
+    total += counters[p];
+  }
+
+  if (counters.size() > 1)
+    print_row("TOTAL", total);
+
+  ss << endl << "Optimization routines (libpll-modules), summed over all threads:" << endl << endl;
+  ss << left << setw(20) << "Routine" << right << setw(14) << "calls" <<
+      setw(14) << "time (s)" << endl;
+
+  for (size_t r = 0; r < OPT_ROUTINE_COUNT; ++r)
+  {
+    const auto& rc = totals.routines[r];
+    if (!rc.calls)
+      continue;
+
+    ss << left << setw(20) << opt_routine_name((OptRoutine) r) << right << setw(14) << rc.calls <<
+        setw(14) << fixed << setprecision(3) << rc.seconds << endl;
+  }
+
+  return ss.str();
+}
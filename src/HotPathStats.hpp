@@ -0,0 +1,125 @@
+#ifndef RAXML_HOTPATHSTATS_HPP_
+#define RAXML_HOTPATHSTATS_HPP_
+
+#include <array>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "common.h"
+
+/* per-partition counters, summed over all TreeInfo::loglh() calls */
+struct PartitionCounters
+{
+  /* CLV updates by type of child nodes (tip-tip, tip-inner and inner-inner kernels) */
+  size_t clv_tip_tip;
+  size_t clv_tip_inner;
+  size_t clv_inner_inner;
+  size_t pmatrix_updates;
+  /* site (or site x rate) entries with a non-zero scaler in the updated CLVs */
+  size_t scaled_sites;
+  /* sites covered by CLV updates with site repeats enabled vs. sites actually computed */
+  size_t repeats_sites;
+  size_t repeats_computed;
+
+  size_t clv_updates() const { return clv_tip_tip + clv_tip_inner + clv_inner_inner; }
+  double repeats_hit_rate() const
+  { return repeats_sites ? 1. - (double) repeats_computed / repeats_sites : 0.; }
+
+  PartitionCounters& operator+=(const PartitionCounters& other);
+};
+
+/* libpll-modules routines called by TreeInfo, which evaluate the likelihood internally */
+enum class OptRoutine
+{
+  brlen = 0,
+  brlen_scalers,
+  subst_rates,
+  frequencies,
+  alpha,
+  pinv,
+  free_rates,
+  spr_round
+};
+
+static const size_t OPT_ROUTINE_COUNT = 8;
+
+const char * opt_routine_name(OptRoutine routine);
+
+/* calls and wall-clock time of one routine, measured at the call site */
+struct RoutineCounters
+{
+  size_t calls;
+  double seconds;
+
+  RoutineCounters& operator+=(const RoutineCounters& other);
+};
+
+typedef std::array<RoutineCounters, OPT_ROUTINE_COUNT> RoutineCountersArray;
+
+/* counters summed over all threads and ranks */
+struct HotPathTotals
+{
+  std::vector<PartitionCounters> parts;
+  RoutineCountersArray routines;
+};
+
+/* Hot-path counters: every thread writes into its own set of counters (no atomics, no locks),
+ * which are aggregated once at the end of the run. Two kinds of counters are kept:
+ *
+ * - kernel calls of TreeInfo::loglh(), derived from the CLV/p-matrix validity flags of the
+ *   treeinfo (per partition)
+ * - calls and time of the libpll-modules optimization routines (SPR rounds, branch length and
+ *   model optimizers), counted at their call sites in TreeInfo. libpll does not expose the
+ *   kernel calls issued inside these routines, so they are not broken down any further. */
+class HotPathStats
+{
+public:
+  /* must be called before the worker threads are started */
+  static void enable(size_t num_threads);
+  static void disable();
+  static bool enabled() { return _enabled; }
+
+  /* must be called right before/after pllmod_treeinfo_compute_loglh() */
+  static void count_loglh_begin(const pllmod_treeinfo_t& treeinfo, bool incremental);
+  static void count_loglh_end(const pllmod_treeinfo_t& treeinfo);
+
+  /* counts one call of a libpll-modules routine, from construction to destruction */
+  class RoutineScope
+  {
+  public:
+    explicit RoutineScope(OptRoutine routine);
+    ~RoutineScope();
+
+    RoutineScope(const RoutineScope& other) = delete;
+    RoutineScope& operator=(const RoutineScope& other) = delete;
+  private:
+    RoutineCounters * _counters;
+    double _start;
+  };
+
+  /* counters are allocated on first use, so vector size may be smaller than partition count */
+  static const std::vector<PartitionCounters>& counters(size_t thread_id);
+  static const RoutineCountersArray& routine_counters(size_t thread_id);
+
+  /* collective over all ranks (master threads only, worker threads must be finished):
+   * returns counters summed over all threads and ranks (valid at the master rank only) */
+  static HotPathTotals aggregate(size_t part_count);
+
+private:
+  struct ThreadCounters
+  {
+    std::vector<PartitionCounters> parts;
+    RoutineCountersArray routines;
+    /* CLVs to be recomputed by the current likelihood evaluation: (partition, node) */
+    std::vector<std::pair<unsigned int, const pll_unode_t *>> pending;
+    char pad[64];  /* keep counters of different threads on separate cache lines */
+  };
+
+  static bool _enabled;
+  static std::vector<ThreadCounters> _threads;
+};
+
+std::string hotpath_stats_report(const HotPathTotals& totals, const NameList& part_names);
+
+#endif /* RAXML_HOTPATHSTATS_HPP_ */
@@ -1,5 +1,8 @@
 #include <stdexcept>
 #include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
 
 #include "MSA.hpp"
 
@@ -18,7 +21,7 @@ MSA::MSA(const pll_msa_t *pll_msa) :
 
 MSA::MSA(MSA&& other) : _length(other._length), _num_sites(other._num_sites),
     _sequences(move(other._sequences)), _labels(move(other._labels)),
-    _label_id_map(move(other._label_id_map)), _weights(move(other._weights)),
+    _weights(move(other._weights)),
     _probs(move(other._probs)), _states(other._states), _pll_msa(other._pll_msa),
     _dirty(other._dirty)
 {
@@ -41,7 +44,6 @@ MSA& MSA::operator=(MSA&& other)
     _weights.clear();
     _sequences.clear();
     _labels.clear();
-    _label_id_map.clear();
 
     // steal other’s resource
     _length = other._length;
@@ -50,7 +52,6 @@ MSA& MSA::operator=(MSA&& other)
     _weights = std::move(other._weights);
     _sequences = std::move(other._sequences);
     _labels = std::move(other._labels);
-    _label_id_map = std::move(other._label_id_map);
     _probs = std::move(other._probs);
     _states = other._states;
     _dirty = other._dirty;
@@ -83,10 +84,7 @@ void MSA::append(const string& sequence, const string& header)
   _sequences.push_back(sequence);
 
   if (!header.empty())
-  {
     _labels.push_back(header);
-    _label_id_map[header] = _labels.size() - 1;
-  }
 
   if (!_length)
   {
@@ -102,6 +100,14 @@ void MSA::append(const string& sequence, const string& header)
 
 void MSA::compress_patterns(const pll_state_t * charmap)
 {
+  /* libpll ignores existing site weights, e.g. for pre-compressed VCF input */
+  if (probabilistic() ||
+      std::any_of(_weights.cbegin(), _weights.cend(), [](WeightType w) { return w != 1; }))
+  {
+    compress_weighted_patterns();
+    return;
+  }
+
   update_pll_msa();
 
   assert(_pll_msa->count && _pll_msa->length);
@@ -125,6 +131,120 @@ void MSA::compress_patterns(const pll_state_t * charmap)
   _dirty = false;
 }
 
+static inline uint64_t hash_combine(uint64_t h, uint64_t value)
+{
+  h = (h ^ value) * 0x9E3779B97F4A7C15ULL;
+  return h ^ (h >> 32);
+}
+
+bool MSA::equal_columns(size_t site1, size_t site2) const
+{
+  for (size_t j = 0; j < size(); ++j)
+  {
+    if (_sequences[j][site1] != _sequences[j][site2])
+      return false;
+
+    if (!probabilistic())
+      continue;
+
+    const double * p1 = _probs[j].data() + site1 * _states;
+    const double * p2 = _probs[j].data() + site2 * _states;
+    for (size_t k = 0; k < _states; ++k)
+    {
+      if (p1[k] != p2[k])
+        return false;
+    }
+  }
+
+  return true;
+}
+
+void MSA::compress_weighted_patterns()
+{
+  assert(size() && _length);
+
+  /* hash all columns; taxa are in the outer loop, so that sequences and probability
+   * vectors are read sequentially */
+  std::vector<uint64_t> hashes(_length, 0);
+  for (size_t j = 0; j < size(); ++j)
+  {
+    const char * seq = _sequences[j].data();
+    const double * probs = probabilistic() ? _probs[j].data() : nullptr;
+    for (size_t i = 0; i < _length; ++i)
+    {
+      uint64_t h = hash_combine(hashes[i], (unsigned char) seq[i]);
+      for (size_t k = 0; k < _states; ++k, ++probs)
+      {
+        /* +0. turns -0. into 0., so that equal values have equal hashes */
+        const double p = *probs + 0.;
+        uint64_t bits;
+        memcpy(&bits, &p, sizeof(bits));
+        h = hash_combine(h, bits);
+      }
+      hashes[i] = h;
+    }
+  }
+
+  /* assign sites to patterns, patterns are kept in the order of their first occurrence */
+  std::unordered_multimap<uint64_t, size_t> hash_pattern;
+  hash_pattern.reserve(_length);
+  std::vector<size_t> pattern_site;
+  WeightVector weights;
+  for (size_t i = 0; i < _length; ++i)
+  {
+    const WeightType w = _weights.empty() ? 1 : _weights[i];
+
+    bool found = false;
+    auto range = hash_pattern.equal_range(hashes[i]);
+    for (auto it = range.first; it != range.second; ++it)
+    {
+      /* verify to rule out hash collisions */
+      if (equal_columns(pattern_site[it->second], i))
+      {
+        weights[it->second] += w;
+        found = true;
+        break;
+      }
+    }
+
+    if (!found)
+    {
+      hash_pattern.emplace(hashes[i], pattern_site.size());
+      pattern_site.push_back(i);
+      weights.push_back(w);
+    }
+  }
+
+  /* compact sequences and probabilities in-place: pattern_site[p] >= p */
+  const size_t num_patterns = pattern_site.size();
+  for (size_t j = 0; j < size(); ++j)
+  {
+    auto& seq = _sequences[j];
+    for (size_t p = 0; p < num_patterns; ++p)
+      seq[p] = seq[pattern_site[p]];
+    seq.resize(num_patterns);
+
+    if (probabilistic())
+    {
+      auto& probs = _probs[j];
+      for (size_t p = 0; p < num_patterns; ++p)
+      {
+        const size_t s = pattern_site[p];
+        if (s != p)
+        {
+          std::copy(probs.begin() + s * _states, probs.begin() + (s + 1) * _states,
+                    probs.begin() + p * _states);
+        }
+      }
+      probs.resize(num_patterns * _states);
+      probs.shrink_to_fit();
+    }
+  }
+
+  _length = num_patterns;
+  _weights = std::move(weights);
+  _dirty = true;
+}
 
 const pll_msa_t * MSA::pll_msa() const
 {
@@ -175,7 +295,9 @@ void MSA::update_pll_msa() const
 void MSA::states(size_t states)
 {
   _states = states;
-  if (size() > 0)
+  if (!states)
+    ProbVectorList().swap(_probs);
+  else if (size() > 0)
   {
     _probs.resize(size());
     for (auto& v: _probs)
@@ -185,6 +307,16 @@ void MSA::states(size_t states)
   }
 }
 
+void MSA::round_probs(unsigned int decimals)
+{
+  const double scale = std::pow(10., decimals);
+  for (auto& pv: _probs)
+  {
+    for (auto& p: pv)
+      p = std::round(p * scale) / scale;
+  }
+}
+
 ProbVector::const_iterator MSA::probs(size_t index, size_t site) const
 {
   return _probs.at(index).cbegin() + site * _states;
@@ -220,12 +352,15 @@ doubleVector MSA::state_freqs() const
   doubleVector freqs(_states, 0.);
   for (const auto& pv: _probs)
   {
-    for (auto p = pv.cbegin(); p != pv.cend();)
+    size_t site = 0;
+    for (auto p = pv.cbegin(); p != pv.cend(); ++site)
     {
+      /* compressed patterns: weight by the number of sites */
+      const double w = _weights.empty() ? 1. : _weights[site];
       for (size_t i = 0; i < _states; ++i, ++p)
       {
-        freqs[i] += *p;
-        sum += *p;
+        freqs[i] += w * (*p);
+        sum += w * (*p);
       }
     }
   }
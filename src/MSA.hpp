@@ -27,6 +27,10 @@ public:
   MSA& operator=(const MSA& other) = delete;
 
   void append(const std::string& sequence, const std::string& header = "");
+
+  /* merge identical columns, for probabilistic MSAs both characters and state
+   * probabilities must match (NB: charmap is ignored in this case and if the MSA
+   * has been compressed before, i.e. site weights are not all 1) */
   void compress_patterns(const pll_state_t * charmap);
 
   bool empty() const { return _sequences.empty(); }
@@ -35,22 +39,21 @@ public:
   size_t num_sites() const { return _num_sites; }
   size_t num_patterns() const { return _weights.size(); }
   const WeightVector& weights() const {return _weights; }
-  const NameIdMap& label_id_map() const { return _label_id_map; }
   const pll_msa_t * pll_msa() const;
 
   const container& labels() const { return _labels; };
   const std::string& label(size_t index) const { return _labels.at(index); }
-  const std::string& at(const std::string& label) const
-  { return _sequences.at(_label_id_map.at(label)); }
   const std::string& at(size_t index) const { return _sequences.at(index); }
-  const std::string& operator[](const std::string& label) const { return at(label); }
   const std::string& operator[](size_t index) const { return at(index); }
   std::string& operator[](size_t index) { return _sequences.at(index); }
 
   bool probabilistic() const { return _states > 0; }
   bool normalized() const;
   size_t states() const { return _states; }
+  /* NB: states(0) removes state probabilities */
   void states(size_t states);
+  /* round state probabilities to the given number of decimal places */
+  void round_probs(unsigned int decimals);
   const ProbVector& probs(size_t index) const { return _probs.at(index); }
   ProbVector::const_iterator probs(size_t index, size_t site) const;
   ProbVector::iterator probs(size_t index, size_t site);
@@ -80,7 +83,6 @@ private:
   size_t _num_sites;
   container _sequences;
   container _labels;
-  NameIdMap _label_id_map;
   WeightVector _weights;
   ProbVectorList _probs;
   size_t _states;
@@ -91,6 +93,9 @@ private:
   void free_pll_msa() noexcept;
 
   void update_num_sites();
+
+  void compress_weighted_patterns();
+  bool equal_columns(size_t site1, size_t site2) const;
 };
 
 #endif /* RAXML_MSA_HPP_ */
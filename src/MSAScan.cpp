@@ -0,0 +1,209 @@
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <functional>
+#include <unordered_map>
+
+#ifdef _RAXML_PTHREADS
+#include <thread>
+#endif
+
+#include "MSAScan.hpp"
+
+using namespace std;
+
+static inline uint64_t hash_word(uint64_t h, uint64_t word)
+{
+  h = (h ^ word) * 0x9E3779B97F4A7C15ULL;
+  return h ^ (h >> 29);
+}
+
+/* hashes 8 characters at a time, and checks whether the sequence contains determined characters */
+static uint64_t scan_seq(uint64_t h, const char * seq, size_t len, const array<bool, 256>& is_gap,
+                         bool& gap_only)
+{
+  size_t i = 0;
+  for (; i + sizeof(uint64_t) <= len; i += sizeof(uint64_t))
+  {
+    uint64_t word;
+    memcpy(&word, seq + i, sizeof(word));
+    h = hash_word(h, word);
+  }
+
+  uint64_t tail = 0;
+  memcpy(&tail, seq + i, len - i);
+
+  for (size_t s = 0; gap_only && s < len; ++s)
+    gap_only = is_gap[(unsigned char) seq[s]];
+
+  return hash_word(h, tail ^ len);
+}
+
+static bool equal_seqs(const PartitionedMSA& parted_msa, size_t seq1, size_t seq2)
+{
+  for (const auto& pinfo: parted_msa.part_list())
+  {
+    if (pinfo.msa().at(seq1) != pinfo.msa().at(seq2))
+      return false;
+  }
+  return true;
+}
+
+static void run_parallel(size_t num_threads, size_t num_blocks,
+                         const function<void(size_t)>& block_cb)
+{
+  atomic<size_t> next_block(0);
+  auto worker = [&next_block, num_blocks, &block_cb]()
+      {
+        for (size_t b = next_block++; b < num_blocks; b = next_block++)
+          block_cb(b);
+      };
+
+#ifdef _RAXML_PTHREADS
+  vector<thread> workers;
+  for (size_t t = 1; t < min(num_threads, num_blocks); ++t)
+    workers.emplace_back(worker);
+  worker();
+  for (auto& w: workers)
+    w.join();
+#else
+  RAXML_UNUSED(num_threads);
+  worker();
+#endif
+}
+
+MSAScanResult scan_msa(const PartitionedMSA& parted_msa, size_t num_threads)
+{
+  MSAScanResult result;
+
+  const size_t taxon_count = parted_msa.taxon_count();
+  const size_t part_count = parted_msa.part_count();
+
+  /* duplicate taxon names */
+  {
+    unordered_map<string, size_t> name_map;
+    name_map.reserve(taxon_count);
+    const auto& names = parted_msa.taxon_names();
+    for (size_t i = 0; i < names.size(); ++i)
+    {
+      auto ins = name_map.emplace(names[i], i);
+      if (!ins.second)
+        result.dup_taxa.emplace_back(ins.first->second, i);
+    }
+  }
+
+  /* per-partition lookup tables for undetermined characters */
+  vector<array<bool, 256> > gap_char(part_count);
+  vector<size_t> part_offset(part_count + 1, 0);
+  for (size_t p = 0; p < part_count; ++p)
+  {
+    const auto& pinfo = parted_msa.part_info(p);
+    const auto states = pinfo.model().num_states();
+    const pll_state_t gap_state = states < sizeof(pll_state_t) * 8 ?
+                                  ((pll_state_t) 1 << states) - 1 : ~((pll_state_t) 0);
+    const pll_state_t * charmap = pinfo.model().charmap();
+    for (size_t c = 0; c < 256; ++c)
+      gap_char[p][c] = (charmap[c] == gap_state);
+
+    part_offset[p+1] = part_offset[p] + pinfo.msa().length();
+  }
+
+  /* taxa are processed in blocks: hash sequences, look for fully undetermined ones */
+  const size_t taxon_block_size = 64;
+  const size_t num_taxon_blocks = (taxon_count + taxon_block_size - 1) / taxon_block_size;
+
+  vector<uint64_t> seq_hash(taxon_count, 0);
+  vector<char> seq_gap(taxon_count, 0);
+
+  run_parallel(num_threads, num_taxon_blocks, [&](size_t block)
+      {
+        const size_t last = min(taxon_count, (block + 1) * taxon_block_size);
+        for (size_t i = block * taxon_block_size; i < last; ++i)
+        {
+          uint64_t h = 0;
+          bool gap_only = true;
+          for (size_t p = 0; p < part_count; ++p)
+          {
+            const auto& seq = parted_msa.part_info(p).msa().at(i);
+            h = scan_seq(h, seq.data(), seq.size(), gap_char[p], gap_only);
+          }
+          seq_hash[i] = h;
+          seq_gap[i] = gap_only;
+        }
+      });
+
+  /* columns are processed in ranges, so that each column flag is written by one thread only.
+   * Most columns are determined in one of the first sequences, so stop as soon as
+   * all columns in the range are resolved */
+  const size_t col_block_size = 4096;
+  vector<pair<size_t, size_t> > col_blocks;
+  for (size_t p = 0; p < part_count; ++p)
+  {
+    for (size_t s = part_offset[p]; s < part_offset[p+1]; s += col_block_size)
+      col_blocks.emplace_back(p, s);
+  }
+
+  vector<char> col_determined(part_offset[part_count], 0);
+
+  run_parallel(num_threads, col_blocks.size(), [&](size_t block)
+      {
+        const size_t p = col_blocks[block].first;
+        const size_t start = col_blocks[block].second;
+        const size_t end = min(part_offset[p+1], start + col_block_size);
+        const auto& is_gap = gap_char[p];
+        const auto& msa = parted_msa.part_info(p).msa();
+        const size_t offset = part_offset[p];
+        char * col_det = col_determined.data();
+
+        size_t num_undetermined = end - start;
+        for (size_t i = 0; i < taxon_count && num_undetermined > 0; ++i)
+        {
+          const char * seq = msa.at(i).data();
+          for (size_t s = start; s < end; ++s)
+          {
+            if (!col_det[s] && !is_gap[(unsigned char) seq[s - offset]])
+            {
+              col_det[s] = 1;
+              num_undetermined--;
+            }
+          }
+        }
+      });
+
+  /* duplicate sequences: compare with all distinct sequences having the same hash */
+  unordered_multimap<uint64_t, size_t> hash_seqs;
+  hash_seqs.reserve(taxon_count);
+  for (size_t i = 0; i < taxon_count; ++i)
+  {
+    bool dup = false;
+    auto range = hash_seqs.equal_range(seq_hash[i]);
+    for (auto it = range.first; it != range.second; ++it)
+    {
+      if (equal_seqs(parted_msa, it->second, i))
+      {
+        result.dup_seqs.emplace_back(it->second, i);
+        dup = true;
+        break;
+      }
+    }
+
+    if (!dup)
+      hash_seqs.emplace(seq_hash[i], i);
+
+    if (seq_gap[i])
+      result.gap_seqs.push_back(i);
+  }
+
+  /* fully undetermined columns */
+  result.gap_cols.resize(part_count);
+  for (size_t p = 0; p < part_count; ++p)
+  {
+    for (size_t s = part_offset[p]; s < part_offset[p+1]; ++s)
+    {
+      if (!col_determined[s])
+        result.gap_cols[p].push_back(s - part_offset[p]);
+    }
+  }
+
+  return result;
+}
@@ -0,0 +1,28 @@
+#ifndef RAXML_MSASCAN_HPP_
+#define RAXML_MSASCAN_HPP_
+
+#include "PartitionedMSA.hpp"
+
+typedef std::vector<std::pair<size_t, size_t> > IndexPairList;
+
+/* Alignment properties checked before the analysis; all indices are 0-based */
+struct MSAScanResult
+{
+  /* (first occurrence, duplicate) pairs */
+  IndexPairList dup_taxa;
+  IndexPairList dup_seqs;
+
+  /* fully undetermined columns, per partition */
+  std::vector<std::vector<size_t> > gap_cols;
+
+  /* sequences which are fully undetermined in all partitions */
+  std::vector<size_t> gap_seqs;
+};
+
+/* Finds duplicate taxon names, duplicate sequences and fully undetermined
+ * columns/sequences. Sequences are hashed word-wise, and sequences with equal
+ * hashes are compared in full. Undetermined columns are searched per column
+ * range, stopping at the first determined character of each column. */
+MSAScanResult scan_msa(const PartitionedMSA& parted_msa, size_t num_threads = 1);
+
+#endif /* RAXML_MSASCAN_HPP_ */
@@ -0,0 +1,227 @@
+#include "MemoryBudget.hpp"
+#include "PartitionedMSA.hpp"
+
+using namespace std;
+
+size_t MemoryBudget::_limit = 0;
+array<atomic<size_t>, MEM_CATEGORY_COUNT> MemoryBudget::_used;
+atomic<size_t> MemoryBudget::_total(0);
+atomic<size_t> MemoryBudget::_peak(0);
+
+static const char * MEM_CATEGORY_NAMES[] = {"MSA", "CLVs", "p-matrices", "tip buffers",
+                                            "bootstrap weights", "trees"};
+
+const char * mem_category_name(MemCategory cat)
+{
+  return MEM_CATEGORY_NAMES[(size_t) cat];
+}
+
+size_t MemoryUsage::total() const
+{
+  size_t sum = 0;
+  for (auto b: bytes)
+    sum += b;
+  return sum;
+}
+
+MemoryUsage& MemoryUsage::operator+=(const MemoryUsage& other)
+{
+  for (size_t i = 0; i < MEM_CATEGORY_COUNT; ++i)
+    bytes[i] += other.bytes[i];
+  return *this;
+}
+
+MemoryUsage MemoryUsage::operator*(size_t factor) const
+{
+  MemoryUsage result;
+  for (size_t i = 0; i < MEM_CATEGORY_COUNT; ++i)
+    result.bytes[i] = bytes[i] * factor;
+  return result;
+}
+
+static string mem_str(size_t bytes)
+{
+  const double mb = ((double) bytes) / (1024 * 1024);
+
+  ostringstream ss;
+  ss << fixed << setprecision(mb < 10. ? 1 : 0) << mb << " MB";
+  return ss.str();
+}
+
+std::ostream& operator<<(std::ostream& stream, const MemoryUsage& usage)
+{
+  bool first = true;
+  for (size_t i = 0; i < MEM_CATEGORY_COUNT; ++i)
+  {
+    if (!usage.bytes[i])
+      continue;
+
+    if (!first)
+      stream << ", ";
+    stream << MEM_CATEGORY_NAMES[i] << ": " << mem_str(usage.bytes[i]);
+    first = false;
+  }
+
+  if (first)
+    stream << mem_str(0);
+
+  return stream;
+}
+
+MemoryBudgetException::MemoryBudgetException(const MemoryUsage& required, size_t limit) :
+  RaxmlException("")
+{
+  ostringstream ss;
+  ss << "Memory limit exceeded: " << mem_str(required.total()) << " required, but only "
+     << mem_str(limit) << " allowed (--mem-limit)." << endl
+     << "Estimated memory requirements: " << required << endl
+     << "Please increase the memory limit or use more MPI ranks (memory is limited per rank).";
+  _message = ss.str();
+}
+
+void MemoryBudget::allocate(const MemoryUsage& usage)
+{
+  const size_t bytes = usage.total();
+  const size_t new_total = _total.fetch_add(bytes) + bytes;
+
+  if (_limit && new_total > _limit)
+  {
+    _total.fetch_sub(bytes);
+
+    auto required = used();
+    required += usage;
+    throw MemoryBudgetException(required, _limit);
+  }
+
+  for (size_t i = 0; i < MEM_CATEGORY_COUNT; ++i)
+    _used[i].fetch_add(usage.bytes[i]);
+
+  /* update high-water mark */
+  size_t peak = _peak.load();
+  while (new_total > peak && !_peak.compare_exchange_weak(peak, new_total))
+    ;
+}
+
+void MemoryBudget::allocate(MemCategory cat, size_t bytes)
+{
+  MemoryUsage usage;
+  usage[cat] = bytes;
+  allocate(usage);
+}
+
+void MemoryBudget::release(const MemoryUsage& usage)
+{
+  for (size_t i = 0; i < MEM_CATEGORY_COUNT; ++i)
+  {
+    assert(_used[i].load() >= usage.bytes[i]);
+    _used[i].fetch_sub(usage.bytes[i]);
+  }
+
+  _total.fetch_sub(usage.total());
+}
+
+void MemoryBudget::release(MemCategory cat, size_t bytes)
+{
+  MemoryUsage usage;
+  usage[cat] = bytes;
+  release(usage);
+}
+
+MemoryUsage MemoryBudget::used()
+{
+  MemoryUsage usage;
+  for (size_t i = 0; i < MEM_CATEGORY_COUNT; ++i)
+    usage.bytes[i] = _used[i].load();
+  return usage;
+}
+
+void MemoryBudget::reset()
+{
+  for (auto& u: _used)
+    u = 0;
+  _total = 0;
+  _peak = 0;
+}
+
+size_t msa_mem_size(const MSA& msa)
+{
+  size_t size = msa.size() * msa.length() * sizeof(char);
+  size += msa.weights().size() * sizeof(WeightType);
+  if (msa.probabilistic())
+    size += msa.size() * msa.length() * msa.states() * sizeof(double);
+  return size;
+}
+
+size_t msa_mem_size(const PartitionedMSA& parted_msa)
+{
+  size_t size = 0;
+  for (const auto& pinfo: parted_msa.part_list())
+    size += msa_mem_size(pinfo.msa());
+
+  /* full MSA is only kept for partitioned alignments */
+  if (parted_msa.part_count() > 1)
+    size += msa_mem_size(parted_msa.full_msa());
+
+  return size;
+}
+
+size_t tree_mem_size(size_t num_tips)
+{
+  if (num_tips < 3)
+    return 0;
+
+  /* 1 node per tip, 3 nodes per inner node + node pointers + labels */
+  const size_t num_inner = num_tips - 2;
+  return (num_tips + 3 * num_inner) * sizeof(pll_unode_t) +
+         (num_tips + num_inner) * sizeof(pll_unode_t *) +
+         num_tips * 32;
+}
+
+static size_t states_padded(size_t states, unsigned int attrs)
+{
+  if (attrs & PLL_ATTRIB_ARCH_AVX512)
+    return (states + 7) & ~((size_t) 7);
+  else if (attrs & (PLL_ATTRIB_ARCH_AVX | PLL_ATTRIB_ARCH_AVX2))
+    return (states + 3) & ~((size_t) 3);
+  else if (attrs & PLL_ATTRIB_ARCH_SSE)
+    return (states + 1) & ~((size_t) 1);
+  else
+    return states;
+}
+
+MemoryUsage pll_partition_mem_size(size_t tips, size_t clv_buffers, size_t states,
+                                   size_t sites, size_t prob_matrices, size_t rate_cats,
+                                   size_t scale_buffers, unsigned int attrs)
+{
+  MemoryUsage usage;
+
+  const size_t padded = states_padded(states, attrs);
+
+  /* with ascertainment bias correction, one extra "site" per state is allocated */
+  const size_t sites_alloc = (attrs & PLL_ATTRIB_AB_FLAG) ? sites + states : sites;
+  const size_t clv_size = sites_alloc * rate_cats * padded * sizeof(double);
+  const size_t scaler_size = sites_alloc * sizeof(unsigned int) *
+                             ((attrs & PLL_ATTRIB_RATE_SCALERS) ? rate_cats : 1);
+
+  usage[MemCategory::clv] = clv_buffers * clv_size + scale_buffers * scaler_size;
+
+  if (attrs & PLL_ATTRIB_SITE_REPEATS)
+  {
+    /* site -> repeat id and repeat id -> site maps for every node */
+    usage[MemCategory::clv] += 2 * (tips + clv_buffers) * sites_alloc * sizeof(unsigned int);
+  }
+
+  usage[MemCategory::pmatrix] = prob_matrices * rate_cats * states * padded * sizeof(double);
+
+  if (attrs & PLL_ATTRIB_PATTERN_TIP)
+  {
+    /* 1 byte per tip character + precomputed tip-tip/tip-inner lookup tables */
+    const size_t maxstates = states == 4 ? 16 : states;
+    usage[MemCategory::tipbuf] = tips * sites_alloc * sizeof(unsigned char) +
+                                 maxstates * maxstates * rate_cats * padded * sizeof(double);
+  }
+  else
+    usage[MemCategory::tipbuf] = tips * clv_size;
+
+  return usage;
+}
@@ -0,0 +1,96 @@
+#ifndef RAXML_MEMORYBUDGET_HPP_
+#define RAXML_MEMORYBUDGET_HPP_
+
+#include <array>
+#include <atomic>
+
+#include "common.h"
+
+class MSA;
+class PartitionedMSA;
+
+enum class MemCategory
+{
+  msa = 0,
+  clv,
+  pmatrix,
+  tipbuf,
+  bs_weights,
+  trees
+};
+
+static const size_t MEM_CATEGORY_COUNT = 6;
+
+const char * mem_category_name(MemCategory cat);
+
+/* memory size (in bytes) per category */
+struct MemoryUsage
+{
+  MemoryUsage() : bytes() {}
+
+  size_t& operator[](MemCategory cat) { return bytes[(size_t) cat]; }
+  size_t operator[](MemCategory cat) const { return bytes[(size_t) cat]; }
+
+  size_t total() const;
+
+  MemoryUsage& operator+=(const MemoryUsage& other);
+  MemoryUsage operator*(size_t factor) const;
+
+  std::array<size_t, MEM_CATEGORY_COUNT> bytes;
+};
+
+/* prints non-zero categories, e.g. "CLVs: 1200 MB, p-matrices: 3 MB" */
+std::ostream& operator<<(std::ostream& stream, const MemoryUsage& usage);
+
+class MemoryBudgetException : public RaxmlException
+{
+public:
+  MemoryBudgetException(const MemoryUsage& required, size_t limit);
+};
+
+/* Process-wide memory accounting: large data structures are charged to one of the categories
+ * above when they are created, and released when they are freed. If a memory limit is set,
+ * an allocation which would exceed it fails with MemoryBudgetException *before* the memory is
+ * actually allocated, instead of the process being killed by the OS later on.
+ *
+ * NB: with MPI, limit applies to each rank separately */
+class MemoryBudget
+{
+public:
+  /* 0 = no limit */
+  static void limit(size_t bytes) { _limit = bytes; }
+  static size_t limit() { return _limit; }
+
+  /* thread-safe */
+  static void allocate(const MemoryUsage& usage);
+  static void allocate(MemCategory cat, size_t bytes);
+  static void release(const MemoryUsage& usage);
+  static void release(MemCategory cat, size_t bytes);
+
+  static MemoryUsage used();
+  static size_t peak() { return _peak.load(); }
+
+  /* check whether additional memory fits into the budget (without allocating it) */
+  static bool fits(size_t bytes) { return !_limit || _total.load() + bytes <= _limit; }
+
+  static void reset();
+
+private:
+  static size_t _limit;
+  static std::array<std::atomic<size_t>, MEM_CATEGORY_COUNT> _used;
+  static std::atomic<size_t> _total;
+  static std::atomic<size_t> _peak;
+};
+
+/* estimated memory footprint of the data structures (not including the allocator overhead) */
+size_t msa_mem_size(const MSA& msa);
+size_t msa_mem_size(const PartitionedMSA& parted_msa);
+size_t tree_mem_size(size_t num_tips);
+
+/* CLVs, scalers, site repeat tables, p-matrices and tip buffers of a libpll partition, as
+ * allocated by pll_partition_create() with the given attributes */
+MemoryUsage pll_partition_mem_size(size_t tips, size_t clv_buffers, size_t states,
+                                   size_t sites, size_t prob_matrices, size_t rate_cats,
+                                   size_t scale_buffers, unsigned int attrs);
+
+#endif /* RAXML_MEMORYBUDGET_HPP_ */
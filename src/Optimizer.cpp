@@ -3,7 +3,8 @@
 using namespace std;
 
 Optimizer::Optimizer (const Options &opts) :
-    _lh_epsilon(opts.lh_epsilon), _spr_radius(opts.spr_radius), _spr_cutoff(opts.spr_cutoff)
+    _lh_epsilon(opts.lh_epsilon), _spr_radius(opts.spr_radius), _spr_cutoff(opts.spr_cutoff),
+    _terrace_sig(nullptr), _terrace_skips(0)
 {
 }
 
@@ -40,6 +41,32 @@ double Optimizer::optimize_model(TreeInfo& treeinfo, double lh_epsilon)
   return new_loglh;
 }
 
+double Optimizer::optimize_branches_spr(TreeInfo& treeinfo, double spr_loglh)
+{
+  /* NB: all threads/ranks have the same tree, so they all take the same decision */
+  uint64_t terrace_hash = 0;
+  if (_terrace_sig)
+  {
+    terrace_hash = _terrace_sig->hash(*treeinfo.pll_treeinfo().tree);
+
+    /* trees on a terrace have the same likelihood (given optimal branch lengths), and we
+     * already optimized branches on this one in an earlier round -> no real gain expected */
+    if (_optimized_terraces.count(terrace_hash))
+    {
+      _terrace_skips++;
+      return spr_loglh;
+    }
+  }
+
+  /* optimize ALL branches */
+  const double loglh = treeinfo.optimize_branches(_lh_epsilon, 1);
+
+  if (_terrace_sig)
+    _optimized_terraces.insert(terrace_hash);
+
+  return loglh;
+}
+
 double Optimizer::optimize_topology(TreeInfo& treeinfo, CheckpointManager& cm)
 {
   const double fast_modopt_eps = 10.;
@@ -164,6 +191,8 @@ double Optimizer::optimize_topology(TreeInfo& treeinfo, CheckpointManager& cm)
 
   double old_loglh;
 
+  _optimized_terraces.clear();
+
   if (do_step(CheckpointStep::fastSPR))
   {
     do
@@ -175,8 +204,7 @@ double Optimizer::optimize_topology(TreeInfo& treeinfo, CheckpointManager& cm)
           " spr round " << iter << " (radius: " << spr_params.radius_max << ")" << endl;
       loglh = treeinfo.spr_round(spr_params);
 
-      /* optimize ALL branches */
-      loglh = treeinfo.optimize_branches(_lh_epsilon, 1);
+      loglh = optimize_branches_spr(treeinfo, loglh);
     }
     while (loglh - old_loglh > _lh_epsilon);
   }
@@ -205,8 +233,7 @@ double Optimizer::optimize_topology(TreeInfo& treeinfo, CheckpointManager& cm)
           " spr round " << iter << " (radius: " << spr_params.radius_max << ")" << endl;
       loglh = treeinfo.spr_round(spr_params);
 
-      /* optimize ALL branches */
-      loglh = treeinfo.optimize_branches(_lh_epsilon, 1);
+      loglh = optimize_branches_spr(treeinfo, loglh);
 
       bool impr = (loglh - old_loglh > _lh_epsilon);
       if (impr)
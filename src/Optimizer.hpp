@@ -1,8 +1,11 @@
 #ifndef RAXML_OPTIMIZER_H_
 #define RAXML_OPTIMIZER_H_
 
+#include <unordered_set>
+
 #include "TreeInfo.hpp"
 #include "Checkpoint.hpp"
+#include "TerraceSignature.hpp"
 
 class Optimizer
 {
@@ -15,10 +18,21 @@ public:
   double optimize_model(TreeInfo& treeinfo) { return optimize_model(treeinfo, _lh_epsilon); };
   double optimize_topology(TreeInfo& treeinfo, CheckpointManager& cm);
   double evaluate(TreeInfo& treeinfo, CheckpointManager& cm);
+
+  /* enable terrace-aware search: SPR rounds which end on a terrace whose branch lengths were
+   * already fully optimized in an earlier round are not followed by branch length optimization */
+  void terrace_signature(const TerraceSignature * terrace_sig) { _terrace_sig = terrace_sig; }
+  size_t terrace_skips() const { return _terrace_skips; }
 private:
   double _lh_epsilon;
   int _spr_radius;
   double _spr_cutoff;
+
+  const TerraceSignature * _terrace_sig;
+  std::unordered_set<uint64_t> _optimized_terraces;
+  size_t _terrace_skips;
+
+  double optimize_branches_spr(TreeInfo& treeinfo, double spr_loglh);
 };
 
 #endif /* RAXML_OPTIMIZER_H_ */
@@ -32,6 +32,9 @@ void Options::set_default_outfiles()
   set_default_outfile(outfile_names.tbe_support_tree, "supportTBE");
   set_default_outfile(outfile_names.terrace, "terrace");
   set_default_outfile(outfile_names.binary_msa, "rba");
+  set_default_outfile(outfile_names.rfdist, "rfDistances");
+  set_default_outfile(outfile_names.trace, "trace.json");
+  set_default_outfile(outfile_names.events, "events.jsonl");
 }
 
 const std::string& Options::support_tree_file(BranchSupportMetric bsm) const
@@ -61,9 +64,9 @@ bool Options::result_files_exist() const
       return sysutil_file_exists(best_tree_file()) || sysutil_file_exists(best_model_file()) ||
              sysutil_file_exists(partition_trees_file());
     case Command::bootstrap:
-      return sysutil_file_exists(bootstrap_trees_file());
+      return bootstrap_trees_complete();
     case Command::all:
-      return sysutil_file_exists(best_tree_file()) || sysutil_file_exists(bootstrap_trees_file()) ||
+      return sysutil_file_exists(best_tree_file()) || bootstrap_trees_complete() ||
              sysutil_file_exists(support_tree_file()) || sysutil_file_exists(best_model_file()) ||
              sysutil_file_exists(partition_trees_file());
     case Command::support:
@@ -72,11 +75,20 @@ bool Options::result_files_exist() const
       return sysutil_file_exists(terrace_file());
     case Command::start:
       return sysutil_file_exists(start_tree_file());
+    case Command::rfdist:
+      return sysutil_file_exists(rfdist_file());
     default:
       return false;
   }
 }
 
+bool Options::bootstrap_trees_complete() const
+{
+  /* bootstrap trees are streamed to the file during the run: as long as the checkpoint
+   * exists, this file holds partial results which will be continued upon resume */
+  return sysutil_file_exists(bootstrap_trees_file()) && !sysutil_file_exists(checkp_file());
+}
+
 void Options::remove_result_files() const
 {
   if (command == Command::search || command == Command::all ||
@@ -90,11 +102,8 @@ void Options::remove_result_files() const
       std::remove(partition_trees_file().c_str());
   }
 
-  if (command == Command::bootstrap || command == Command::all)
-  {
-    if (sysutil_file_exists(bootstrap_trees_file()))
-      std::remove(bootstrap_trees_file().c_str());
-  }
+  /* NB: ML and bootstrap tree files are truncated by CheckpointManager, since on resume
+   * they already contain trees inferred in the previous run(s) */
   if (command == Command::support || command == Command::all)
   {
     if (sysutil_file_exists(support_tree_file()))
@@ -112,6 +121,12 @@ void Options::remove_result_files() const
     if (sysutil_file_exists(start_tree_file()))
       std::remove(start_tree_file().c_str());
   }
+
+  if (command == Command::rfdist)
+  {
+    if (sysutil_file_exists(rfdist_file()))
+      std::remove(rfdist_file().c_str());
+  }
 }
 
 string Options::simd_arch_name() const
@@ -177,6 +192,12 @@ std::ostream& operator<<(std::ostream& stream, const Options& opts)
     case Command::start:
       stream << "Starting tree generation";
       break;
+    case Command::rfdist:
+      stream << "Pairwise RF distance calculation";
+      break;
+    case Command::bench:
+      stream << "Likelihood kernel benchmark";
+      break;
     default:
       break;
   }
@@ -257,6 +278,8 @@ std::ostream& operator<<(std::ostream& stream, const Options& opts)
   stream << "  random seed: " << opts.random_seed << endl;
   stream << "  tip-inner: " << (opts.use_tip_inner ? "ON" : "OFF") << endl;
   stream << "  pattern compression: " << (opts.use_pattern_compression ? "ON" : "OFF") << endl;
+  if (opts.use_prob_msa && opts.prob_msa_digits > 0)
+    stream << "  state probabilities rounded to: " << opts.prob_msa_digits << " decimal places" << endl;
   stream << "  per-rate scalers: " << (opts.use_rate_scalers ? "ON" : "OFF") << endl;
   stream << "  site repeats: " << (opts.use_repeats ? "ON" : "OFF") << endl;
 
@@ -326,8 +349,13 @@ std::ostream& operator<<(std::ostream& stream, const Options& opts)
 
   if (opts.num_threads > 1)
     stream << ", thread pinning: " << (opts.thread_pinning ? "ON" : "OFF");
+  if (opts.bs_farm_ranks > 0)
+    stream << ", bootstrap farm: " << opts.bs_farm_ranks << " ranks per group";
   stream << endl;
 
+  if (opts.mem_limit > 0)
+    stream << "  memory limit: " << opts.mem_limit / (1024 * 1024) << " MB" << endl;
+
   stream << endl;
 
   return stream;
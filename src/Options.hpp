@@ -19,15 +19,19 @@ struct OutputFileNames
   std::string fbp_support_tree;
   std::string terrace;
   std::string binary_msa;
+  std::string rfdist;
+  std::string trace;
+  std::string events;
 };
 
 class Options
 {
 public:
   Options() : cmdline(""), command(Command::none), use_tip_inner(true),
-  use_pattern_compression(true), use_prob_msa(false), use_rate_scalers(false), use_repeats(true),
+  use_pattern_compression(true), use_prob_msa(false), prob_msa_digits(0),
+  use_rate_scalers(false), use_repeats(true),
   optimize_model(true), optimize_brlen(true), redo_mode(false), force_mode(false),
-  nofiles_mode(false),  log_level(LogLevel::progress),
+  nofiles_mode(false), trace_mode(false), stats_mode(false), events_mode(false), log_level(LogLevel::progress),
   msa_format(FileFormat::autodetect), data_type(DataType::autodetect),
   random_seed(0), start_trees(), lh_epsilon(DEF_LH_EPSILON), spr_radius(-1),
   spr_cutoff(1.0),
@@ -39,7 +43,8 @@ public:
   precision(RAXML_DEFAULT_PRECISION),
   tree_file(""), constraint_tree_file(""), msa_file(""), model_file(""), outfile_prefix(""),
   num_threads(1), num_ranks(1), simd_arch(PLL_ATTRIB_ARCH_CPU), thread_pinning(false),
-  load_balance_method(LoadBalancing::benoit)
+  load_balance_method(LoadBalancing::benoit), bs_farm_ranks(0), mem_limit(0),
+  bench_taxa(RAXML_BENCH_TAXA), bench_sites(RAXML_BENCH_SITES), bench_states(RAXML_BENCH_STATES)
   {};
 
   ~Options() = default;
@@ -51,6 +56,7 @@ public:
   bool use_tip_inner;
   bool use_pattern_compression;
   bool use_prob_msa;
+  unsigned int prob_msa_digits;         /* round state probabilities (0 = OFF) */
   bool use_rate_scalers;
   bool use_repeats;
 
@@ -60,6 +66,9 @@ public:
   bool redo_mode;
   bool force_mode;
   bool nofiles_mode;
+  bool trace_mode;
+  bool stats_mode;
+  bool events_mode;
 
   LogLevel log_level;
   FileFormat msa_format;
@@ -101,6 +110,13 @@ public:
   unsigned int simd_arch;               /* vector instruction set */
   bool thread_pinning;                     /* pin threads to cores */
   LoadBalancing load_balance_method;
+  unsigned int bs_farm_ranks;           /* MPI ranks per bootstrap worker group (0 = OFF) */
+  size_t mem_limit;                     /* memory limit per MPI rank in bytes (0 = OFF) */
+
+  /* synthetic dataset for the kernel benchmark (used if no MSA is given) */
+  unsigned int bench_taxa;
+  unsigned int bench_sites;
+  unsigned int bench_states;
 
   std::string simd_arch_name() const;
 
@@ -117,11 +133,15 @@ public:
   const std::string& support_tree_file(BranchSupportMetric bsm = BranchSupportMetric::fbp) const;
   const std::string& terrace_file() const { return outfile_names.terrace; }
   const std::string& binary_msa_file() const { return outfile_names.binary_msa; }
+  const std::string& rfdist_file() const { return outfile_names.rfdist; }
+  const std::string& trace_file() const { return outfile_names.trace; }
+  const std::string& events_file() const { return outfile_names.events; }
 
   void set_default_outfiles();
 
   bool result_files_exist() const;
   void remove_result_files() const;
+  bool bootstrap_trees_complete() const;
 
 private:
   void set_default_outfile(std::string& fname, const std::string& suffix);
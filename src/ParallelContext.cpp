@@ -1,27 +1,95 @@
+#include <chrono>
+#include <limits>
+
 #include "ParallelContext.hpp"
 
 #include "Options.hpp"
+#include "Tracer.hpp"
+#include "EventLog.hpp"
 
 using namespace std;
 
 // This is just a default size; the buffer will be resized later according to #part and #threads
 #define PARALLEL_BUF_SIZE (128 * 1024)
 
-size_t ParallelContext::_num_threads = 1;
-size_t ParallelContext::_num_ranks = 1;
 size_t ParallelContext::_num_nodes = 1;
-size_t ParallelContext::_rank_id = 0;
-thread_local size_t ParallelContext::_thread_id = 0;
+size_t ParallelContext::_world_rank_id = 0;
+size_t ParallelContext::_num_world_ranks = 1;
+size_t ParallelContext::_num_groups = 0;
+size_t ParallelContext::_group_id = 0;
+size_t ParallelContext::_group_size = 0;
 std::vector<ThreadType> ParallelContext::_threads;
-std::vector<char> ParallelContext::_parallel_buf;
-std::unordered_map<ThreadIDType, ParallelContext> ParallelContext::_thread_ctx_map;
+std::unique_ptr<ParallelContext> ParallelContext::_group_ctx;
 MutexType ParallelContext::mtx;
 
 #ifdef _RAXML_MPI
-MPI_Comm ParallelContext::_comm = MPI_COMM_WORLD;
 bool ParallelContext::_owns_comm = true;
 #endif
 
+ParallelContext ParallelContext::_world;
+thread_local ParallelContext * ParallelContext::_ctx = &ParallelContext::_world;
+thread_local size_t ParallelContext::_thread_id = 0;
+#ifdef _RAXML_PTHREADS
+/* only the process' main thread and the workers from init_pthreads() own a world thread id;
+ * any other thread (e.g. ThreadScope threads in the kernel benchmark) is never the master */
+static const std::thread::id main_thread_id = std::this_thread::get_id();
+thread_local size_t ParallelContext::_world_thread_id =
+    std::this_thread::get_id() == main_thread_id ? 0 : ParallelContext::NO_WORLD_THREAD;
+#else
+thread_local size_t ParallelContext::_world_thread_id = 0;
+#endif
+thread_local double ParallelContext::_barrier_wait_time = 0.;
+
+ParallelContext::ParallelContext() : _num_threads(1), _num_ranks(1), _rank_id(0),
+    _barrier_counter(0), _barrier_cycle(0)
+#ifdef _RAXML_PTHREADS
+    , _sleep_counter(0), _sleep_cycle(0)
+#endif
+{
+#ifdef _RAXML_MPI
+  _comm = MPI_COMM_WORLD;
+#endif
+}
+
+ParallelContext::ParallelContext(size_t num_threads, void * comm) : _num_threads(num_threads),
+    _num_ranks(1), _rank_id(0), _barrier_counter(0), _barrier_cycle(0)
+#ifdef _RAXML_PTHREADS
+    , _sleep_counter(0), _sleep_cycle(0)
+#endif
+{
+  _parallel_buf.reserve(std::max<size_t>(PARALLEL_BUF_SIZE, _world._parallel_buf.capacity()));
+
+#ifdef _RAXML_MPI
+  _comm = comm ? *((MPI_Comm*) comm) : MPI_COMM_SELF;
+
+  int initialized;
+  MPI_Initialized(&initialized);
+  if (initialized)
+  {
+    int tmp;
+    MPI_Comm_rank(_comm, &tmp);
+    _rank_id = (size_t) tmp;
+    MPI_Comm_size(_comm, &tmp);
+    _num_ranks = (size_t) tmp;
+  }
+#else
+  RAXML_UNUSED(comm);
+#endif
+}
+
+ParallelContext::ThreadScope::ThreadScope(ParallelContext& ctx, size_t thread_id) :
+    _prev_ctx(_ctx), _prev_thread_id(_thread_id)
+{
+  assert(thread_id < ctx._num_threads);
+  _ctx = &ctx;
+  _thread_id = thread_id;
+}
+
+ParallelContext::ThreadScope::~ThreadScope()
+{
+  _ctx = _prev_ctx;
+  _thread_id = _prev_thread_id;
+}
 
 void ParallelContext::init_mpi(int argc, char * argv[], void * comm)
 {
@@ -29,25 +97,25 @@ void ParallelContext::init_mpi(int argc, char * argv[], void * comm)
   {
     int tmp;
 
-    _parallel_buf.reserve(PARALLEL_BUF_SIZE);
+    _world._parallel_buf.reserve(PARALLEL_BUF_SIZE);
 
     if (comm)
     {
       // TODO we should think how to get rid of this ugly cast!
-      _comm = *((MPI_Comm*) comm);
+      _world._comm = *((MPI_Comm*) comm);
       _owns_comm = false;
     }
     else
     {
-      _comm = MPI_COMM_WORLD;
+      _world._comm = MPI_COMM_WORLD;
       _owns_comm = true;
       MPI_Init(&argc, &argv);
     }
 
-    MPI_Comm_rank(_comm, &tmp);
-    _rank_id = (size_t) tmp;
-    MPI_Comm_size(_comm, &tmp);
-    _num_ranks = (size_t) tmp;
+    MPI_Comm_rank(_world._comm, &tmp);
+    _world._rank_id = _world_rank_id = (size_t) tmp;
+    MPI_Comm_size(_world._comm, &tmp);
+    _world._num_ranks = _num_world_ranks = (size_t) tmp;
 //    printf("size: %lu, rank: %lu\n", _num_ranks, _rank_id);
 
     detect_num_nodes();
@@ -62,7 +130,8 @@ void ParallelContext::init_mpi(int argc, char * argv[], void * comm)
 
 void ParallelContext::start_thread(size_t thread_id, const std::function<void()>& thread_main)
 {
-  ParallelContext::_thread_id = thread_id;
+  _ctx = &_world;
+  _thread_id = _world_thread_id = thread_id;
   thread_main();
 }
 
@@ -86,14 +155,14 @@ static void pin_thread(size_t core_id, pthread_t thread)
 
 void ParallelContext::init_pthreads(const Options& opts, const std::function<void()>& thread_main)
 {
-  _num_threads = opts.num_threads;
-  _parallel_buf.reserve(PARALLEL_BUF_SIZE);
+  _world._num_threads = opts.num_threads;
+  _world._parallel_buf.reserve(PARALLEL_BUF_SIZE);
 
 #ifdef _RAXML_PTHREADS
   /* Launch threads */
-  if (opts.thread_pinning && _num_threads > 1)
+  if (opts.thread_pinning && _world._num_threads > 1)
     pin_thread(0, pthread_self());
-  for (size_t i = 1; i < _num_threads; ++i)
+  for (size_t i = 1; i < _world._num_threads; ++i)
   {
     _threads.emplace_back(ParallelContext::start_thread, i, thread_main);
 
@@ -106,7 +175,7 @@ void ParallelContext::init_pthreads(const Options& opts, const std::function<voi
 void ParallelContext::detect_num_nodes()
 {
 #ifdef _RAXML_MPI
-  if (_num_ranks > 1)
+  if (_num_world_ranks > 1)
   {
     int len;
     char name[MPI_MAX_PROCESSOR_NAME];
@@ -123,7 +192,7 @@ void ParallelContext::detect_num_nodes()
         {
           assert((size_t) len < buf_size);
           memcpy(buf, name, (len+1) * sizeof(char));
-          return len;
+          return len+1;
         };
 
     /* receive callback -> master rank: collect host names */
@@ -139,7 +208,7 @@ void ParallelContext::detect_num_nodes()
     _num_nodes = node_names.size();
 
     /* broadcast number of nodes from master */
-    MPI_Bcast(&_num_nodes, sizeof(size_t), MPI_BYTE, 0, _comm);
+    MPI_Bcast(&_num_nodes, sizeof(size_t), MPI_BYTE, 0, _world._comm);
   }
   else
     _num_nodes = 1;
@@ -150,7 +219,16 @@ void ParallelContext::detect_num_nodes()
 
 void ParallelContext::resize_buffer(size_t size)
 {
-  _parallel_buf.reserve(size);
+  _ctx->_parallel_buf.reserve(size);
+}
+
+void ParallelContext::join_threads()
+{
+#ifdef _RAXML_PTHREADS
+  for (thread& t: _threads)
+    t.join();
+  _threads.clear();
+#endif
 }
 
 void ParallelContext::finalize(bool force)
@@ -170,14 +248,14 @@ void ParallelContext::finalize(bool force)
   if (_owns_comm)
   {
     if (force)
-      MPI_Abort(_comm, -1);
+      MPI_Abort(_world._comm, -1);
     else
-      MPI_Barrier(_comm);
+      MPI_Barrier(_world._comm);
 
     MPI_Finalize();
   }
   else
-    MPI_Barrier(_comm);
+    MPI_Barrier(_world._comm);
 #endif
 }
 
@@ -195,30 +273,57 @@ void ParallelContext::barrier()
 void ParallelContext::mpi_barrier()
 {
 #ifdef _RAXML_MPI
-  if (_thread_id == 0 && _num_ranks > 1)
-    MPI_Barrier(_comm);
+  if (_thread_id == 0 && _ctx->_num_ranks > 1)
+    MPI_Barrier(_ctx->_comm);
 #endif
 }
 
 void ParallelContext::thread_barrier()
 {
-  static volatile unsigned int barrier_counter = 0;
-  static thread_local volatile int myCycle = 0;
-  static volatile int proceed = 0;
+  /* sense-reversing barrier: last thread to arrive starts a new cycle */
+  auto& ctx = *_ctx;
+  if (ctx._num_threads == 1)
+    return;
 
-  __sync_fetch_and_add( &barrier_counter, 1);
+  RAXML_TRACE_SPAN("thread_barrier");
+  const size_t cycle = ctx._barrier_cycle.load();
 
-  if(_thread_id == 0)
+  if (ctx._barrier_counter.fetch_add(1) + 1 == ctx._num_threads)
   {
-    while(barrier_counter != ParallelContext::_num_threads);
-    barrier_counter = 0;
-    proceed = !proceed;
+    ctx._barrier_counter = 0;
+    ctx._barrier_cycle.fetch_add(1);
+  }
+  else if (EventLog::enabled())
+  {
+    /* only waiting threads take the time, so the last one to arrive is not delayed */
+    const auto start = chrono::steady_clock::now();
+    while (ctx._barrier_cycle.load() == cycle);
+    _barrier_wait_time += chrono::duration<double>(chrono::steady_clock::now() - start).count();
   }
   else
+    while (ctx._barrier_cycle.load() == cycle);
+}
+
+void ParallelContext::thread_sleep_barrier()
+{
+#ifdef _RAXML_PTHREADS
+  auto& ctx = *_ctx;
+  if (ctx._num_threads == 1)
+    return;
+
+  RAXML_TRACE_SPAN("thread_sleep_barrier");
+  std::unique_lock<std::mutex> lock(ctx._sleep_mutex);
+  const size_t cycle = ctx._sleep_cycle;
+
+  if (++ctx._sleep_counter == ctx._num_threads)
   {
-    while(myCycle == proceed);
-    myCycle = !myCycle;
+    ctx._sleep_counter = 0;
+    ctx._sleep_cycle++;
+    ctx._sleep_cv.notify_all();
   }
+  else
+    ctx._sleep_cv.wait(lock, [&ctx, cycle]() { return ctx._sleep_cycle != cycle; });
+#endif
 }
 
 void ParallelContext::thread_reduce(double * data, size_t size, int op)
@@ -226,7 +331,8 @@ void ParallelContext::thread_reduce(double * data, size_t size, int op)
   /* synchronize */
   thread_barrier();
 
-  double *double_buf = (double*) _parallel_buf.data();
+  const size_t num_threads = _ctx->_num_threads;
+  double *double_buf = (double*) _ctx->_parallel_buf.data();
 
   /* collect data from threads */
   size_t i, j;
@@ -244,21 +350,21 @@ void ParallelContext::thread_reduce(double * data, size_t size, int op)
       case PLLMOD_COMMON_REDUCE_SUM:
       {
         data[i] = 0.;
-        for (j = 0; j < ParallelContext::_num_threads; ++j)
+        for (j = 0; j < num_threads; ++j)
           data[i] += double_buf[j * size + i];
       }
       break;
       case PLLMOD_COMMON_REDUCE_MAX:
       {
         data[i] = double_buf[i];
-        for (j = 1; j < ParallelContext::_num_threads; ++j)
+        for (j = 1; j < num_threads; ++j)
           data[i] = max(data[i], double_buf[j * size + i]);
       }
       break;
       case PLLMOD_COMMON_REDUCE_MIN:
       {
         data[i] = double_buf[i];
-        for (j = 1; j < ParallelContext::_num_threads; ++j)
+        for (j = 1; j < num_threads; ++j)
           data[i] = min(data[i], double_buf[j * size + i]);
       }
       break;
@@ -270,15 +376,18 @@ void ParallelContext::thread_reduce(double * data, size_t size, int op)
 }
 
 
-void ParallelContext::parallel_reduce(double * data, size_t size, int op)
+void ParallelContext::parallel_reduce(ParallelContext& ctx, double * data, size_t size, int op)
 {
+  /* reduction is only possible within the context the calling thread is bound to */
+  assert(&ctx == _ctx);
+
 #ifdef _RAXML_PTHREADS
-  if (_num_threads > 1)
+  if (ctx._num_threads > 1)
     thread_reduce(data, size, op);
 #endif
 
 #ifdef _RAXML_MPI
-  if (_num_ranks > 1)
+  if (ctx._num_ranks > 1)
   {
     thread_barrier();
 
@@ -295,15 +404,16 @@ void ParallelContext::parallel_reduce(double * data, size_t size, int op)
         assert(0);
 
 #if 1
-      MPI_Allreduce(MPI_IN_PLACE, data, size, MPI_DOUBLE, reduce_op, _comm);
+      RAXML_TRACE_SPAN("mpi_allreduce");
+      MPI_Allreduce(MPI_IN_PLACE, data, size, MPI_DOUBLE, reduce_op, ctx._comm);
 #else
       // not sure if MPI_IN_PLACE will work in all cases...
-      MPI_Allreduce(data, _parallel_buf.data(), size, MPI_DOUBLE, reduce_op, _comm);
-      memcpy(data, _parallel_buf.data(), size * sizeof(double));
+      MPI_Allreduce(data, ctx._parallel_buf.data(), size, MPI_DOUBLE, reduce_op, ctx._comm);
+      memcpy(data, ctx._parallel_buf.data(), size * sizeof(double));
 #endif
     }
 
-    if (_num_threads > 1)
+    if (ctx._num_threads > 1)
       thread_broadcast(0, data, size * sizeof(double));
   }
 #endif
@@ -311,16 +421,19 @@ void ParallelContext::parallel_reduce(double * data, size_t size, int op)
 
 void ParallelContext::parallel_reduce_cb(void * context, double * data, size_t size, int op)
 {
-  ParallelContext::parallel_reduce(data, size, op);
-  RAXML_UNUSED(context);
+  auto ctx = context ? (ParallelContext *) context : _ctx;
+  ParallelContext::parallel_reduce(*ctx, data, size, op);
 }
 
 void ParallelContext::thread_broadcast(size_t source_id, void * data, size_t size)
 {
+  /* make sure the buffer is not in use anymore (e.g. by preceding thread_reduce) */
+  thread_barrier();
+
   /* write to buf */
   if (_thread_id == source_id)
   {
-    memcpy((void *) _parallel_buf.data(), data, size);
+    memcpy((void *) _ctx->_parallel_buf.data(), data, size);
   }
 
   /* synchronize */
@@ -332,7 +445,7 @@ void ParallelContext::thread_broadcast(size_t source_id, void * data, size_t siz
   /* read from buf*/
   if (_thread_id != source_id)
   {
-    memcpy(data, (void *) _parallel_buf.data(), size);
+    memcpy(data, (void *) _ctx->_parallel_buf.data(), size);
   }
 
   thread_barrier();
@@ -343,7 +456,7 @@ void ParallelContext::thread_send_master(size_t source_id, void * data, size_t s
   /* write to buf */
   if (_thread_id == source_id && data && size)
   {
-    memcpy((void *) _parallel_buf.data(), data, size);
+    memcpy((void *) _ctx->_parallel_buf.data(), data, size);
   }
 
   /* synchronize */
@@ -355,7 +468,7 @@ void ParallelContext::thread_send_master(size_t source_id, void * data, size_t s
   /* read from buf*/
   if (_thread_id == 0)
   {
-    memcpy(data, (void *) _parallel_buf.data(), size);
+    memcpy(data, (void *) _ctx->_parallel_buf.data(), size);
   }
 
   barrier();
@@ -365,34 +478,66 @@ void ParallelContext::mpi_gather_custom(std::function<int(void*,int)> prepare_se
                                         std::function<void(void*,int)> process_recv_cb)
 {
 #ifdef _RAXML_MPI
-  /* we're gonna use _parallel_buf, so make sure other threads don't interfere... */
-  UniqueLock lock;
+  /* collective operation: must be called by the master threads of all ranks */
+  assert(_thread_id == 0);
+
+  auto& ctx = *_ctx;
 
-  if (_rank_id == 0)
+  /* worker ranks: serialize data, enlarging the buffer if needed (MPI message size is an int) */
+  std::vector<char> buf;
+  int send_size = 0;
+  if (ctx._rank_id > 0)
+    buf.resize(std::max<size_t>(PARALLEL_BUF_SIZE, ctx._parallel_buf.capacity()));
+  while (ctx._rank_id > 0)
   {
-    for (size_t r = 1; r < _num_ranks; ++r)
+    try
     {
-      int recv_size;
-      MPI_Status status;
-      MPI_Probe(r, 0, _comm, &status);
-      MPI_Get_count(&status, MPI_BYTE, &recv_size);
-
-//      printf("recv: %lu\n", recv_size);
+      send_size = prepare_send_cb(buf.data(), (int) buf.size());
+      break;
+    }
+    catch (out_of_range&)
+    {
+      if (buf.size() > (size_t) std::numeric_limits<int>::max() / 2)
+        throw runtime_error("MPI message size limit exceeded");
+      buf.resize(2 * buf.size());
+    }
+  }
 
-      _parallel_buf.reserve(recv_size);
+  /* master rank: collect message sizes first, then the messages themselves */
+  std::vector<int> recv_sizes;
+  std::vector<int> displs;
+  std::vector<char> recv_buf;
+  if (ctx._rank_id == 0)
+  {
+    recv_sizes.resize(ctx._num_ranks);
+    displs.resize(ctx._num_ranks);
+  }
 
-      MPI_Recv((void*) _parallel_buf.data(), recv_size, MPI_BYTE,
-               r, 0, _comm, MPI_STATUS_IGNORE);
+  MPI_Gather(&send_size, 1, MPI_INT, recv_sizes.data(), 1, MPI_INT, 0, ctx._comm);
 
-      process_recv_cb(_parallel_buf.data(), recv_size);
+  if (ctx._rank_id == 0)
+  {
+    size_t total_size = 0;
+    for (size_t r = 0; r < ctx._num_ranks; ++r)
+    {
+      displs[r] = (int) total_size;
+      total_size += recv_sizes[r];
+      if (total_size > (size_t) std::numeric_limits<int>::max())
+        throw runtime_error("MPI message size limit exceeded");
     }
+    recv_buf.resize(total_size);
   }
-  else
-  {
-    auto send_size = prepare_send_cb(_parallel_buf.data(), _parallel_buf.capacity());
-//    printf("sent: %lu\n", send_size);
 
-    MPI_Send(_parallel_buf.data(), send_size, MPI_BYTE, 0, 0, _comm);
+  MPI_Gatherv(buf.data(), send_size, MPI_BYTE, recv_buf.data(), recv_sizes.data(),
+              displs.data(), MPI_BYTE, 0, ctx._comm);
+
+  if (ctx._rank_id == 0)
+  {
+    for (size_t r = 1; r < ctx._num_ranks; ++r)
+    {
+      if (recv_sizes[r] > 0)
+        process_recv_cb(recv_buf.data() + displs[r], recv_sizes[r]);
+    }
   }
 #else
   RAXML_UNUSED(prepare_send_cb);
@@ -400,3 +545,132 @@ void ParallelContext::mpi_gather_custom(std::function<int(void*,int)> prepare_se
 #endif
 }
 
+void ParallelContext::broadcast(void * data, size_t size)
+{
+#ifdef _RAXML_MPI
+  if (_ctx->_num_ranks > 1)
+  {
+    thread_barrier();
+
+    if (_thread_id == 0)
+      MPI_Bcast(data, size, MPI_BYTE, 0, _ctx->_comm);
+  }
+#endif
+
+  if (_ctx->_num_threads > 1)
+    thread_broadcast(0, data, size);
+}
+
+void ParallelContext::split_rank_groups(size_t group_size)
+{
+  assert(_ctx == &_world);
+
+  thread_barrier();
+
+#ifdef _RAXML_MPI
+  if (_thread_id == 0)
+  {
+    assert(_num_world_ranks > 1 && !_num_groups);
+
+    const size_t num_workers = _num_world_ranks - 1;
+    _group_size = std::max<size_t>(1, std::min(group_size, num_workers));
+    _num_groups = (num_workers + _group_size - 1) / _group_size;
+
+    /* coordinator gets a communicator of its own */
+    _group_id = _world_rank_id > 0 ? (_world_rank_id - 1) / _group_size : _num_groups;
+
+    MPI_Comm group_comm;
+    MPI_Comm_split(_world._comm, (int) _group_id, (int) _world_rank_id, &group_comm);
+    _group_ctx.reset(new ParallelContext(_world._num_threads, &group_comm));
+  }
+#else
+  RAXML_UNUSED(group_size);
+#endif
+
+  thread_barrier();
+
+  if (_group_ctx)
+    _ctx = _group_ctx.get();
+}
+
+void ParallelContext::join_rank_groups()
+{
+  thread_barrier();
+
+  _ctx = &_world;
+
+  thread_barrier();
+
+#ifdef _RAXML_MPI
+  if (_thread_id == 0 && _group_ctx)
+  {
+    MPI_Comm_free(&_group_ctx->_comm);
+    _group_ctx.reset(nullptr);
+    _num_groups = _group_id = _group_size = 0;
+  }
+#endif
+
+  thread_barrier();
+}
+
+void ParallelContext::mpi_send(size_t dest_rank, int tag, const void * data, size_t size)
+{
+#ifdef _RAXML_MPI
+  assert(_thread_id == 0);
+  MPI_Send((void *) data, size, MPI_BYTE, dest_rank, tag, _world._comm);
+#else
+  RAXML_UNUSED(dest_rank);
+  RAXML_UNUSED(tag);
+  RAXML_UNUSED(data);
+  RAXML_UNUSED(size);
+#endif
+}
+
+bool ParallelContext::mpi_recv(size_t& source_rank, int& tag, std::vector<char>& buf, bool wait)
+{
+#ifdef _RAXML_MPI
+  assert(_thread_id == 0);
+
+  MPI_Status status;
+  if (wait)
+    MPI_Probe(MPI_ANY_SOURCE, MPI_ANY_TAG, _world._comm, &status);
+  else
+  {
+    int flag;
+    MPI_Iprobe(MPI_ANY_SOURCE, MPI_ANY_TAG, _world._comm, &flag, &status);
+    if (!flag)
+      return false;
+  }
+
+  int recv_size;
+  MPI_Get_count(&status, MPI_BYTE, &recv_size);
+  buf.resize(recv_size);
+
+  MPI_Recv(buf.data(), recv_size, MPI_BYTE, status.MPI_SOURCE, status.MPI_TAG, _world._comm,
+           MPI_STATUS_IGNORE);
+
+  source_rank = (size_t) status.MPI_SOURCE;
+  tag = status.MPI_TAG;
+
+  return true;
+#else
+  RAXML_UNUSED(source_rank);
+  RAXML_UNUSED(tag);
+  RAXML_UNUSED(buf);
+  RAXML_UNUSED(wait);
+  return false;
+#endif
+}
+
+void ParallelContext::mpi_recv(size_t source_rank, int tag, void * data, size_t size)
+{
+#ifdef _RAXML_MPI
+  assert(_thread_id == 0);
+  MPI_Recv(data, size, MPI_BYTE, source_rank, tag, _world._comm, MPI_STATUS_IGNORE);
+#else
+  RAXML_UNUSED(source_rank);
+  RAXML_UNUSED(tag);
+  RAXML_UNUSED(data);
+  RAXML_UNUSED(size);
+#endif
+}
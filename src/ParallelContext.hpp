@@ -6,6 +6,7 @@
 #include <memory>
 
 #include <functional>
+#include <atomic>
 
 #ifdef _RAXML_MPI
 #include <mpi.h>
@@ -14,6 +15,7 @@
 #ifdef _RAXML_PTHREADS
 #include <thread>
 #include <mutex>
+#include <condition_variable>
 typedef std::thread ThreadType;
 typedef std::thread::id ThreadIDType;
 typedef std::mutex MutexType;
@@ -27,45 +29,97 @@ typedef int LockType;
 
 class Options;
 
+/* Parallel context = group of threads and MPI ranks which work together on one task: each
+ * context has its own communicator, thread barrier and reduction buffer. By default, all threads
+ * are bound to the world context (all threads of all ranks), but they can be re-bound to a
+ * sub-context to run independent tasks (e.g. searches) in separate thread/rank groups.
+ *
+ * NB: static methods below always refer to the context of the calling thread, i.e.
+ * num_procs(), num_ranks(), proc_id() etc. describe the current thread/rank group */
 class ParallelContext
 {
 public:
+  /* new context for num_threads threads and the ranks of comm (MPI_Comm*, nullptr = this rank) */
+  ParallelContext(size_t num_threads, void * comm = nullptr);
+  ~ParallelContext() = default;
+
+  /* no copying/moving */
+  ParallelContext(const ParallelContext& other) = delete;
+  ParallelContext(ParallelContext&& other) = delete;
+  ParallelContext& operator=(const ParallelContext& other) = delete;
+  ParallelContext& operator=(ParallelContext&& other) = delete;
+
   static void init_mpi(int argc, char * argv[], void * comm);
   static void init_pthreads(const Options& opts, const std::function<void()>& thread_main);
   static void resize_buffer(size_t size);
 
+  static void join_threads();
   static void finalize(bool force = false);
 
-  static size_t num_procs() { return _num_ranks * _num_threads; }
-  static size_t num_threads() { return _num_threads; }
-  static size_t num_ranks() { return _num_ranks; }
+  static ParallelContext& world() { return _world; }
+  static ParallelContext& current() { return *_ctx; }
+
+  static size_t num_procs() { return _ctx->_num_ranks * _ctx->_num_threads; }
+  static size_t num_threads() { return _ctx->_num_threads; }
+  static size_t num_ranks() { return _ctx->_num_ranks; }
+  static size_t num_world_ranks() { return _num_world_ranks; }
   static size_t num_nodes() { return _num_nodes; }
-  static size_t ranks_per_node() { return _num_ranks / _num_nodes; }
+  static size_t ranks_per_node() { return _num_world_ranks / _num_nodes; }
 
+  /* context = ParallelContext* (nullptr = context of the calling thread) */
   static void parallel_reduce_cb(void * context, double * data, size_t size, int op);
   static void thread_reduce(double * data, size_t size, int op);
   static void thread_broadcast(size_t source_id, void * data, size_t size);
   void thread_send_master(size_t source_id, void * data, size_t size) const;
 
+  /* collect data from all ranks at the master rank (master threads only): prepare_send_cb
+   * serializes data on worker ranks (throws std::out_of_range if buffer is too small),
+   * process_recv_cb is called on master rank once per worker rank */
   static void mpi_gather_custom(std::function<int(void*,int)> prepare_send_cb,
                                 std::function<void(void*,int)> process_recv_cb);
 
-  static bool master() { return proc_id() == 0; }
-  static bool master_rank() { return _rank_id == 0; }
+  /* broadcast from the master of the current rank group to all its threads and ranks */
+  static void broadcast(void * data, size_t size);
+
+  /* Rank groups for independent tasks ("farm" mode): rank 0 becomes the coordinator,
+   * all other ranks are split into groups of group_size ranks, and all threads are bound to
+   * the context of their rank group. Must be called by all threads of all ranks. */
+  static void split_rank_groups(size_t group_size);
+  static void join_rank_groups();
+  static size_t num_groups() { return _num_groups; }
+  static size_t group_id() { return _group_id; }
+  static bool coordinator() { return _num_groups > 0 && _world_rank_id == 0; }
+  static size_t group_master_rank(size_t group_id) { return 1 + group_id * _group_size; }
+
+  /* point-to-point messages between the ranks (world communicator, master thread only) */
+  static void mpi_send(size_t dest_rank, int tag, const void * data, size_t size);
+  static bool mpi_recv(size_t& source_rank, int& tag, std::vector<char>& buf, bool wait);
+  static void mpi_recv(size_t source_rank, int tag, void * data, size_t size);
+
+  /* world thread id of threads not started by ParallelContext */
+  static const size_t NO_WORLD_THREAD = (size_t) -1;
+
+  /* NB: master process (I/O, logging) is always the first thread of world rank 0 */
+  static bool master() { return _world_rank_id == 0 && _world_thread_id == 0; }
+  static bool master_rank() { return _world_rank_id == 0; }
   static bool master_thread() { return _thread_id == 0; }
+  static bool group_master() { return _ctx->_rank_id == 0 && _thread_id == 0; }
   static size_t thread_id() { return _thread_id; }
-  static size_t proc_id() { return _rank_id * _num_threads + _thread_id; }
+  static size_t world_thread_id() { return _world_thread_id; }
+  static size_t world_rank_id() { return _world_rank_id; }
+  static size_t proc_id() { return _ctx->_rank_id * _ctx->_num_threads + _thread_id; }
 
   static void barrier();
   static void thread_barrier();
   static void mpi_barrier();
 
-  /* static singleton, no instantiation/copying/moving */
-  ParallelContext() = delete;
-  ParallelContext(const ParallelContext& other) = delete;
-  ParallelContext(ParallelContext&& other) = delete;
-  ParallelContext& operator=(const ParallelContext& other) = delete;
-  ParallelContext& operator=(ParallelContext&& other) = delete;
+  /* thread barrier which puts the waiting threads to sleep instead of spinning: for threads
+   * which have to wait for a long time (e.g. while only the master thread is working) */
+  static void thread_sleep_barrier();
+
+  /* total time (in seconds) the calling thread spent waiting in thread_barrier(),
+   * only measured if the event log is enabled */
+  static double barrier_wait_time() { return _barrier_wait_time; }
 
   class UniqueLock
   {
@@ -74,25 +128,66 @@ public:
   private:
     LockType _lock;
   };
+
+  /* binds the calling thread to ctx under the given thread id, until going out of scope */
+  class ThreadScope
+  {
+  public:
+    ThreadScope(ParallelContext& ctx, size_t thread_id);
+    ~ThreadScope();
+
+    ThreadScope(const ThreadScope& other) = delete;
+    ThreadScope& operator=(const ThreadScope& other) = delete;
+  private:
+    ParallelContext * _prev_ctx;
+    size_t _prev_thread_id;
+  };
 private:
+  /* per-context state */
+  size_t _num_threads;
+  size_t _num_ranks;
+  size_t _rank_id;
+  std::vector<char> _parallel_buf;
+  std::atomic<size_t> _barrier_counter;
+  std::atomic<size_t> _barrier_cycle;
+
+#ifdef _RAXML_PTHREADS
+  std::mutex _sleep_mutex;
+  std::condition_variable _sleep_cv;
+  size_t _sleep_counter;
+  size_t _sleep_cycle;
+#endif
+
+#ifdef _RAXML_MPI
+  MPI_Comm _comm;
+#endif
+
+  /* process-wide state */
+  static ParallelContext _world;
+  static std::unique_ptr<ParallelContext> _group_ctx;
   static std::vector<ThreadType> _threads;
-  static size_t _num_threads;
-  static size_t _num_ranks;
   static size_t _num_nodes;
-  static std::vector<char> _parallel_buf;
-  static std::unordered_map<ThreadIDType, ParallelContext> _thread_ctx_map;
   static MutexType mtx;
 
-  static size_t _rank_id;
+  static thread_local ParallelContext * _ctx;
   static thread_local size_t _thread_id;
+  static thread_local size_t _world_thread_id;
+  static thread_local double _barrier_wait_time;
+
+  static size_t _world_rank_id;
+  static size_t _num_world_ranks;
+  static size_t _num_groups;
+  static size_t _group_id;
+  static size_t _group_size;
 
 #ifdef _RAXML_MPI
   static bool _owns_comm;
-  static MPI_Comm _comm;
 #endif
 
+  ParallelContext();
+
   static void start_thread(size_t thread_id, const std::function<void()>& thread_main);
-  static void parallel_reduce(double * data, size_t size, int op);
+  static void parallel_reduce(ParallelContext& ctx, double * data, size_t size, int op);
   static void detect_num_nodes();
 };
 
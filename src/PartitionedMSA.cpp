@@ -12,17 +12,16 @@ PartitionedMSA& PartitionedMSA::operator=(PartitionedMSA&& other)
   _part_list = std::move(other._part_list);
   _full_msa = std::move(other._full_msa);
   _taxon_names = std::move(other._taxon_names);
-  _taxon_id_map = std::move(other._taxon_id_map);
+  _taxon_index = std::move(other._taxon_index);
    return *this;
 }
 
 void PartitionedMSA::set_taxon_names(const NameList& taxon_names)
 {
   _taxon_names.assign(taxon_names.cbegin(), taxon_names.cend());
-  for (size_t i = 0; i < _taxon_names.size(); ++i)
-    _taxon_id_map[_taxon_names[i]] = i;
+  _taxon_index = TaxonIndex(_taxon_names);
 
-  assert(_taxon_names.size() == taxon_names.size() && _taxon_id_map.size() == taxon_names.size());
+  assert(_taxon_names.size() == taxon_names.size());
 }
 
 std::vector<unsigned int> PartitionedMSA::get_site_part_assignment()
@@ -83,6 +82,10 @@ void PartitionedMSA::split_msa()
       pll_msa_destroy(part_msa_list[p]);
     }
     free(part_msa_list);
+
+    /* pllmod_msa_split() only handles sequences, so state probabilities must be copied here */
+    if (_full_msa.probabilistic())
+      split_probs(site_part);
   }
   else
   {
@@ -92,6 +95,27 @@ void PartitionedMSA::split_msa()
   }
 }
 
+void PartitionedMSA::split_probs(const std::vector<unsigned int>& site_part)
+{
+  const auto states = _full_msa.states();
+  for (auto& pinfo: _part_list)
+    pinfo.msa().states(states);
+
+  /* sites are assigned to partitions in the same order as in pllmod_msa_split() */
+  std::vector<size_t> part_site(part_count());
+  for (size_t j = 0; j < _full_msa.size(); ++j)
+  {
+    std::fill(part_site.begin(), part_site.end(), 0);
+    auto src = _full_msa.probs(j, 0);
+    for (size_t i = 0; i < site_part.size(); ++i, src += states)
+    {
+      const auto p = site_part[i] - 1;
+      auto dst = _part_list[p].msa().probs(j, part_site[p]++);
+      std::copy(src, src + states, dst);
+    }
+  }
+}
+
 void PartitionedMSA::compress_patterns()
 {
   for (PartitionInfo& pinfo: _part_list)
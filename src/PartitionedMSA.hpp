@@ -2,6 +2,7 @@
 #define RAXML_PARTITIONEDMSA_HPP_
 
 #include "PartitionInfo.hpp"
+#include "TaxonIndex.hpp"
 
 class PartitionedMSA
 {
@@ -20,7 +21,7 @@ public:
   const std::vector<PartitionInfo>& part_list() const { return _part_list; };
   std::vector<PartitionInfo>& part_list() { return _part_list; };
   const NameList& taxon_names()  const { return _taxon_names; };
-  const NameIdMap& taxon_id_map() const { return _taxon_id_map; }
+  const TaxonIndex& taxon_index() const { return _taxon_index; }
 
   size_t taxon_count() const { return _taxon_names.size(); };
   size_t part_count() const { return _part_list.size(); };
@@ -60,9 +61,10 @@ private:
   std::vector<PartitionInfo> _part_list;
   MSA _full_msa;
   NameList _taxon_names;
-  NameIdMap _taxon_id_map;
+  TaxonIndex _taxon_index;
 
   std::vector<unsigned int> get_site_part_assignment();
+  void split_probs(const std::vector<unsigned int>& site_part);
   void set_taxon_names(const NameList& taxon_names);
 };
 
@@ -0,0 +1,263 @@
+#include <algorithm>
+#include <limits>
+
+#include "TaxonIndex.hpp"
+
+using namespace std;
+
+const size_t TaxonIndex::npos;
+
+static const size_t MAX_BUILD_ATTEMPTS = 32;
+static const size_t KEYS_PER_BUCKET = 2;
+
+/* MurmurHash64A */
+static uint64_t hash_name(const char * name, size_t len, uint64_t seed)
+{
+  const uint64_t m = 0xc6a4a7935bd1e995ULL;
+  const int r = 47;
+
+  uint64_t h = seed ^ (len * m);
+
+  const char * end = name + (len & ~(size_t) 7);
+  for (const char * p = name; p != end; p += 8)
+  {
+    uint64_t k;
+    memcpy(&k, p, sizeof(k));
+
+    k *= m;
+    k ^= k >> r;
+    k *= m;
+
+    h ^= k;
+    h *= m;
+  }
+
+  uint64_t k = 0;
+  switch (len & 7)
+  {
+    case 7: k ^= uint64_t((unsigned char) end[6]) << 48; /* fall through */
+    case 6: k ^= uint64_t((unsigned char) end[5]) << 40; /* fall through */
+    case 5: k ^= uint64_t((unsigned char) end[4]) << 32; /* fall through */
+    case 4: k ^= uint64_t((unsigned char) end[3]) << 24; /* fall through */
+    case 3: k ^= uint64_t((unsigned char) end[2]) << 16; /* fall through */
+    case 2: k ^= uint64_t((unsigned char) end[1]) << 8;  /* fall through */
+    case 1: k ^= uint64_t((unsigned char) end[0]);
+      h ^= k;
+      h *= m;
+  };
+
+  h ^= h >> r;
+  h *= m;
+  h ^= h >> r;
+
+  return h;
+}
+
+/* splitmix64 finalizer */
+static inline uint64_t mix_hash(uint64_t x)
+{
+  x ^= x >> 30;
+  x *= 0xbf58476d1ce4e5b9ULL;
+  x ^= x >> 27;
+  x *= 0x94d049bb133111ebULL;
+  x ^= x >> 31;
+  return x;
+}
+
+TaxonIndex::TaxonIndex(const NameList& names) : _seed(0)
+{
+  IdNameVector id_names;
+  id_names.reserve(names.size());
+  for (size_t i = 0; i < names.size(); ++i)
+    id_names.emplace_back(i, names[i]);
+
+  build(id_names);
+}
+
+TaxonIndex::TaxonIndex(const IdNameVector& id_names) : _seed(0)
+{
+  build(id_names);
+}
+
+size_t TaxonIndex::slot(uint64_t hash, uint32_t displacement) const
+{
+  return reduce(mix_hash(hash ^ (displacement * 0x9e3779b97f4a7c15ULL)), _slots.size());
+}
+
+void TaxonIndex::build(const IdNameVector& id_names)
+{
+  if (id_names.empty())
+    return;
+
+  if (id_names.size() > std::numeric_limits<uint32_t>::max())
+    throw runtime_error("Too many taxa for taxon name index!");
+
+  vector<uint64_t> hashes(id_names.size());
+  IDVector keys(id_names.size());
+
+  for (size_t attempt = 0; attempt < MAX_BUILD_ATTEMPTS; ++attempt)
+  {
+    _seed = mix_hash(attempt + 1);
+
+    keys.resize(id_names.size());
+    for (size_t i = 0; i < id_names.size(); ++i)
+    {
+      const auto& name = id_names[i].second;
+      hashes[i] = hash_name(name.c_str(), name.size(), _seed);
+      keys[i] = i;
+    }
+
+    /* sort by hash, later occurrences of the same name go first */
+    sort(keys.begin(), keys.end(), [&hashes](size_t a, size_t b) -> bool
+        { return hashes[a] < hashes[b] || (hashes[a] == hashes[b] && a > b); });
+
+    /* duplicate names: keep the last occurrence (same as std::map::operator[]) */
+    bool collision = false;
+    size_t num_keys = 0;
+    for (size_t i = 0; i < keys.size(); ++i)
+    {
+      if (num_keys > 0 && hashes[keys[i]] == hashes[keys[num_keys-1]])
+      {
+        if (id_names[keys[i]].second == id_names[keys[num_keys-1]].second)
+          continue;
+
+        collision = true;
+        break;
+      }
+      keys[num_keys++] = keys[i];
+    }
+
+    if (collision)
+      continue;
+
+    keys.resize(num_keys);
+
+    if (build_table(id_names, hashes, keys))
+      return;
+  }
+
+  throw runtime_error("Cannot build taxon name index!");
+}
+
+bool TaxonIndex::build_table(const IdNameVector& id_names, const vector<uint64_t>& hashes,
+                             const IDVector& keys)
+{
+  const size_t num_keys = keys.size();
+  const size_t num_buckets = (num_keys + KEYS_PER_BUCKET - 1) / KEYS_PER_BUCKET;
+  const size_t max_displacement = std::min<size_t>(64 * num_keys + 1024,
+                                                   std::numeric_limits<uint32_t>::max());
+
+  _displacements.assign(num_buckets, 0);
+  _slots.assign(num_keys, Slot());
+
+  /* group keys by bucket (counting sort) */
+  IDVector bucket_start(num_buckets + 1, 0);
+  for (auto k: keys)
+    bucket_start[bucket(hashes[k]) + 1]++;
+  for (size_t b = 0; b < num_buckets; ++b)
+    bucket_start[b+1] += bucket_start[b];
+
+  IDVector bucket_keys(num_keys);
+  {
+    IDVector fill_pos(bucket_start.cbegin(), bucket_start.cend() - 1);
+    for (auto k: keys)
+      bucket_keys[fill_pos[bucket(hashes[k])]++] = k;
+  }
+
+  auto bucket_size = [&bucket_start](size_t b) -> size_t
+      { return bucket_start[b+1] - bucket_start[b]; };
+
+  /* place the largest buckets first, while there is still plenty of free slots */
+  IDVector bucket_order(num_buckets);
+  for (size_t b = 0; b < num_buckets; ++b)
+    bucket_order[b] = b;
+  stable_sort(bucket_order.begin(), bucket_order.end(), [&bucket_size](size_t a, size_t b) -> bool
+              { return bucket_size(a) > bucket_size(b); });
+
+  vector<bool> taken(num_keys, false);
+  IDVector bucket_slots;
+  for (auto b: bucket_order)
+  {
+    const auto first = bucket_keys.cbegin() + bucket_start[b];
+    const auto last = bucket_keys.cbegin() + bucket_start[b+1];
+    if (first == last)
+      break;
+
+    bool placed = false;
+    for (size_t d = 0; d < max_displacement && !placed; ++d)
+    {
+      bucket_slots.clear();
+      placed = true;
+      for (auto k = first; k != last; ++k)
+      {
+        const auto s = slot(hashes[*k], d);
+        if (taken[s] ||
+            std::find(bucket_slots.cbegin(), bucket_slots.cend(), s) != bucket_slots.cend())
+        {
+          placed = false;
+          break;
+        }
+        bucket_slots.push_back(s);
+      }
+
+      if (placed)
+        _displacements[b] = d;
+    }
+
+    if (!placed)
+      return false;
+
+    for (size_t i = 0; i < bucket_slots.size(); ++i)
+    {
+      const auto k = first[i];
+      auto& s = _slots[bucket_slots[i]];
+      taken[bucket_slots[i]] = true;
+      s.hash = hashes[k];
+      s.id = id_names[k].first;
+      s.name_offset = k;
+    }
+  }
+
+  /* store names in slot order */
+  size_t arena_size = 0;
+  for (auto k: keys)
+    arena_size += id_names[k].second.size() + 1;
+
+  if (arena_size > std::numeric_limits<uint32_t>::max())
+    throw runtime_error("Taxon names are too long!");
+
+  _arena.clear();
+  _arena.reserve(arena_size);
+  for (auto& s: _slots)
+  {
+    const auto& name = id_names[s.name_offset].second;
+    s.name_offset = _arena.size();
+    _arena.append(name.c_str(), name.size() + 1);
+  }
+
+  return true;
+}
+
+size_t TaxonIndex::find(const char * name, size_t len) const
+{
+  if (_slots.empty())
+    return npos;
+
+  const auto h = hash_name(name, len, _seed);
+  const auto& s = _slots[slot(h, _displacements[bucket(h)])];
+
+  const char * slot_name = _arena.data() + s.name_offset;
+  if (s.hash == h && !strncmp(slot_name, name, len) && slot_name[len] == 0)
+    return s.id;
+  else
+    return npos;
+}
+
+size_t TaxonIndex::at(const char * name) const
+{
+  const auto id = find(name);
+  if (id == npos)
+    throw out_of_range(string("Taxon name not found: ") + name);
+
+  return id;
+}
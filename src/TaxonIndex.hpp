@@ -0,0 +1,70 @@
+#ifndef RAXML_TAXONINDEX_HPP_
+#define RAXML_TAXONINDEX_HPP_
+
+#include <cstdint>
+#include <cstring>
+
+#include "common.h"
+
+/* Immutable taxon name -> id index: minimal perfect hash (hash-and-displace)
+ * over a contiguous string arena. Built once, then shared read-only. */
+class TaxonIndex
+{
+public:
+  static const size_t npos = (size_t) -1;
+
+  TaxonIndex() : _seed(0) {}
+  TaxonIndex(const NameList& names);
+  TaxonIndex(const IdNameVector& id_names);
+
+  bool empty() const { return _slots.empty(); }
+  size_t size() const { return _slots.size(); }
+
+  size_t find(const char * name, size_t len) const;
+  size_t find(const char * name) const { return find(name, std::strlen(name)); }
+  size_t find(const std::string& name) const { return find(name.c_str(), name.size()); }
+
+  size_t count(const std::string& name) const { return find(name) == npos ? 0 : 1; }
+
+  /* throws std::out_of_range if name is not in the index */
+  size_t at(const char * name) const;
+  size_t at(const std::string& name) const { return at(name.c_str()); }
+
+private:
+  /* names are stored zero-terminated in the arena, in slot order */
+  struct Slot
+  {
+    uint64_t hash;
+    uint32_t id;
+    uint32_t name_offset;
+  };
+
+  uint64_t _seed;
+  std::vector<uint32_t> _displacements;
+  std::vector<Slot> _slots;
+  std::string _arena;
+
+  void build(const IdNameVector& id_names);
+  bool build_table(const IdNameVector& id_names, const std::vector<uint64_t>& hashes,
+                   const IDVector& keys);
+
+  /* maps a 64-bit hash onto [0, n) without division */
+  static size_t reduce(uint64_t hash, size_t n)
+  {
+#ifdef __SIZEOF_INT128__
+    return (size_t) (((unsigned __int128) hash * n) >> 64);
+#else
+    /* high 64 bits of the 64x64-bit product, from 32x32-bit partial products */
+    const uint64_t a_lo = (uint32_t) hash, a_hi = hash >> 32;
+    const uint64_t b_lo = (uint32_t) n, b_hi = (uint64_t) n >> 32;
+    const uint64_t hi_lo = a_hi * b_lo;
+    const uint64_t cross = ((a_lo * b_lo) >> 32) + (uint32_t) hi_lo + a_lo * b_hi;
+    return (size_t) (a_hi * b_hi + (hi_lo >> 32) + (cross >> 32));
+#endif
+  }
+
+  size_t bucket(uint64_t hash) const { return reduce(hash, _displacements.size()); }
+  size_t slot(uint64_t hash, uint32_t displacement) const;
+};
+
+#endif /* RAXML_TAXONINDEX_HPP_ */
@@ -0,0 +1,153 @@
+#include <algorithm>
+
+#include "TerraceSignature.hpp"
+
+using namespace std;
+
+static vector<IDVector> part_absent_tips(const PartitionedMSA& parted_msa,
+                                         const IDVector& tip_msa_idmap)
+{
+  const size_t num_tips = parted_msa.taxon_count();
+
+  /* MSA sequence index -> tip id */
+  IDVector seq_tip_idmap(num_tips);
+  for (size_t tip_id = 0; tip_id < num_tips; ++tip_id)
+  {
+    auto seq_id = tip_msa_idmap.empty() ? tip_id : tip_msa_idmap[tip_id];
+    seq_tip_idmap.at(seq_id) = tip_id;
+  }
+
+  vector<IDVector> result(parted_msa.part_count());
+  for (size_t p = 0; p < parted_msa.part_count(); ++p)
+  {
+    for (auto seq_id: parted_msa.part_info(p).stats().gap_seqs)
+      result[p].push_back(seq_tip_idmap.at(seq_id));
+  }
+
+  return result;
+}
+
+TerraceSignature::TerraceSignature(const PartitionedMSA& parted_msa,
+                                   const IDVector& tip_msa_idmap) :
+    TerraceSignature(parted_msa.taxon_count(), part_absent_tips(parted_msa, tip_msa_idmap))
+{
+}
+
+TerraceSignature::TerraceSignature(size_t num_tips, const vector<IDVector>& absent_tips) :
+    _num_tips(num_tips), _split_len(SplitSet::split_len(num_tips))
+{
+  const size_t word_bits = SplitSet::WORD_BITS;
+  const size_t num_parts = absent_tips.size();
+
+  _masks.assign(num_parts * _split_len, 0);
+  _first_taxon.assign(num_parts, 0);
+  _num_taxa.assign(num_parts, 0);
+
+  for (size_t p = 0; p < num_parts; ++p)
+  {
+    SplitWord * mask = _masks.data() + p * _split_len;
+    for (size_t tip_id = 0; tip_id < _num_tips; ++tip_id)
+      mask[tip_id / word_bits] |= SplitWord(1) << (tip_id % word_bits);
+
+    for (auto tip_id: absent_tips[p])
+    {
+      if (tip_id >= _num_tips)
+        throw runtime_error("TerraceSignature: Invalid tip id: " + to_string(tip_id));
+      mask[tip_id / word_bits] &= ~(SplitWord(1) << (tip_id % word_bits));
+    }
+
+    for (size_t w = 0; w < _split_len; ++w)
+      _num_taxa[p] += __builtin_popcountll(mask[w]);
+
+    for (size_t w = 0; w < _split_len; ++w)
+    {
+      if (mask[w])
+      {
+        _first_taxon[p] = w * word_bits + __builtin_ctzll(mask[w]);
+        break;
+      }
+    }
+  }
+}
+
+bool TerraceSignature::informative() const
+{
+  if (num_parts() < 2)
+    return false;
+
+  for (auto num_taxa: _num_taxa)
+  {
+    if (num_taxa == _num_tips)
+      return false;
+  }
+
+  return true;
+}
+
+uint64_t TerraceSignature::hash(const TreeTopology& topol, const TreeLayout& layout) const
+{
+  if (layout.num_tips != _num_tips)
+    throw runtime_error("TerraceSignature: Wrong number of tips: " +
+                        to_string(layout.num_tips) + ", expected: " + to_string(_num_tips));
+
+  return hash(SplitSet(topol, layout));
+}
+
+uint64_t TerraceSignature::hash(const pll_utree_t& tree) const
+{
+  if (tree.tip_count != _num_tips)
+    throw runtime_error("TerraceSignature: Wrong number of tips: " +
+                        to_string(tree.tip_count) + ", expected: " + to_string(_num_tips));
+
+  return hash(SplitSet(tree));
+}
+
+uint64_t TerraceSignature::hash(const SplitSet& splits) const
+{
+  const size_t word_bits = SplitSet::WORD_BITS;
+
+  std::vector<SplitWord> induced(_split_len);
+  std::vector<uint64_t> split_hashes;
+  split_hashes.reserve(splits.size());
+
+  uint64_t result = 0;
+  for (size_t p = 0; p < num_parts(); ++p)
+  {
+    const SplitWord * mask = _masks.data() + p * _split_len;
+    const auto first = _first_taxon[p];
+
+    /* trees induced by less than 4 taxa are all identical */
+    if (_num_taxa[p] < 4)
+      continue;
+
+    /* non-trivial splits of the induced subtree: restrict every split to the present taxa,
+     * and normalize such that the first present taxon is never set */
+    split_hashes.clear();
+    for (size_t i = 0; i < splits.size(); ++i)
+    {
+      const SplitWord * s = splits.split(i);
+      const bool flip = (s[first / word_bits] >> (first % word_bits)) & 1;
+      size_t count = 0;
+      for (size_t w = 0; w < _split_len; ++w)
+      {
+        induced[w] = (flip ? ~s[w] : s[w]) & mask[w];
+        count += __builtin_popcountll(induced[w]);
+      }
+
+      if (count >= 2 && _num_taxa[p] - count >= 2)
+        split_hashes.push_back(SplitSet::split_hash(induced.data(), _split_len));
+    }
+
+    /* several branches of the full tree can induce the same split */
+    sort(split_hashes.begin(), split_hashes.end());
+    split_hashes.erase(unique(split_hashes.begin(), split_hashes.end()), split_hashes.end());
+
+    uint64_t part_hash = p;
+    for (auto h: split_hashes)
+      part_hash += h;
+
+    result = result * 0x9e3779b97f4a7c15ULL + SplitSet::split_hash(&part_hash, 1);
+  }
+
+  return result;
+}
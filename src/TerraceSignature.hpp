@@ -0,0 +1,43 @@
+#ifndef RAXML_TERRACESIGNATURE_HPP_
+#define RAXML_TERRACESIGNATURE_HPP_
+
+#include "PartitionedMSA.hpp"
+#include "bootstrap/SplitSet.hpp"
+
+/* Phylogenetic terrace fingerprint of a tree: hash over the subtrees induced by the taxa
+ * present in each partition (cf. taxon presence/absence matrix in TerraceWrapper).
+ * With unlinked branch lengths, trees with identical induced subtrees lie on the same
+ * terrace and have identical likelihood. Unlike TerraceWrapper, this does not
+ * require terraphast and can be evaluated for every tree visited during the search. */
+class TerraceSignature
+{
+public:
+  /* absent_tips: per partition, tip ids of taxa without data in this partition */
+  TerraceSignature(size_t num_tips, const std::vector<IDVector>& absent_tips);
+  TerraceSignature(const PartitionedMSA& parted_msa, const IDVector& tip_msa_idmap);
+
+  size_t num_tips() const { return _num_tips; }
+  size_t num_parts() const { return _first_taxon.size(); }
+
+  /* false if at least one partition contains all taxa: then all terraces are trivial */
+  bool informative() const;
+
+  /* equal for all trees on the same terrace (modulo hash collisions) */
+  uint64_t hash(const TreeTopology& topol, const TreeLayout& layout) const;
+  uint64_t hash(const pll_utree_t& tree) const;
+  uint64_t hash(const Tree& tree) const { return hash(tree.pll_utree()); }
+
+private:
+  size_t _num_tips;
+  size_t _split_len;
+
+  /* per-partition taxon presence masks (indexed by tip id), first present taxon and
+   * number of present taxa */
+  std::vector<SplitWord> _masks;
+  uintVector _first_taxon;
+  uintVector _num_taxa;
+
+  uint64_t hash(const SplitSet& splits) const;
+};
+
+#endif /* RAXML_TERRACESIGNATURE_HPP_ */
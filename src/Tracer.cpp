@@ -0,0 +1,121 @@
+#include <cassert>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include "Tracer.hpp"
+#include "ParallelContext.hpp"
+
+using namespace std;
+
+bool Tracer::_enabled = false;
+chrono::steady_clock::time_point Tracer::_start_time;
+vector<Tracer::ThreadBuffer> Tracer::_buffers;
+
+void Tracer::enable(size_t num_threads, size_t capacity)
+{
+  assert(num_threads > 0 && capacity > 0);
+
+  _buffers.resize(num_threads);
+  for (auto& b: _buffers)
+  {
+    b.events.resize(capacity);
+    b.count = 0;
+  }
+
+  _start_time = chrono::steady_clock::now();
+  _enabled = true;
+}
+
+void Tracer::disable()
+{
+  _enabled = false;
+  _buffers.clear();
+}
+
+void Tracer::record(const char * name, double start, double end)
+{
+  const size_t thread_id = ParallelContext::world_thread_id();
+  if (thread_id >= _buffers.size())
+    return;
+
+  auto& b = _buffers[thread_id];
+  auto& e = b.events[b.count % b.events.size()];
+  e.name = name;
+  e.start = start;
+  e.duration = end - start;
+  b.count++;
+}
+
+vector<TraceEvent> Tracer::events(size_t thread_id)
+{
+  vector<TraceEvent> result;
+  if (thread_id >= _buffers.size())
+    return result;
+
+  const auto& b = _buffers[thread_id];
+  const size_t capacity = b.events.size();
+  const size_t first = b.count > capacity ? b.count - capacity : 0;
+  for (size_t i = first; i < b.count; ++i)
+    result.push_back(b.events[i % capacity]);
+
+  return result;
+}
+
+size_t Tracer::dropped(size_t thread_id)
+{
+  if (thread_id >= _buffers.size())
+    return 0;
+
+  const auto& b = _buffers[thread_id];
+  return b.count > b.events.size() ? b.count - b.events.size() : 0;
+}
+
+string Tracer::serialize(size_t rank_id)
+{
+  ostringstream ss;
+  ss.precision(3);
+  ss << fixed;
+
+  size_t num_dropped = 0;
+  for (size_t t = 0; t < _buffers.size(); ++t)
+    num_dropped += dropped(t);
+
+  ss << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << rank_id <<
+        ",\"args\":{\"name\":\"rank " << rank_id << "\",\"dropped_events\":" <<
+        num_dropped << "}}";
+
+  for (size_t t = 0; t < _buffers.size(); ++t)
+  {
+    for (const auto& e: events(t))
+    {
+      ss << ",\n{\"name\":\"" << e.name << "\",\"ph\":\"X\",\"pid\":" << rank_id <<
+            ",\"tid\":" << t << ",\"ts\":" << e.start << ",\"dur\":" << e.duration << "}";
+    }
+  }
+
+  return ss.str();
+}
+
+void Tracer::export_json(const string& fname)
+{
+  ofstream fs(fname);
+  if (!fs)
+    throw runtime_error("Unable to open trace file for writing: " + fname);
+
+  fs << "{\"traceEvents\":[\n" << serialize(ParallelContext::world_rank_id()) <<
+        "\n],\"displayTimeUnit\":\"ms\"}" << endl;
+}
+
+string Tracer::rank_fname(const string& fname, size_t rank_id)
+{
+  if (rank_id == 0)
+    return fname;
+
+  const string ext = ".json";
+  const bool has_ext = fname.size() >= ext.size() &&
+                       fname.compare(fname.size() - ext.size(), ext.size(), ext) == 0;
+  const string base = has_ext ? fname.substr(0, fname.size() - ext.size()) : fname;
+
+  return base + ".rank" + to_string(rank_id) + ext;
+}
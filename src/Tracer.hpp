@@ -0,0 +1,89 @@
+#ifndef RAXML_TRACER_HPP_
+#define RAXML_TRACER_HPP_
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+/* timestamps are in microseconds since Tracer::enable() */
+struct TraceEvent
+{
+  const char * name;
+  double start;
+  double duration;
+};
+
+/* Lightweight execution tracer: every thread records completed spans into its own fixed-size
+ * ring buffer (single writer, no locks), older events are overwritten once the buffer is full.
+ * Events are exported in Chrome trace format (chrome://tracing, Perfetto).
+ *
+ * NB: when tracing is disabled, each span costs one branch on a static flag */
+class Tracer
+{
+public:
+  /* must be called before the worker threads are started */
+  static void enable(size_t num_threads, size_t capacity);
+  static void disable();
+  static bool enabled() { return _enabled; }
+
+  static double now()
+  {
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() -
+                                                     _start_time).count();
+  }
+
+  /* record span of the calling thread */
+  static void record(const char * name, double start, double end);
+
+  /* events of the given thread in chronological order (call after threads are done) */
+  static std::vector<TraceEvent> events(size_t thread_id);
+  static size_t dropped(size_t thread_id);
+
+  /* events of all threads of this rank as comma-separated JSON objects */
+  static std::string serialize(size_t rank_id);
+
+  /* writes events of this rank to fname (call after threads are done) */
+  static void export_json(const std::string& fname);
+
+  /* trace file name of the given rank: fname for rank 0, "<fname w/o .json>.rank<N>.json"
+   * for the other ranks */
+  static std::string rank_fname(const std::string& fname, size_t rank_id);
+
+private:
+  struct ThreadBuffer
+  {
+    std::vector<TraceEvent> events;
+    size_t count;
+    char pad[64];  /* keep buffers of different threads on separate cache lines */
+  };
+
+  static bool _enabled;
+  static std::chrono::steady_clock::time_point _start_time;
+  static std::vector<ThreadBuffer> _buffers;
+};
+
+/* records time spent between construction and destruction, name must be a string literal */
+class TraceSpan
+{
+public:
+  explicit TraceSpan(const char * name) :
+    _name(Tracer::enabled() ? name : nullptr), _start(_name ? Tracer::now() : 0.) {}
+
+  ~TraceSpan()
+  {
+    if (_name)
+      Tracer::record(_name, _start, Tracer::now());
+  }
+
+  TraceSpan(const TraceSpan& other) = delete;
+  TraceSpan& operator=(const TraceSpan& other) = delete;
+private:
+  const char * _name;
+  double _start;
+};
+
+#define RAXML_TRACE_CONCAT_(a, b) a ## b
+#define RAXML_TRACE_CONCAT(a, b) RAXML_TRACE_CONCAT_(a, b)
+#define RAXML_TRACE_SPAN(name) TraceSpan RAXML_TRACE_CONCAT(_trace_span_, __LINE__)(name)
+
+#endif /* RAXML_TRACER_HPP_ */
@@ -2,15 +2,26 @@
 
 #include "Tree.hpp"
 #include "io/file_io.hpp"
+#include "bootstrap/SplitSet.hpp"
 
 using namespace std;
 
+const unsigned int TreeLayout::NONE;
+
+void PllUTreeDeleter::operator()(pll_utree_t* ptr) const
+{
+  if (block_size)
+    free(ptr);
+  else
+    pll_utree_destroy(ptr, nullptr);
+}
+
 Tree::Tree (const Tree& other) : BasicTree(other._num_tips),
-    _pll_utree(other.pll_utree_copy()), _partition_brlens(other._partition_brlens)
+    _pll_utree(clone_contiguous(other._pll_utree)), _partition_brlens(other._partition_brlens)
 {
 }
 
-Tree::Tree (Tree&& other) : BasicTree(other._num_tips), _pll_utree(other._pll_utree.release())
+Tree::Tree (Tree&& other) : BasicTree(other._num_tips), _pll_utree(std::move(other._pll_utree))
 {
   other._num_tips = 0;
   swap(_pll_utree_tips, other._pll_utree_tips);
@@ -21,7 +32,7 @@ Tree& Tree::operator=(const Tree& other)
 {
   if (this != &other)
   {
-    _pll_utree.reset(other.pll_utree_copy());
+    _pll_utree = clone_contiguous(other._pll_utree);
     _num_tips = other._num_tips;
     _pll_utree_tips.clear();
     _partition_brlens = other._partition_brlens;
@@ -36,7 +47,7 @@ Tree& Tree::operator=(Tree&& other)
   {
     _num_tips = 0;
     _pll_utree_tips.clear();
-    _pll_utree.release();
+    _pll_utree.reset();
     _partition_brlens.clear();
 
     swap(_num_tips, other._num_tips);
@@ -52,6 +63,173 @@ Tree::~Tree ()
 {
 }
 
+static size_t align_block_offset(size_t offset)
+{
+  const size_t align = alignof(pll_unode_t);
+  return (offset + align - 1) / align * align;
+}
+
+/* block layout: pll_utree_t | node pointers | subnodes | labels */
+static void block_layout(const pll_utree_t& pll_utree, size_t& nodes_offset,
+                         size_t& subnodes_offset, size_t& labels_offset)
+{
+  const size_t num_nodes = pll_utree.tip_count + pll_utree.inner_count;
+  const size_t num_subnodes = 2 * pll_utree.edge_count;
+
+  nodes_offset = align_block_offset(sizeof(pll_utree_t));
+  subnodes_offset = align_block_offset(nodes_offset + num_nodes * sizeof(pll_unode_t *));
+  labels_offset = subnodes_offset + num_subnodes * sizeof(pll_unode_t);
+}
+
+PllUTreeStorePtr Tree::clone_contiguous(const pll_utree_t& pll_utree)
+{
+  const size_t num_nodes = pll_utree.tip_count + pll_utree.inner_count;
+  const size_t num_subnodes = 2 * pll_utree.edge_count;
+
+  /* map node_index -> source subnode; fall back to regular libpll clone
+   * if node indices are not a permutation of [0, num_subnodes) */
+  PllNodeVector src_nodes(num_subnodes, nullptr);
+  size_t labels_size = 0;
+  bool valid = num_subnodes > 0;
+  for (size_t i = 0; i < num_nodes && valid; ++i)
+  {
+    auto start = pll_utree.nodes[i];
+    auto node = start;
+    do
+    {
+      if (node->node_index >= num_subnodes || src_nodes[node->node_index])
+      {
+        valid = false;
+        break;
+      }
+
+      src_nodes[node->node_index] = node;
+
+      /* inner nodes may share one label between all subnodes */
+      if (node->label && (node == start || node->label != start->label))
+        labels_size += strlen(node->label) + 1;
+
+      node = node->next;
+    }
+    while (node && node != start);
+  }
+
+  if (!valid || find(src_nodes.cbegin(), src_nodes.cend(), nullptr) != src_nodes.cend())
+    return PllUTreeStorePtr(pll_utree_clone(&pll_utree));
+
+  size_t nodes_offset, subnodes_offset, labels_offset;
+  block_layout(pll_utree, nodes_offset, subnodes_offset, labels_offset);
+
+  const size_t block_size = labels_offset + labels_size;
+  char * block = (char *) malloc(block_size);
+  if (!block)
+    throw bad_alloc();
+
+  auto tree = (pll_utree_t *) block;
+  auto nodes = (pll_unode_t **) (block + nodes_offset);
+  auto subnodes = (pll_unode_t *) (block + subnodes_offset);
+  char * labels = block + labels_offset;
+
+  auto clone_node = [subnodes](const pll_unode_t * node) -> pll_unode_t *
+      { return node ? subnodes + node->node_index : nullptr; };
+
+  for (size_t i = 0; i < num_nodes; ++i)
+  {
+    auto start = pll_utree.nodes[i];
+    auto node = start;
+    do
+    {
+      auto copy = clone_node(node);
+      *copy = *node;
+      copy->next = clone_node(node->next);
+      copy->back = clone_node(node->back);
+
+      if (node->label)
+      {
+        if (node == start || node->label != start->label)
+        {
+          const size_t len = strlen(node->label) + 1;
+          memcpy(labels, node->label, len);
+          copy->label = labels;
+          labels += len;
+        }
+        else
+          copy->label = clone_node(start)->label;
+      }
+
+      node = node->next;
+    }
+    while (node && node != start);
+
+    nodes[i] = clone_node(start);
+  }
+
+  *tree = pll_utree;
+  tree->nodes = nodes;
+  tree->vroot = clone_node(pll_utree.vroot);
+
+  return PllUTreeStorePtr(tree, PllUTreeDeleter(block_size));
+}
+
+PllUTreeStorePtr Tree::clone_contiguous(const PllUTreeStorePtr& pll_utree)
+{
+  if (!pll_utree)
+    return PllUTreeStorePtr();
+
+  const size_t block_size = pll_utree.get_deleter().block_size;
+
+  if (!block_size)
+    return clone_contiguous(*pll_utree);
+
+  /* contiguous source: copy the whole block at once and re-base the pointers */
+  const char * src_block = (const char *) pll_utree.get();
+  char * block = (char *) malloc(block_size);
+  if (!block)
+    throw bad_alloc();
+
+  memcpy(block, src_block, block_size);
+
+  auto rebase = [src_block, block, block_size](void * ptr) -> void *
+      {
+        const char * p = (const char *) ptr;
+        return (p >= src_block && p < src_block + block_size) ? block + (p - src_block) : ptr;
+      };
+
+  auto tree = (pll_utree_t *) block;
+  size_t nodes_offset, subnodes_offset, labels_offset;
+  block_layout(*tree, nodes_offset, subnodes_offset, labels_offset);
+
+  const size_t num_nodes = tree->tip_count + tree->inner_count;
+  const size_t num_subnodes = 2 * tree->edge_count;
+
+  tree->nodes = (pll_unode_t **) (block + nodes_offset);
+  tree->vroot = (pll_unode_t *) rebase(tree->vroot);
+
+  for (size_t i = 0; i < num_nodes; ++i)
+    tree->nodes[i] = (pll_unode_t *) rebase(tree->nodes[i]);
+
+  auto subnodes = (pll_unode_t *) (block + subnodes_offset);
+  for (size_t i = 0; i < num_subnodes; ++i)
+  {
+    auto& node = subnodes[i];
+    node.next = (pll_unode_t *) rebase(node.next);
+    node.back = (pll_unode_t *) rebase(node.back);
+    node.label = (char *) rebase(node.label);
+  }
+
+  return PllUTreeStorePtr(tree, PllUTreeDeleter(block_size));
+}
+
+void Tree::unpack_nodes()
+{
+  if (contiguous())
+  {
+    _pll_utree.reset(pll_utree_clone(_pll_utree.get()));
+    _pll_utree.get_deleter().block_size = 0;
+    _pll_utree_tips.clear();
+  }
+}
+
 size_t Tree::num_inner() const
 {
   return _pll_utree ? _pll_utree->inner_count : BasicTree::num_inner();
@@ -222,11 +400,9 @@ IdNameVector Tree::tip_labels() const
   return result;
 }
 
-NameIdMap Tree::tip_ids() const
+TaxonIndex Tree::tip_ids() const
 {
-  NameIdMap result;
-  for (auto const& node: tip_nodes())
-    result.emplace(string(node->label), node->clv_index);
+  TaxonIndex result(tip_labels());
 
   assert(!result.empty());
 
@@ -235,6 +411,7 @@ NameIdMap Tree::tip_ids() const
 
 void Tree::insert_tips_random(const NameList& tip_names, unsigned int random_seed)
 {
+  unpack_nodes();
   _pll_utree_tips.clear();
 
   std::vector<const char*> tip_labels(tip_names.size(), nullptr);
@@ -255,7 +432,7 @@ void Tree::insert_tips_random(const NameList& tip_names, unsigned int random_see
   }
 }
 
-void Tree::reset_tip_ids(const NameIdMap& label_id_map)
+void Tree::reset_tip_ids(const TaxonIndex& label_id_map)
 {
   if (label_id_map.size() < _num_tips)
     throw invalid_argument("Invalid map size");
@@ -327,6 +504,27 @@ TreeTopology Tree::topology() const
   return topol;
 }
 
+TreeLayout Tree::layout() const
+{
+  TreeLayout layout;
+
+  layout.num_tips = _num_tips;
+  layout.next.resize(num_subnodes(), TreeLayout::NONE);
+  layout.labels.resize(num_subnodes());
+
+  for (auto n: subnodes())
+  {
+    if (n->next)
+      layout.next[n->node_index] = n->next->node_index;
+    if (n->label)
+      layout.labels[n->node_index] = n->label;
+  }
+
+  layout.vroot = _pll_utree->vroot->node_index;
+
+  return layout;
+}
+
 void Tree::topology(const TreeTopology& topol)
 {
   if (topol.edges.size() != num_branches())
@@ -405,6 +603,8 @@ void Tree::apply_avg_brlens(const doubleVector& partition_contributions)
 
 void Tree::reroot(const NameList& outgroup_taxa, bool add_root_node)
 {
+  unpack_nodes();
+
   // collect tip node indices
   NameIdMap name_id_map;
   for (auto const& node: tip_nodes())
@@ -434,12 +634,54 @@ TreeCollection::const_iterator TreeCollection::best() const
                          );
 }
 
+void TreeCollection::clear()
+{
+  _trees.clear();
+  _multiplicity.clear();
+  _hashes.clear();
+  _hash_index.clear();
+  _num_trees = 0;
+  _layout = TreeLayout();
+}
+
 void TreeCollection::push_back(double score, const Tree& tree)
 {
-  _trees.emplace_back(score, tree.topology());
+  const SplitSet splits(tree.pll_utree());
+  const auto hash = splits.hash();
+
+  if (_layout.next.empty())
+  {
+    _layout = tree.layout();
+    _layout.labels.clear();
+  }
+
+  /* hash match -> compare split sets to rule out a collision */
+  auto range = _hash_index.equal_range(hash);
+  for (auto it = range.first; it != range.second; ++it)
+  {
+    auto& entry = _trees[it->second];
+    if (SplitSet(entry.second, _layout) == splits)
+    {
+      /* same topology found again: keep the best-scoring copy (branch lengths differ) */
+      if (score > entry.first)
+        entry = ScoredTopology(score, tree.topology());
+      _multiplicity[it->second]++;
+      _num_trees++;
+      return;
+    }
+  }
+
+  push_back(score, tree.topology(), hash);
 }
 
-void TreeCollection::push_back(double score, TreeTopology&& topol)
+void TreeCollection::push_back(double score, TreeTopology&& topol, uint64_t topology_hash,
+                               size_t multiplicity)
 {
-  _trees.emplace_back(score, topol);
+  assert(multiplicity > 0);
+
+  _hash_index.emplace(topology_hash, _trees.size());
+  _trees.emplace_back(score, std::move(topol));
+  _multiplicity.push_back(multiplicity);
+  _hashes.push_back(topology_hash);
+  _num_trees += multiplicity;
 }
@@ -43,7 +43,36 @@ struct TreeTopology
   std::vector<doubleVector> brlens;
 };
 
+/* Node structure shared by all topologies of a tree (inner node rings, labels and
+ * virtual root), indexed by subnode id: together with a TreeTopology, it fully defines the
+ * tree, so that topology-only consumers do not need to re-build the pll_unode_t graph */
+struct TreeLayout
+{
+  static const unsigned int NONE = (unsigned int) -1;
+
+  TreeLayout() : num_tips(0), vroot(NONE) {}
+
+  size_t num_subnodes() const { return next.size(); }
+
+  size_t num_tips;
+  unsigned int vroot;
+  uintVector next;        /* next subnode in the same inner node, NONE for tips */
+  NameList labels;
+};
+
 typedef std::unique_ptr<pll_utree_t> PllUTreeUniquePtr;
+
+/* Deleter for trees owned by Tree: either a regular libpll tree (block_size = 0),
+ * or a tree stored in a single contiguous memory block (header, node pointers, nodes and labels) */
+struct PllUTreeDeleter
+{
+  PllUTreeDeleter(size_t block_size = 0) : block_size(block_size) {}
+  void operator()(pll_utree_t* ptr) const;
+
+  size_t block_size;
+};
+
+typedef std::unique_ptr<pll_utree_t, PllUTreeDeleter> PllUTreeStorePtr;
 typedef std::vector<pll_unode_t*> PllNodeVector;
 
 class BasicTree
@@ -73,7 +102,7 @@ public:
     BasicTree(tip_count),
     _pll_utree(pll_utree_wraptree(pll_utree_graph_clone(&root), tip_count)) {}
   Tree(const pll_utree_t& pll_utree) :
-    BasicTree(pll_utree.tip_count), _pll_utree(pll_utree_clone(&pll_utree)) {}
+    BasicTree(pll_utree.tip_count), _pll_utree(clone_contiguous(pll_utree)) {}
   Tree(std::unique_ptr<pll_utree_t>&  pll_utree) :
     BasicTree(pll_utree ? pll_utree->tip_count : 0), _pll_utree(pll_utree.release()) {}
   Tree(std::unique_ptr<pll_utree_t>&&  pll_utree) :
@@ -95,10 +124,11 @@ public:
   static Tree loadFromFile(const std::string& file_name);
 
   IdNameVector tip_labels() const;
-  NameIdMap tip_ids() const;
+  TaxonIndex tip_ids() const;
 
   TreeTopology topology() const;
   void topology(const TreeTopology& topol);
+  TreeLayout layout() const;
 
   const std::vector<doubleVector>& partition_brlens() const { return _partition_brlens; }
   const doubleVector& partition_brlens(size_t partition_idx) const;
@@ -108,6 +138,7 @@ public:
 
   // TODO: use move semantics to transfer ownership?
   pll_utree_t * pll_utree_copy() const { return pll_utree_clone(_pll_utree.get()); }
+  bool contiguous() const { return _pll_utree && _pll_utree.get_deleter().block_size > 0; }
   const pll_utree_t& pll_utree() const { return *_pll_utree; }
 
   const pll_unode_t& pll_utree_root() const { return *_pll_utree->vroot; }
@@ -118,7 +149,7 @@ public:
   void apply_partition_brlens(size_t partition_idx);
   void apply_avg_brlens(const doubleVector& partition_contributions);
 
-  void reset_tip_ids(const NameIdMap& label_id_map);
+  void reset_tip_ids(const TaxonIndex& label_id_map);
   void reroot(const NameList& outgroup_taxa, bool add_root_node = false);
   void insert_tips_random(const NameList& tip_names, unsigned int random_seed = 0);
 
@@ -128,17 +159,26 @@ public:
   size_t num_branches() const;
 
 protected:
-  PllUTreeUniquePtr _pll_utree;
+  PllUTreeStorePtr _pll_utree;
   std::vector<doubleVector> _partition_brlens;
 
   mutable PllNodeVector _pll_utree_tips;
 
   PllNodeVector const& tip_nodes() const;
   PllNodeVector subnodes() const;
+
+  /* must be called before any libpll routine which (de)allocates nodes or labels */
+  void unpack_nodes();
+
+  static PllUTreeStorePtr clone_contiguous(const pll_utree_t& pll_utree);
+  static PllUTreeStorePtr clone_contiguous(const PllUTreeStorePtr& pll_utree);
 };
 
 typedef std::pair<double, TreeTopology> ScoredTopology;
 
+/* Collection of scored topologies: identical topologies (same split set) are stored only once,
+ * with the best score and a multiplicity count. All trees are expected to share the node layout
+ * (as produced by the same TreeInfo or by Tree::topology(const TreeTopology&)) */
 class TreeCollection
 {
 public:
@@ -146,21 +186,37 @@ public:
   typedef container_type::const_iterator const_iterator;
   typedef container_type::value_type value_type;
 
-  size_t size() const { return  _trees.size(); }
+  TreeCollection() : _num_trees(0) {}
+
+  /* total number of trees, including duplicates */
+  size_t size() const { return _num_trees; }
+  size_t num_unique() const { return  _trees.size(); }
   bool empty() const { return  _trees.empty(); }
   const_iterator best() const;
   value_type::first_type best_score() const { return best()->first; }
   const value_type::second_type& best_topology() const { return best()->second; }
 
+  /* iteration is over unique topologies */
   const_iterator begin() const { return _trees.cbegin(); }
   const_iterator end() const { return _trees.cend(); }
 
-  void clear() { _trees.clear(); };
+  size_t multiplicity(const_iterator it) const { return _multiplicity[it - begin()]; }
+  uint64_t topology_hash(const_iterator it) const { return _hashes[it - begin()]; }
+
+  void clear();
   void push_back(double score, const Tree& tree);
-  void push_back(double score, TreeTopology&& topol);
+  void push_back(double score, TreeTopology&& topol, uint64_t topology_hash,
+                 size_t multiplicity = 1);
 
 private:
   container_type _trees;
+  std::vector<size_t> _multiplicity;
+  std::vector<uint64_t> _hashes;
+  std::unordered_multimap<uint64_t, size_t> _hash_index;
+  size_t _num_trees;
+
+  /* node layout shared by all stored topologies: needed to verify hash matches */
+  TreeLayout _layout;
 };
 
 #endif /* RAXML_TREE_HPP_ */
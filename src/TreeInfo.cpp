@@ -2,6 +2,8 @@
 
 #include "TreeInfo.hpp"
 #include "ParallelContext.hpp"
+#include "Tracer.hpp"
+#include "HotPathStats.hpp"
 
 using namespace std;
 
@@ -29,6 +31,7 @@ void TreeInfo::init(const Options &opts, const Tree& tree, const PartitionedMSA&
   _brlen_max = opts.brlen_max;
   _brlen_opt_method = opts.brlen_opt_method;
   _partition_contributions.resize(parted_msa.part_count());
+  _partition_mem.resize(parted_msa.part_count());
   double total_weight = 0;
 
   _pll_treeinfo = pllmod_treeinfo_create(pll_utree_graph_clone(&tree.pll_utree_root()),
@@ -38,9 +41,11 @@ void TreeInfo::init(const Options &opts, const Tree& tree, const PartitionedMSA&
   libpll_check_error("ERROR creating treeinfo structure");
   assert(_pll_treeinfo);
 
+  /* bind to the parallel context of the calling thread: all reductions on this treeinfo
+   * will be performed within this thread/rank group */
   if (ParallelContext::num_procs() > 1)
   {
-    pllmod_treeinfo_set_parallel_context(_pll_treeinfo, (void *) nullptr,
+    pllmod_treeinfo_set_parallel_context(_pll_treeinfo, (void *) &ParallelContext::current(),
                                          ParallelContext::parallel_reduce_cb);
   }
 
@@ -62,7 +67,7 @@ void TreeInfo::init(const Options &opts, const Tree& tree, const PartitionedMSA&
     {
       /* create and init PLL partition structure */
       pll_partition_t * partition = create_pll_partition(opts, pinfo, tip_msa_idmap,
-                                                         *part_range, weights);
+                                                         *part_range, weights, _partition_mem[p]);
 
       int retval = pllmod_treeinfo_init_partition(_pll_treeinfo, p, partition,
                                                   params_to_optimize,
@@ -103,12 +108,18 @@ void TreeInfo::init(const Options &opts, const Tree& tree, const PartitionedMSA&
 
 TreeInfo::~TreeInfo ()
 {
+  for (auto sumtable: _sumtables)
+    pll_aligned_free(sumtable);
+
   if (_pll_treeinfo)
   {
     for (unsigned int i = 0; i < _pll_treeinfo->partition_count; ++i)
     {
       if (_pll_treeinfo->partitions[i])
+      {
         pll_partition_destroy(_pll_treeinfo->partitions[i]);
+        MemoryBudget::release(_partition_mem[i]);
+      }
     }
 
     pll_utree_graph_destroy(_pll_treeinfo->root, NULL);
@@ -167,7 +178,16 @@ void TreeInfo::tree(const Tree& tree)
 
 double TreeInfo::loglh(bool incremental)
 {
-  return pllmod_treeinfo_compute_loglh(_pll_treeinfo, incremental ? 1 : 0);
+  RAXML_TRACE_SPAN("loglh");
+
+  if (!HotPathStats::enabled())
+    return pllmod_treeinfo_compute_loglh(_pll_treeinfo, incremental ? 1 : 0);
+
+  HotPathStats::count_loglh_begin(*_pll_treeinfo, incremental);
+  double loglh = pllmod_treeinfo_compute_loglh(_pll_treeinfo, incremental ? 1 : 0);
+  HotPathStats::count_loglh_end(*_pll_treeinfo);
+
+  return loglh;
 }
 
 void TreeInfo::model(size_t partition_id, const Model& model)
@@ -188,11 +208,14 @@ void TreeInfo::model(size_t partition_id, const Model& model)
 
 double TreeInfo::optimize_branches(double lh_epsilon, double brlen_smooth_factor)
 {
+  RAXML_TRACE_SPAN("optimize_branches");
+
   /* update all CLVs and p-matrices before calling BLO */
   double new_loglh = loglh();
 
   if (_pll_treeinfo->params_to_optimize[0] & PLLMOD_OPT_PARAM_BRANCHES_ITERATIVE)
   {
+    HotPathStats::RoutineScope stats_scope(OptRoutine::brlen);
     int max_iters = brlen_smooth_factor * RAXML_BRLEN_SMOOTHINGS;
     new_loglh = -1 * pllmod_algo_opt_brlen_treeinfo(_pll_treeinfo,
                                                     _brlen_min,
@@ -213,6 +236,7 @@ double TreeInfo::optimize_branches(double lh_epsilon, double brlen_smooth_factor
   if (_pll_treeinfo->brlen_linkage == PLLMOD_COMMON_BRLEN_SCALED &&
       _pll_treeinfo->partition_count > 1)
   {
+    HotPathStats::RoutineScope stats_scope(OptRoutine::brlen_scalers);
     new_loglh = -1 * pllmod_algo_opt_brlen_scalers_treeinfo(_pll_treeinfo,
                                                             RAXML_BRLEN_SCALER_MIN,
                                                             RAXML_BRLEN_SCALER_MAX,
@@ -240,6 +264,8 @@ double TreeInfo::optimize_params(int params_to_optimize, double lh_epsilon)
   /* optimize SUBSTITUTION RATES */
   if (params_to_optimize & PLLMOD_OPT_PARAM_SUBST_RATES)
   {
+    RAXML_TRACE_SPAN("opt_subst_rates");
+    HotPathStats::RoutineScope stats_scope(OptRoutine::subst_rates);
     new_loglh = -1 * pllmod_algo_opt_subst_rates_treeinfo(_pll_treeinfo,
                                                           0,
                                                           PLLMOD_OPT_MIN_SUBST_RATE,
@@ -257,6 +283,8 @@ double TreeInfo::optimize_params(int params_to_optimize, double lh_epsilon)
   /* optimize BASE FREQS */
   if (params_to_optimize & PLLMOD_OPT_PARAM_FREQUENCIES)
   {
+    RAXML_TRACE_SPAN("opt_frequencies");
+    HotPathStats::RoutineScope stats_scope(OptRoutine::frequencies);
     new_loglh = -1 * pllmod_algo_opt_frequencies_treeinfo(_pll_treeinfo,
                                                           0,
                                                           PLLMOD_OPT_MIN_FREQ,
@@ -276,6 +304,7 @@ double TreeInfo::optimize_params(int params_to_optimize, double lh_epsilon)
       (params_to_optimize & PLLMOD_OPT_PARAM_ALPHA) &&
       (params_to_optimize & PLLMOD_OPT_PARAM_PINV))
   {
+    RAXML_TRACE_SPAN("opt_alpha_pinv");
     new_loglh = -1 * pllmod_algo_opt_alpha_pinv_treeinfo(_pll_treeinfo,
                                                          0,
                                                          PLLMOD_OPT_MIN_ALPHA,
@@ -296,6 +325,8 @@ double TreeInfo::optimize_params(int params_to_optimize, double lh_epsilon)
     /* optimize ALPHA */
     if (params_to_optimize & PLLMOD_OPT_PARAM_ALPHA)
     {
+      RAXML_TRACE_SPAN("opt_alpha");
+      HotPathStats::RoutineScope stats_scope(OptRoutine::alpha);
       new_loglh = -1 * pllmod_algo_opt_onedim_treeinfo(_pll_treeinfo,
                                                         PLLMOD_OPT_PARAM_ALPHA,
                                                         PLLMOD_OPT_MIN_ALPHA,
@@ -312,6 +343,8 @@ double TreeInfo::optimize_params(int params_to_optimize, double lh_epsilon)
     /* optimize PINV */
     if (params_to_optimize & PLLMOD_OPT_PARAM_PINV)
     {
+      RAXML_TRACE_SPAN("opt_pinv");
+      HotPathStats::RoutineScope stats_scope(OptRoutine::pinv);
       new_loglh = -1 * pllmod_algo_opt_onedim_treeinfo(_pll_treeinfo,
                                                         PLLMOD_OPT_PARAM_PINV,
                                                         PLLMOD_OPT_MIN_PINV,
@@ -329,6 +362,8 @@ double TreeInfo::optimize_params(int params_to_optimize, double lh_epsilon)
   /* optimize FREE RATES and WEIGHTS */
   if (params_to_optimize & PLLMOD_OPT_PARAM_FREE_RATES)
   {
+    RAXML_TRACE_SPAN("opt_rates_weights");
+    HotPathStats::RoutineScope stats_scope(OptRoutine::free_rates);
     new_loglh = -1 * pllmod_algo_opt_rates_weights_treeinfo (_pll_treeinfo,
                                                           RAXML_FREERATE_MIN,
                                                           RAXML_FREERATE_MAX,
@@ -361,6 +396,9 @@ double TreeInfo::optimize_params(int params_to_optimize, double lh_epsilon)
 
 double TreeInfo::spr_round(spr_round_params& params)
 {
+  RAXML_TRACE_SPAN("spr_round");
+  HotPathStats::RoutineScope stats_scope(OptRoutine::spr_round);
+
   double loglh = pllmod_algo_spr_round(_pll_treeinfo, params.radius_min, params.radius_max,
                                params.ntopol_keep, params.thorough, _brlen_opt_method,
                                _brlen_min, _brlen_max, RAXML_BRLEN_SMOOTHINGS,
@@ -375,6 +413,77 @@ double TreeInfo::spr_round(spr_round_params& params)
   return loglh;
 }
 
+void TreeInfo::update_prob_matrices(bool update_all)
+{
+  pllmod_treeinfo_update_prob_matrices(_pll_treeinfo, update_all ? 1 : 0);
+
+  libpll_check_error("ERROR in p-matrix update");
+}
+
+double TreeInfo::loglh_root_update()
+{
+  /* simulate a local change (e.g. new branch length) next to the virtual root:
+   * only one p-matrix and one CLV must be recomputed */
+  pllmod_treeinfo_invalidate_pmatrix(_pll_treeinfo, _pll_treeinfo->root);
+  pllmod_treeinfo_invalidate_clv(_pll_treeinfo, _pll_treeinfo->root->back);
+
+  return loglh(true);
+}
+
+void TreeInfo::root_derivatives(double& d_f, double& dd_f)
+{
+  const pll_unode_t * root = _pll_treeinfo->root;
+  double derivs[2] = {0., 0.};
+
+  _sumtables.resize(_pll_treeinfo->partition_count, nullptr);
+
+  for (size_t p = 0; p < _pll_treeinfo->partition_count; ++p)
+  {
+    pll_partition_t * partition = _pll_treeinfo->partitions[p];
+    if (!partition)
+      continue;
+
+    if (!_sumtables[p])
+    {
+      const size_t sites_alloc = partition->sites +
+                                 (partition->asc_bias_alloc ? partition->states : 0);
+      _sumtables[p] = (double *) pll_aligned_alloc(sites_alloc * partition->rate_cats *
+                                                   partition->states_padded * sizeof(double),
+                                                   partition->alignment);
+      if (!_sumtables[p])
+        throw runtime_error("Cannot allocate memory for sumtable");
+    }
+
+    double brlen = _pll_treeinfo->branch_lengths[p][root->pmatrix_index];
+    if (_pll_treeinfo->brlen_scalers)
+      brlen *= _pll_treeinfo->brlen_scalers[p];
+
+    pll_update_sumtable(partition, root->clv_index, root->back->clv_index,
+                        root->scaler_index, root->back->scaler_index,
+                        _pll_treeinfo->param_indices[p], _sumtables[p]);
+
+    double part_d_f, part_dd_f;
+    pll_compute_likelihood_derivatives(partition, root->scaler_index, root->back->scaler_index,
+                                       brlen, _pll_treeinfo->param_indices[p], _sumtables[p],
+                                       &part_d_f, &part_dd_f);
+
+    derivs[0] += part_d_f;
+    derivs[1] += part_dd_f;
+  }
+
+  libpll_check_error("ERROR computing likelihood derivatives");
+
+  /* sum up over all threads/ranks, as done in branch length optimization */
+  if (_pll_treeinfo->parallel_reduce_cb)
+  {
+    _pll_treeinfo->parallel_reduce_cb(_pll_treeinfo->parallel_context, derivs, 2,
+                                      PLLMOD_COMMON_REDUCE_SUM);
+  }
+
+  d_f = derivs[0];
+  dd_f = derivs[1];
+}
+
 void TreeInfo::set_topology_constraint(const Tree& cons_tree)
 {
   if (!cons_tree.empty())
@@ -419,36 +528,77 @@ void assign(Model& model, const TreeInfo& treeinfo, size_t partition_id)
     model.brlen_scaler(pll_treeinfo.brlen_scalers[partition_id]);
 }
 
-void build_clv(ProbVector::const_iterator probs, size_t sites, WeightVector::const_iterator weights,
-               pll_partition_t* partition, bool normalize, std::vector<double>& clv)
+/* build tip CLV from state probabilities directly in partition memory, skipping
+ * sites with zero weight (NB: clv has to be padded, but msa arrays are not!) */
+static void set_tip_clv(pll_partition_t* partition, unsigned int tip_id,
+                        ProbVector::const_iterator probs, size_t sites,
+                        const WeightType * weights, bool normalize)
 {
+  assert(!(partition->attributes & PLL_ATTRIB_PATTERN_TIP));
+
   const auto states = partition->states;
-  auto clvp = clv.begin();
+  const auto states_padded = partition->states_padded;
+  const auto rate_cats = partition->rate_cats;
+  double * clvp = partition->clv[tip_id];
+  size_t pos = 0;
 
-  for (size_t i = 0; i < sites; ++i)
+  for (size_t i = 0; i < sites; ++i, probs += states)
   {
-    if (weights[i] > 0)
+    if (weights && !weights[i])
+      continue;
+
+    double sum = 0.;
+    for (size_t j = 0; j < states; ++j)
+      sum += probs[j];
+
+    const double * site_clv = clvp;
+    for (size_t j = 0; j < states; ++j)
     {
-      double sum = 0.;
-      for (size_t j = 0; j < states; ++j)
-        sum += probs[j];
+      if (sum > 0.)
+        clvp[j] =  normalize ? probs[j] / sum : probs[j];
+      else
+        clvp[j] = 1.0;
+    }
+    clvp += states_padded;
+
+    /* tip CLV is the same for all rate categories */
+    for (size_t r = 1; r < rate_cats; ++r, clvp += states_padded)
+      std::copy(site_clv, site_clv + states, clvp);
 
-      for (size_t j = 0; j < states; ++j)
+    pos++;
+  }
+
+  assert(pos == partition->sites);
+
+  /* ascertainment bias correction: one additional site per state */
+  if (partition->asc_bias_alloc)
+  {
+    for (size_t s = 0; s < states; ++s)
+    {
+      for (size_t r = 0; r < rate_cats; ++r, clvp += states_padded)
       {
-        if (sum > 0.)
-          clvp[j] =  normalize ? probs[j] / sum : probs[j];
-        else
-          clvp[j] = 1.0;
+        for (size_t j = 0; j < states; ++j)
+          clvp[j] = (j == s) ? 1. : 0.;
       }
-
-      clvp += states;
     }
-
-    /* NB: clv has to be padded, but msa arrays are not! */
-    probs += states;
   }
+}
+
+static void set_partition_tip_clvs(const MSA& msa, const IDVector& tip_msa_idmap,
+                                   const PartitionRange& part_region,
+                                   pll_partition_t* partition, const WeightType * weights)
+{
+  assert(partition->states == msa.states());
+
+  const bool normalize = !msa.normalized();
 
-  assert(clvp == clv.end());
+  /* every thread only builds the tips of its own partition slice */
+  for (unsigned int tip_id = 0; tip_id < partition->tips; ++tip_id)
+  {
+    auto seq_id = tip_msa_idmap.empty() ? tip_id : tip_msa_idmap[tip_id];
+    auto prob_start = msa.probs(seq_id, part_region.start);
+    set_tip_clv(partition, tip_id, prob_start, part_region.length, weights, normalize);
+  }
 }
 
 void set_partition_tips(const Options& opts, const MSA& msa, const IDVector& tip_msa_idmap,
@@ -460,24 +610,7 @@ void set_partition_tips(const Options& opts, const MSA& msa, const IDVector& tip
     pll_set_pattern_weights(partition, msa.weights().data() + part_region.start);
 
   if (opts.use_prob_msa && msa.probabilistic())
-  {
-    assert(!(partition->attributes & PLL_ATTRIB_PATTERN_TIP));
-    assert(partition->states == msa.states());
-
-    auto normalize = !msa.normalized();
-    auto weights_start = msa.weights().cbegin() + part_region.start;
-
-    // we need a libpll function for that!
-    auto clv_size = partition->sites * partition->states;
-    std::vector<double> tmp_clv(clv_size);
-    for (size_t tip_id = 0; tip_id < partition->tips; ++tip_id)
-    {
-      auto seq_id = tip_msa_idmap.empty() ? tip_id : tip_msa_idmap[tip_id];
-      auto prob_start = msa.probs(seq_id, part_region.start);
-      build_clv(prob_start, partition->sites, weights_start, partition, normalize, tmp_clv);
-      pll_set_tip_clv(partition, tip_id, tmp_clv.data(), PLL_FALSE);
-    }
-  }
+    set_partition_tip_clvs(msa, tip_msa_idmap, part_region, partition, nullptr);
   else
   {
     for (size_t tip_id = 0; tip_id < partition->tips; ++tip_id)
@@ -508,24 +641,7 @@ void set_partition_tips(const Options& opts, const MSA& msa, const IDVector& tip
 
   /* now set tip sequences, ignoring all columns with zero weights */
   if (opts.use_prob_msa && msa.probabilistic())
-  {
-    assert(!(partition->attributes & PLL_ATTRIB_PATTERN_TIP));
-    assert(partition->states == msa.states());
-
-    auto normalize = !msa.normalized();
-    auto weights_start = msa.weights().cbegin() + part_region.start;
-
-    // we need a libpll function for that!
-    auto clv_size = part_region.length * partition->states;
-    std::vector<double> tmp_clv(clv_size);
-    for (size_t tip_id = 0; tip_id < partition->tips; ++tip_id)
-    {
-      auto seq_id = tip_msa_idmap.empty() ? tip_id : tip_msa_idmap[tip_id];
-      auto prob_start = msa.probs(seq_id, part_region.start);
-      build_clv(prob_start, part_region.length, weights_start, partition, normalize, tmp_clv);
-      pll_set_tip_clv(partition, tip_id, tmp_clv.data(), PLL_FALSE);
-    }
-  }
+    set_partition_tip_clvs(msa, tip_msa_idmap, part_region, partition, weights.data() + pstart);
   else
   {
     std::vector<char> bs_seq(part_region.length);
@@ -548,21 +664,9 @@ void set_partition_tips(const Options& opts, const MSA& msa, const IDVector& tip
   pll_set_pattern_weights(partition, comp_weights.data());
 }
 
-pll_partition_t* create_pll_partition(const Options& opts, const PartitionInfo& pinfo,
-                                      const IDVector& tip_msa_idmap,
-                                      const PartitionRange& part_region, const uintVector& weights)
+unsigned int pll_partition_attributes(const Options& opts, const Model& model,
+                                      size_t part_length, bool part_master)
 {
-  const MSA& msa = pinfo.msa();
-  const Model& model = pinfo.model();
-
-  /* part_length doesn't include columns with zero weight */
-  const size_t part_length = weights.empty() ? part_region.length :
-                             std::count_if(weights.begin() + part_region.start,
-                                           weights.begin() + part_region.start + part_region.length,
-                                           [](uintVector::value_type w) -> bool
-                                             { return w > 0; }
-                                           );
-
   unsigned int attrs = opts.simd_arch;
 
   if (opts.use_rate_scalers && model.num_ratecats() > 1)
@@ -591,13 +695,60 @@ pll_partition_t* create_pll_partition(const Options& opts, const PartitionInfo&
 
   // NOTE: if partition is split among multiple threads, asc. bias correction must be applied only once!
   if (model.ascbias_type() == AscBiasCorrection::lewis ||
-      (model.ascbias_type() != AscBiasCorrection::none && part_region.master()))
+      (model.ascbias_type() != AscBiasCorrection::none && part_master))
   {
     attrs |=  PLL_ATTRIB_AB_FLAG;
     attrs |= (unsigned int) model.ascbias_type();
   }
 
+  return attrs;
+}
+
+MemoryUsage treeinfo_mem_size(const Options& opts, const PartitionedMSA& parted_msa,
+                              const PartitionAssignment& part_assign)
+{
+  MemoryUsage usage;
+  BasicTree tree(parted_msa.taxon_count());
+  for (const auto& range: part_assign)
+  {
+    const Model& model = parted_msa.model(range.part_id);
+    const unsigned int attrs = pll_partition_attributes(opts, model, range.length,
+                                                        range.master());
+
+    usage += pll_partition_mem_size(tree.num_tips(), tree.num_inner(), model.num_states(),
+                                    range.length, tree.num_branches(), model.num_ratecats(),
+                                    tree.num_inner(), attrs);
+  }
+  return usage;
+}
+
+pll_partition_t* create_pll_partition(const Options& opts, const PartitionInfo& pinfo,
+                                      const IDVector& tip_msa_idmap,
+                                      const PartitionRange& part_region, const uintVector& weights,
+                                      MemoryUsage& mem_size)
+{
+  const MSA& msa = pinfo.msa();
+  const Model& model = pinfo.model();
+
+  /* part_length doesn't include columns with zero weight */
+  const size_t part_length = weights.empty() ? part_region.length :
+                             std::count_if(weights.begin() + part_region.start,
+                                           weights.begin() + part_region.start + part_region.length,
+                                           [](uintVector::value_type w) -> bool
+                                             { return w > 0; }
+                                           );
+
+  const unsigned int attrs = pll_partition_attributes(opts, model, part_length,
+                                                     part_region.master());
+
   BasicTree tree(msa.size());
+
+  /* fail before allocating if partition would exceed the memory limit */
+  mem_size = pll_partition_mem_size(tree.num_tips(), tree.num_inner(), model.num_states(),
+                                    part_length, tree.num_branches(), model.num_ratecats(),
+                                    tree.num_inner(), attrs);
+  MemoryBudget::allocate(mem_size);
+
   pll_partition_t * partition = pll_partition_create(
       tree.num_tips(),         /* number of tip sequences */
       tree.num_inner(),        /* number of CLV buffers */
@@ -610,6 +761,12 @@ pll_partition_t* create_pll_partition(const Options& opts, const PartitionInfo&
       attrs                    /* list of flags (SSE3/AVX, TIP-INNER special cases etc.) */
   );
 
+  if (!partition)
+  {
+    MemoryBudget::release(mem_size);
+    mem_size = MemoryUsage();
+  }
+
   libpll_check_error("ERROR creating pll_partition");
   assert(partition);
 
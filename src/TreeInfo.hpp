@@ -5,6 +5,7 @@
 #include "Tree.hpp"
 #include "Options.hpp"
 #include "loadbalance/PartitionAssignment.hpp"
+#include "MemoryBudget.hpp"
 
 struct spr_round_params
 {
@@ -59,6 +60,11 @@ public:
   double optimize_branches(double lh_epsilon, double brlen_smooth_factor);
   double spr_round(spr_round_params& params);
 
+  /* low-level likelihood kernels (used for benchmarking) */
+  void update_prob_matrices(bool update_all);
+  double loglh_root_update();
+  void root_derivatives(double& d_f, double& dd_f);
+
 private:
   pllmod_treeinfo_t * _pll_treeinfo;
   IDSet _parts_master;
@@ -66,6 +72,8 @@ private:
   double _brlen_min;
   double _brlen_max;
   doubleVector _partition_contributions;
+  std::vector<double *> _sumtables;
+  std::vector<MemoryUsage> _partition_mem;
 
   void init(const Options &opts, const Tree& tree, const PartitionedMSA& parted_msa,
             const IDVector& tip_msa_idmap, const PartitionAssignment& part_assign,
@@ -75,9 +83,19 @@ private:
 void assign(PartitionedMSA& parted_msa, const TreeInfo& treeinfo);
 void assign(Model& model, const TreeInfo& treeinfo, size_t partition_id);
 
+unsigned int pll_partition_attributes(const Options& opts, const Model& model,
+                                      size_t part_length, bool part_master);
+
+/* estimated memory footprint of the pll partitions created by a TreeInfo instance
+ * for the given partition assignment */
+MemoryUsage treeinfo_mem_size(const Options& opts, const PartitionedMSA& parted_msa,
+                              const PartitionAssignment& part_assign);
 
+/* mem_size: memory charged to the MemoryBudget for the new partition, to be released
+ * after the partition is destroyed */
 pll_partition_t* create_pll_partition(const Options& opts, const PartitionInfo& pinfo,
                                       const IDVector& tip_msa_idmap,
-                                      const PartitionRange& part_region, const uintVector& weights);
+                                      const PartitionRange& part_region, const uintVector& weights,
+                                      MemoryUsage& mem_size);
 
 #endif /* RAXML_TREEINFO_HPP_ */
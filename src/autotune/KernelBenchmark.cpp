@@ -0,0 +1,219 @@
+#include <random>
+
+#include "KernelBenchmark.hpp"
+#include "../TreeInfo.hpp"
+
+using namespace std;
+
+static const size_t BENCH_MIN_REPS = 3;
+static const size_t BENCH_MAX_REPS = 100000;
+
+/* average runtime of kernel (in seconds), must be called by all threads of the context */
+static double time_kernel(const function<void()>& kernel, double min_time)
+{
+  /* warm-up call, also used to estimate the number of repetitions */
+  ParallelContext::thread_barrier();
+  double start = sysutil_gettime();
+  kernel();
+  ParallelContext::thread_barrier();
+  double elapsed = sysutil_gettime() - start;
+
+  size_t reps = elapsed > 0. ? (size_t) (min_time / elapsed) : BENCH_MAX_REPS;
+  reps = std::min(std::max(reps, BENCH_MIN_REPS), BENCH_MAX_REPS);
+
+  /* all threads must perform the same number of calls */
+  ParallelContext::thread_broadcast(0, &reps, sizeof(size_t));
+
+  start = sysutil_gettime();
+  for (size_t i = 0; i < reps; ++i)
+    kernel();
+  ParallelContext::thread_barrier();
+
+  return (sysutil_gettime() - start) / reps;
+}
+
+KernelBenchmark::KernelBenchmark(const Options& opts, const PartitionedMSA& parted_msa,
+                                 const IDVector& tip_msa_idmap, const Tree& tree,
+                                 LoadBalancer& load_balancer, double min_time) :
+    _opts(opts), _parted_msa(parted_msa), _tip_msa_idmap(tip_msa_idmap), _tree(tree),
+    _load_balancer(load_balancer), _min_time(min_time)
+{
+}
+
+void KernelBenchmark::thread_run(const Options& opts, const PartitionAssignment& part_assign,
+                                 KernelTimings& timings) const
+{
+  TreeInfo treeinfo(opts, _tree, _parted_msa, _tip_msa_idmap, part_assign);
+
+  double d_f, dd_f;
+  double full_loglh = time_kernel([&treeinfo]() { treeinfo.loglh(false); }, _min_time);
+  double partial_loglh = time_kernel([&treeinfo]() { treeinfo.loglh_root_update(); },
+                                     _min_time);
+  double derivatives = time_kernel([&]() { treeinfo.root_derivatives(d_f, dd_f); }, _min_time);
+  double pmatrix = time_kernel([&treeinfo]() { treeinfo.update_prob_matrices(true); },
+                               _min_time);
+
+  if (ParallelContext::thread_id() == 0)
+  {
+    timings.full_loglh = full_loglh;
+    timings.partial_loglh = partial_loglh;
+    timings.derivatives = derivatives;
+    timings.pmatrix = pmatrix;
+  }
+}
+
+KernelTimings KernelBenchmark::run(unsigned int simd_arch, size_t num_threads)
+{
+  KernelTimings timings;
+  timings.simd_arch = simd_arch;
+  timings.num_threads = num_threads;
+
+  Options opts = _opts;
+  opts.simd_arch = simd_arch;
+  opts.num_threads = num_threads;
+
+  /* distribute sites across threads exactly as in balance_load() */
+  PartitionAssignment part_sizes;
+  size_t i = 0;
+  for (auto const& pinfo: _parted_msa.part_list())
+  {
+    part_sizes.assign_sites(i, 0, pinfo.msa().length(), pinfo.model().clv_entry_size());
+    ++i;
+  }
+  auto part_assign = _load_balancer.get_all_assignments(part_sizes, num_threads);
+
+  const size_t reduce_buffer_size = std::max(1024lu, 2 * sizeof(double) *
+                                             _parted_msa.part_count() * num_threads);
+
+  ParallelContext ctx(num_threads);
+  auto thread_main = [&](size_t thread_id)
+      {
+        ParallelContext::ThreadScope scope(ctx, thread_id);
+        if (thread_id == 0)
+          ParallelContext::resize_buffer(reduce_buffer_size);
+        ParallelContext::thread_barrier();
+        thread_run(opts, part_assign.at(thread_id), timings);
+      };
+
+#ifdef _RAXML_PTHREADS
+  vector<ThreadType> threads;
+  for (size_t t = 1; t < num_threads; ++t)
+    threads.emplace_back(thread_main, t);
+#else
+  assert(num_threads == 1);
+#endif
+
+  thread_main(0);
+
+#ifdef _RAXML_PTHREADS
+  for (auto& t: threads)
+    t.join();
+#endif
+
+  return timings;
+}
+
+double KernelBenchmark::full_loglh_flops() const
+{
+  /* full traversal: (taxa-2) inner CLVs + evaluation at the root */
+  double flops = 0.;
+  const double inner_count = _parted_msa.taxon_count() - 2;
+  for (auto const& pinfo: _parted_msa.part_list())
+  {
+    const double s = pinfo.model().num_states();
+    const double site_rates = (double) pinfo.msa().length() * pinfo.model().num_ratecats();
+    flops += site_rates * (inner_count * (4*s*s + s) + 2*s*s + 2*s);
+  }
+  return flops;
+}
+
+double KernelBenchmark::partial_loglh_flops() const
+{
+  /* one p-matrix, one CLV + evaluation at the root */
+  double flops = 0.;
+  for (auto const& pinfo: _parted_msa.part_list())
+  {
+    const double s = pinfo.model().num_states();
+    const double rates = pinfo.model().num_ratecats();
+    const double site_rates = (double) pinfo.msa().length() * rates;
+    flops += rates * 2*s*s*s + site_rates * (4*s*s + s + 2*s*s + 2*s);
+  }
+  return flops;
+}
+
+double KernelBenchmark::derivatives_flops() const
+{
+  /* sumtable update + first and second derivative */
+  double flops = 0.;
+  for (auto const& pinfo: _parted_msa.part_list())
+  {
+    const double s = pinfo.model().num_states();
+    const double site_rates = (double) pinfo.msa().length() * pinfo.model().num_ratecats();
+    flops += site_rates * (2*s*s + 6*s);
+  }
+  return flops;
+}
+
+double KernelBenchmark::pmatrix_flops() const
+{
+  /* P = U * exp(D*t) * U^-1 for every branch and rate category */
+  double flops = 0.;
+  const double branch_count = 2 * _parted_msa.taxon_count() - 3;
+  for (auto const& pinfo: _parted_msa.part_list())
+  {
+    const double s = pinfo.model().num_states();
+    flops += branch_count * pinfo.model().num_ratecats() * 2*s*s*s;
+  }
+  return flops;
+}
+
+MSA random_msa(size_t taxa, size_t sites, size_t states, double gap_rate, unsigned int seed)
+{
+  string alphabet;
+  switch (states)
+  {
+    case 2:
+      alphabet = "01";
+      break;
+    case 4:
+      alphabet = "ACGT";
+      break;
+    case 20:
+      alphabet = "ARNDCQEGHILKMFPSTWYV";
+      break;
+    default:
+      if (states < 2 || states > 32)
+        throw runtime_error("Unsupported number of states: " + to_string(states));
+      alphabet = string("0123456789ABCDEFGHIJKLMNOPQRSTUV").substr(0, states);
+  }
+
+  mt19937 gen(seed);
+  uniform_int_distribution<size_t> state_distr(0, states - 1);
+  bernoulli_distribution gap_distr(gap_rate);
+
+  MSA msa(sites);
+  string seq(sites, '-');
+  for (size_t i = 0; i < taxa; ++i)
+  {
+    for (auto& c: seq)
+      c = gap_distr(gen) ? '-' : alphabet[state_distr(gen)];
+    msa.append(seq, "T" + to_string(i+1));
+  }
+
+  return msa;
+}
+
+string random_msa_default_model(size_t states)
+{
+  switch (states)
+  {
+    case 2:
+      return "BIN+G";
+    case 4:
+      return "GTR+G";
+    case 20:
+      return "LG+G";
+    default:
+      return "MULTI" + to_string(states) + "_GTR+G";
+  }
+}
@@ -0,0 +1,57 @@
+#ifndef RAXML_KERNELBENCHMARK_HPP_
+#define RAXML_KERNELBENCHMARK_HPP_
+
+#include "../Options.hpp"
+#include "../PartitionedMSA.hpp"
+#include "../Tree.hpp"
+#include "../loadbalance/LoadBalancer.hpp"
+
+/* average time per call (in seconds) for each likelihood kernel */
+struct KernelTimings
+{
+  unsigned int simd_arch;
+  size_t num_threads;
+  double full_loglh;
+  double partial_loglh;
+  double derivatives;
+  double pmatrix;
+};
+
+/* Likelihood kernel benchmark: all timings are taken through the same TreeInfo/pll_partition
+ * setup as in the tree search, with sites distributed across threads by the load balancer */
+class KernelBenchmark
+{
+public:
+  KernelBenchmark(const Options& opts, const PartitionedMSA& parted_msa,
+                  const IDVector& tip_msa_idmap, const Tree& tree, LoadBalancer& load_balancer,
+                  double min_time);
+
+  KernelTimings run(unsigned int simd_arch, size_t num_threads);
+
+  /* approximate number of floating point operations per kernel call, summed over partitions
+   * (ignoring the savings from tip-inner, site repeats and the cost of numerical scaling) */
+  double full_loglh_flops() const;
+  double partial_loglh_flops() const;
+  double derivatives_flops() const;
+  double pmatrix_flops() const;
+
+  size_t num_patterns() const { return _parted_msa.total_length(); }
+
+private:
+  const Options& _opts;
+  const PartitionedMSA& _parted_msa;
+  const IDVector& _tip_msa_idmap;
+  const Tree& _tree;
+  LoadBalancer& _load_balancer;
+  double _min_time;
+
+  void thread_run(const Options& opts, const PartitionAssignment& part_assign,
+                  KernelTimings& timings) const;
+};
+
+/* synthetic alignment with uniformly distributed characters: states = 2 (binary),
+ * 4 (DNA), 20 (protein) or up to 32 (multistate) */
+MSA random_msa(size_t taxa, size_t sites, size_t states, double gap_rate, unsigned int seed);
+std::string random_msa_default_model(size_t states);
+
+#endif /* RAXML_KERNELBENCHMARK_HPP_ */
@@ -6,6 +6,7 @@ BootstopCheck::BootstopCheck(size_t max_bs_trees)
 {
   _max_bs_trees = max_bs_trees;
   _num_bs_trees = 0;
+  _capacity = 0;
   _pll_splits_hash = nullptr;
 }
 
@@ -17,12 +18,15 @@ BootstopCheck::~BootstopCheck ()
 
 void BootstopCheck::add_bootstrap_tree(const Tree& tree)
 {
-  if (_num_bs_trees == _max_bs_trees)
+  if (_max_bs_trees && _num_bs_trees == _max_bs_trees)
   {
     throw runtime_error("BootstopCheck::add_bootstrap_tree: "
         "Maximum number of bootstrap trees reached: " + to_string(_max_bs_trees));
   }
 
+  if (_num_bs_trees == _capacity)
+    grow_capacity();
+
   if (!_pll_splits_hash)
     _pll_splits_hash = pllmod_utree_split_hashtable_create(tree.num_tips(), 0);
 
@@ -50,7 +54,7 @@ void BootstopCheck::add_bootstrap_tree(const Tree& tree)
 
     /* new split -> create bit vector with tree occurence flags */
     if (e->bip_number ==_split_occurence.size())
-      _split_occurence.emplace_back(bitVector(_max_bs_trees));
+      _split_occurence.emplace_back(bitVector(_capacity));
 //        _split_occurence.emplace_back(bitVector());
 
     _split_occurence[e->bip_number][_num_bs_trees] = true;
@@ -64,6 +68,18 @@ void BootstopCheck::add_bootstrap_tree(const Tree& tree)
   _num_bs_trees++;
 }
 
+void BootstopCheck::grow_capacity()
+{
+  /* number of trees is not known in advance -> grow occurrence vectors geometrically */
+  if (_max_bs_trees)
+    _capacity = _max_bs_trees;
+  else
+    _capacity = std::max<size_t>(2 * _capacity, 64);
+
+  for (auto& occ: _split_occurence)
+    occ.resize(_capacity);
+}
+
 splitEntryVector BootstopCheck::all_splits()
 {
   splitEntryVector all_splits;
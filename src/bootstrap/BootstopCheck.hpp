@@ -34,16 +34,19 @@ public:
   bool converged(unsigned long random_seed = 0);
 
   size_t num_bs_trees() const { return _num_bs_trees; }
+  /* 0 means unlimited number of bootstrap trees */
   size_t max_bs_trees() const { return _max_bs_trees; }
   void max_bs_trees(size_t val) { if (!_num_bs_trees) _max_bs_trees = val; }
 
 protected:
   size_t _num_bs_trees;
   size_t _max_bs_trees;
+  size_t _capacity;
   bitv_hashtable_t * _pll_splits_hash;
   std::vector<bitVector> _split_occurence;
 
   splitEntryVector all_splits();
+  void grow_capacity();
 
   virtual bool check_convergence(RandomGenerator& gen) = 0;
 };
@@ -15,6 +15,7 @@ BootstrapReplicate BootstrapGenerator::generate(const PartitionedMSA& parted_msa
                                                 unsigned long random_seed)
 {
   BootstrapReplicate result;
+  result.seed = random_seed;
 
   RandomGenerator gen(random_seed);
 
@@ -5,7 +5,8 @@
 
 struct BootstrapReplicate
 {
-  WeightVectorList site_weights;
+  unsigned long seed;
+  WeightVectorList site_weights;    /* empty if weights are to be re-generated from seed */
 };
 
 typedef std::vector<BootstrapReplicate> BootstrapReplicateList;
@@ -0,0 +1,109 @@
+#include "BootstrapScheduler.hpp"
+
+using namespace std;
+
+const size_t BootstrapScheduler::NONE;
+
+BootstrapScheduler::BootstrapScheduler(size_t num_replicates, size_t num_workers,
+                                       double straggler_factor) :
+    _state(num_replicates, ReplicateState::pending), _start_time(num_replicates, 0.),
+    _num_copies(num_replicates, 0), _worker_replicate(num_workers, NONE), _next_pending(0),
+    _num_completed(0), _num_committed(0), _num_reassigned(0), _total_runtime(0.),
+    _straggler_factor(straggler_factor), _stopped(false)
+{
+}
+
+size_t BootstrapScheduler::assign(size_t worker, double now)
+{
+  if (_worker_replicate.at(worker) != NONE)
+    throw runtime_error("BootstrapScheduler: worker " + to_string(worker) + " is busy");
+
+  if (_stopped)
+    return NONE;
+
+  size_t rep = NONE;
+  if (_next_pending < num_replicates())
+  {
+    rep = _next_pending++;
+    _state[rep] = ReplicateState::running;
+    _start_time[rep] = now;
+  }
+  else if (_num_completed > 0)
+  {
+    /* no pending replicates left: look for the oldest straggler which is not duplicated yet */
+    const double max_runtime = _straggler_factor * _total_runtime / _num_completed;
+    for (size_t r = _num_committed; r < _next_pending; ++r)
+    {
+      if (_state[r] == ReplicateState::running && _num_copies[r] == 1 &&
+          now - _start_time[r] > max_runtime &&
+          (rep == NONE || _start_time[r] < _start_time[rep]))
+      {
+        rep = r;
+      }
+    }
+
+    if (rep != NONE)
+      _num_reassigned++;
+  }
+
+  if (rep != NONE)
+  {
+    _num_copies[rep]++;
+    _worker_replicate[worker] = rep;
+  }
+
+  return rep;
+}
+
+double BootstrapScheduler::straggler_time() const
+{
+  if (_stopped || _num_completed == 0 || _next_pending < num_replicates())
+    return -1.;
+
+  const double max_runtime = _straggler_factor * _total_runtime / _num_completed;
+  double result = -1.;
+  for (size_t r = _num_committed; r < _next_pending; ++r)
+  {
+    if (_state[r] == ReplicateState::running && _num_copies[r] == 1)
+    {
+      const double t = _start_time[r] + max_runtime;
+      if (result < 0. || t < result)
+        result = t;
+    }
+  }
+
+  return result;
+}
+
+bool BootstrapScheduler::complete(size_t worker, size_t replicate, double now)
+{
+  if (_worker_replicate.at(worker) != replicate)
+  {
+    throw runtime_error("BootstrapScheduler: replicate " + to_string(replicate) +
+                        " was not assigned to worker " + to_string(worker));
+  }
+
+  _worker_replicate[worker] = NONE;
+  _num_copies[replicate]--;
+
+  if (_state[replicate] == ReplicateState::completed)
+    return false;
+
+  _state[replicate] = ReplicateState::completed;
+  _num_completed++;
+  _total_runtime += now - _start_time[replicate];
+
+  return true;
+}
+
+bool BootstrapScheduler::commit_ready() const
+{
+  return _num_committed < num_replicates() &&
+         _state[_num_committed] == ReplicateState::completed;
+}
+
+size_t BootstrapScheduler::commit()
+{
+  assert(commit_ready());
+  return _num_committed++;
+}
@@ -0,0 +1,68 @@
+#ifndef RAXML_BOOTSTRAP_BOOTSTRAPSCHEDULER_HPP_
+#define RAXML_BOOTSTRAP_BOOTSTRAPSCHEDULER_HPP_
+
+#include "../common.h"
+
+/* Dynamic assignment of bootstrap replicates to independent workers (MPI farm mode).
+ * Replicates are handed out on request and committed strictly in replicate order, such that
+ * the output does not depend on the number of workers. Replicates which run much longer than
+ * an average one (stragglers) are speculatively re-assigned to idle workers, the first result
+ * for a replicate wins. */
+class BootstrapScheduler
+{
+public:
+  static const size_t NONE = (size_t) -1;
+
+  BootstrapScheduler(size_t num_replicates, size_t num_workers, double straggler_factor = 2.);
+
+  /* next replicate for an idle worker, NONE if there is nothing to do at the moment */
+  size_t assign(size_t worker, double now);
+
+  /* earliest time at which a running replicate becomes a straggler (i.e. assign() can hand
+   * it out again), negative if no replicate can become one before the next complete() */
+  double straggler_time() const;
+
+  /* worker has finished a replicate: returns false if it was already completed before */
+  bool complete(size_t worker, size_t replicate, double now);
+
+  /* next replicate in order has been completed and can be committed */
+  bool commit_ready() const;
+  size_t commit();
+
+  /* no more assignments, e.g. after bootstopping test has converged */
+  void stop() { _stopped = true; }
+
+  /* idle workers can be released: all replicates completed or scheduler stopped */
+  bool exhausted() const { return _stopped || _num_completed == num_replicates(); }
+
+  size_t num_replicates() const { return _state.size(); }
+  size_t num_workers() const { return _worker_replicate.size(); }
+  size_t num_completed() const { return _num_completed; }
+  size_t num_committed() const { return _num_committed; }
+  size_t num_reassigned() const { return _num_reassigned; }
+
+private:
+  enum class ReplicateState
+  {
+    pending,
+    running,
+    completed
+  };
+
+  std::vector<ReplicateState> _state;
+  /* time of the first assignment, and number of workers currently running a replicate */
+  doubleVector _start_time;
+  uintVector _num_copies;
+  /* replicate each worker is currently running (NONE = idle) */
+  std::vector<size_t> _worker_replicate;
+
+  size_t _next_pending;
+  size_t _num_completed;
+  size_t _num_committed;
+  size_t _num_reassigned;
+  double _total_runtime;
+  double _straggler_factor;
+  bool _stopped;
+};
+
+#endif /* RAXML_BOOTSTRAP_BOOTSTRAPSCHEDULER_HPP_ */
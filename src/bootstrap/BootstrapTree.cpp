@@ -25,6 +25,9 @@ char * support_fmt_prop(double support)
 
 BootstrapTree::BootstrapTree (const Tree& tree) : Tree(tree), _num_bs_trees(0)
 {
+  /* support values will be stored as (libpll-allocated) node labels */
+  unpack_nodes();
+
   _pll_splits_hash = nullptr;
   _node_split_map.resize(num_splits());
 
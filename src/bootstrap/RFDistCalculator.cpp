@@ -0,0 +1,356 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+#include "RFDistCalculator.hpp"
+#include "../ParallelContext.hpp"
+
+using namespace std;
+
+/* trees (rows) per output stripe, and columns per work unit within a stripe: a tile of
+ * STRIPE_SIZE x TILE_SIZE trees is small enough to stay in cache */
+static const size_t STRIPE_SIZE = 128;
+static const size_t TILE_SIZE = 64;
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define RAXML_POPCNT_DISPATCH
+#endif
+
+/* XOR + popcount for RF, plus a walk over all set bits for WRF: branch lengths are stored
+ * in split id order, so the length index of a split is its rank within the tree */
+template<bool weighted>
+static inline __attribute__((always_inline))
+void bitv_distance(const uint64_t * a, const uint64_t * b, size_t len,
+                   const unsigned int * rank_a, const unsigned int * rank_b,
+                   const double * lengths_a, const double * lengths_b,
+                   unsigned int& rf, double& wrf)
+{
+  unsigned int diff = 0;
+  double wdiff = 0.;
+
+  for (size_t w = 0; w < len; ++w)
+  {
+    const uint64_t x = a[w];
+    const uint64_t y = b[w];
+
+    diff += __builtin_popcountll(x ^ y);
+
+    if (!weighted)
+      continue;
+
+    /* NB: lengths arrays are padded, so reading one element past the last split is safe */
+    const double * la = lengths_a + rank_a[w];
+    const double * lb = lengths_b + rank_b[w];
+    for (uint64_t u = x | y; u; u &= u - 1)
+    {
+      const uint64_t bit = u & (~u + 1);
+      const bool in_a = x & bit;
+      const bool in_b = y & bit;
+      wdiff += fabs((in_a ? *la : 0.) - (in_b ? *lb : 0.));
+      la += in_a;
+      lb += in_b;
+    }
+  }
+
+  rf = diff;
+  wrf += wdiff;
+}
+
+RFDistCalculator::RFDistCalculator() : _num_trees(0), _num_tips(0), _num_splits(0),
+    _weighted(false), _pll_splits_hash(nullptr), _bitv_len(0)
+{
+}
+
+RFDistCalculator::~RFDistCalculator()
+{
+  if (_pll_splits_hash)
+    pllmod_utree_split_hashtable_destroy(_pll_splits_hash);
+}
+
+size_t RFDistCalculator::num_unique_splits() const
+{
+  return _pll_splits_hash ? _pll_splits_hash->entry_count : 0;
+}
+
+void RFDistCalculator::add_tree(const Tree& tree)
+{
+  if (!_num_trees)
+  {
+    _num_tips = tree.num_tips();
+    _num_splits = tree.num_splits();
+    _pll_splits_hash = pllmod_utree_split_hashtable_create(_num_tips, 0);
+
+    if (!_pll_splits_hash)
+    {
+      assert(pll_errno);
+      libpll_check_error("Cannot create split hashtable");
+    }
+  }
+  else if (tree.num_tips() != _num_tips)
+  {
+    throw runtime_error("RFDistCalculator::add_tree: Wrong number of tips: " +
+                        to_string(tree.num_tips()) + ", expected: " + to_string(_num_tips));
+  }
+
+  assert(tree.binary());
+
+  /* packed representation is rebuilt on the next all_pairs() call */
+  _bitv_len = 0;
+  _bitv.clear();
+  _bitv_rank.clear();
+
+  PllNodeVector split_nodes(_num_splits);
+  pll_split_t * splits = pllmod_utree_split_create(&tree.pll_utree_root(), _num_tips,
+                                                   split_nodes.data());
+
+  if (!splits)
+    libpll_check_error("Cannot create splits");
+
+  vector<pair<unsigned int, double>> tree_splits;
+  tree_splits.reserve(_num_splits);
+  for (size_t i = 0; i < _num_splits; ++i)
+  {
+    bitv_hash_entry_t * e = pllmod_utree_split_hashtable_insert_single(_pll_splits_hash,
+                                                                       splits[i],
+                                                                       1.0);
+    if (!e)
+      libpll_check_error("Cannot add a split into hashtable: ");
+
+    tree_splits.emplace_back(e->bip_number, split_nodes[i]->length);
+    _weighted |= split_nodes[i]->length != 0.;
+  }
+
+  pllmod_utree_split_destroy(splits);
+
+  sort(tree_splits.begin(), tree_splits.end());
+
+  /* keep one padding element at the end, see bitv_distance() */
+  if (!_split_lengths.empty())
+    _split_lengths.pop_back();
+  for (const auto& s: tree_splits)
+  {
+    _split_ids.push_back(s.first);
+    _split_lengths.push_back(s.second);
+  }
+  _split_lengths.push_back(0.);
+
+  _tip_lengths.resize(_tip_lengths.size() + _num_tips, 0.);
+  double * tip_lengths = _tip_lengths.data() + _num_trees * _num_tips;
+  const auto& pll_utree = tree.pll_utree();
+  for (size_t i = 0; i < pll_utree.tip_count + pll_utree.inner_count; ++i)
+  {
+    const auto node = pll_utree.nodes[i];
+    if (!node->next)
+    {
+      assert(node->clv_index < _num_tips);
+      tip_lengths[node->clv_index] = node->length;
+      _weighted |= node->length != 0.;
+    }
+  }
+
+  _num_trees++;
+}
+
+void RFDistCalculator::build_bitvectors()
+{
+  const size_t word_bits = sizeof(BitvWord) * 8;
+  const size_t bitv_len = (num_unique_splits() + word_bits - 1) / word_bits;
+
+  /* XOR + popcount over the whole bit vector only pays off if it is not much longer
+   * than the sorted split id list */
+  if (!bitv_len || bitv_len > 2 * _num_splits || _bitv_len == bitv_len)
+    return;
+
+  _bitv_len = bitv_len;
+  _bitv.assign(_num_trees * _bitv_len, 0);
+  _bitv_rank.assign(_num_trees * _bitv_len, 0);
+
+  for (size_t t = 0; t < _num_trees; ++t)
+  {
+    BitvWord * bitv = _bitv.data() + t * _bitv_len;
+    const unsigned int * ids = _split_ids.data() + t * _num_splits;
+    for (size_t i = 0; i < _num_splits; ++i)
+      bitv[ids[i] / word_bits] |= BitvWord(1) << (ids[i] % word_bits);
+
+    unsigned int * rank = _bitv_rank.data() + t * _bitv_len;
+    unsigned int count = 0;
+    for (size_t w = 0; w < _bitv_len; ++w)
+    {
+      rank[w] = count;
+      count += __builtin_popcountll(bitv[w]);
+    }
+    assert(count == _num_splits);
+  }
+}
+
+double RFDistCalculator::tip_wrf(size_t i, size_t j) const
+{
+  const double * a = _tip_lengths.data() + i * _num_tips;
+  const double * b = _tip_lengths.data() + j * _num_tips;
+
+  double wrf = 0.;
+  for (size_t k = 0; k < _num_tips; ++k)
+    wrf += fabs(a[k] - b[k]);
+
+  return wrf;
+}
+
+void RFDistCalculator::distance_sorted(size_t i, size_t j, unsigned int& rf, double& wrf) const
+{
+  const unsigned int * a = _split_ids.data() + i * _num_splits;
+  const unsigned int * b = _split_ids.data() + j * _num_splits;
+  const double * la = _split_lengths.data() + i * _num_splits;
+  const double * lb = _split_lengths.data() + j * _num_splits;
+
+  size_t p = 0, q = 0, common = 0;
+  double wdiff = 0.;
+  while (p < _num_splits && q < _num_splits)
+  {
+    if (a[p] == b[q])
+    {
+      wdiff += fabs(la[p++] - lb[q++]);
+      common++;
+    }
+    else if (a[p] < b[q])
+      wdiff += la[p++];
+    else
+      wdiff += lb[q++];
+  }
+  while (p < _num_splits)
+    wdiff += la[p++];
+  while (q < _num_splits)
+    wdiff += lb[q++];
+
+  rf = 2 * (_num_splits - common);
+  if (_weighted)
+    wrf += wdiff;
+}
+
+#define BITV_DISTANCE(weighted) \
+  bitv_distance<weighted>(_bitv.data() + i * _bitv_len, _bitv.data() + j * _bitv_len, _bitv_len, \
+                          _bitv_rank.data() + i * _bitv_len, _bitv_rank.data() + j * _bitv_len, \
+                          _split_lengths.data() + i * _num_splits, \
+                          _split_lengths.data() + j * _num_splits, rf, wrf)
+
+void RFDistCalculator::distance_bitv(size_t i, size_t j, unsigned int& rf, double& wrf) const
+{
+  if (_weighted)
+    BITV_DISTANCE(true);
+  else
+    BITV_DISTANCE(false);
+}
+
+#ifdef RAXML_POPCNT_DISPATCH
+/* same kernel compiled with hardware popcount instruction */
+__attribute__((target("popcnt")))
+void RFDistCalculator::distance_bitv_popcnt(size_t i, size_t j, unsigned int& rf,
+                                            double& wrf) const
+{
+  if (_weighted)
+    BITV_DISTANCE(true);
+  else
+    BITV_DISTANCE(false);
+}
+#else
+void RFDistCalculator::distance_bitv_popcnt(size_t i, size_t j, unsigned int& rf,
+                                            double& wrf) const
+{
+  distance_bitv(i, j, rf, wrf);
+}
+#endif
+
+void RFDistCalculator::distance(size_t i, size_t j, unsigned int& rf, double& wrf) const
+{
+#ifdef RAXML_POPCNT_DISPATCH
+  static const bool have_popcnt = __builtin_cpu_supports("popcnt");
+#else
+  static const bool have_popcnt = false;
+#endif
+
+  wrf = _weighted ? tip_wrf(i, j) : 0.;
+
+  if (!_bitv_len)
+    distance_sorted(i, j, rf, wrf);
+  else if (have_popcnt)
+    distance_bitv_popcnt(i, j, rf, wrf);
+  else
+    distance_bitv(i, j, rf, wrf);
+}
+
+unsigned int RFDistCalculator::rf(size_t i, size_t j) const
+{
+  unsigned int rf;
+  double wrf;
+  distance(i, j, rf, wrf);
+  return rf;
+}
+
+double RFDistCalculator::wrf(size_t i, size_t j) const
+{
+  unsigned int rf;
+  double wrf;
+  distance(i, j, rf, wrf);
+  return wrf;
+}
+
+void RFDistCalculator::all_pairs(size_t num_threads, const PairCallback& cb)
+{
+  build_bitvectors();
+
+  const size_t n = _num_trees;
+  uintVector stripe_rf;
+  doubleVector stripe_wrf;
+
+  /* rows are processed in stripes to keep output in row-major order with bounded memory;
+   * within a stripe, threads grab column tiles */
+  for (size_t row_begin = 0; row_begin + 1 < n; row_begin += STRIPE_SIZE)
+  {
+    const size_t row_end = std::min(n - 1, row_begin + STRIPE_SIZE);
+    const size_t col_begin = row_begin + 1;
+    const size_t num_tiles = (n - col_begin + TILE_SIZE - 1) / TILE_SIZE;
+
+    stripe_rf.resize((row_end - row_begin) * n);
+    stripe_wrf.resize((row_end - row_begin) * n);
+
+    atomic<size_t> next_tile(0);
+    auto worker = [&]()
+        {
+          for (size_t t = next_tile++; t < num_tiles; t = next_tile++)
+          {
+            const size_t tile_begin = col_begin + t * TILE_SIZE;
+            const size_t tile_end = std::min(n, tile_begin + TILE_SIZE);
+            for (size_t i = row_begin; i < row_end && i + 1 < tile_end; ++i)
+            {
+              const size_t offset = (i - row_begin) * n;
+              for (size_t j = std::max(tile_begin, i + 1); j < tile_end; ++j)
+                distance(i, j, stripe_rf[offset + j], stripe_wrf[offset + j]);
+            }
+          }
+        };
+
+#ifdef _RAXML_PTHREADS
+    const size_t num_workers = std::min(num_threads, num_tiles);
+    if (num_workers > 1)
+    {
+      vector<ThreadType> workers;
+      for (size_t w = 1; w < num_workers; ++w)
+        workers.emplace_back(worker);
+      worker();
+      for (auto& w: workers)
+        w.join();
+    }
+    else
+      worker();
+#else
+    RAXML_UNUSED(num_threads);
+    worker();
+#endif
+
+    for (size_t i = row_begin; i < row_end; ++i)
+    {
+      const size_t offset = (i - row_begin) * n;
+      for (size_t j = i + 1; j < n; ++j)
+        cb(i, j, stripe_rf[offset + j], stripe_wrf[offset + j]);
+    }
+  }
+}
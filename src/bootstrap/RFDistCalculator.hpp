@@ -0,0 +1,70 @@
+#ifndef RAXML_BOOTSTRAP_RFDISTCALCULATOR_HPP_
+#define RAXML_BOOTSTRAP_RFDISTCALCULATOR_HPP_
+
+#include <cstdint>
+#include <functional>
+
+#include "../Tree.hpp"
+
+/* All-pairs Robinson-Foulds (RF) and weighted RF (WRF, sum of branch length differences)
+ * distances. Splits of all trees are collected in a single split hashtable, so that every
+ * tree is represented by a sorted list of global split ids. If the number of distinct splits
+ * is small enough, trees are additionally packed into bit vectors over all distinct splits,
+ * and RF distance reduces to XOR + popcount. */
+class RFDistCalculator
+{
+public:
+  /* called in the calling thread for every pair of trees i < j, in row-major order */
+  typedef std::function<void(size_t, size_t, unsigned int, double)> PairCallback;
+
+  RFDistCalculator();
+  ~RFDistCalculator();
+
+  /* all trees must be binary and have consistent tip ids (cf. Tree::reset_tip_ids()) */
+  void add_tree(const Tree& tree);
+
+  size_t num_trees() const { return _num_trees; }
+  size_t num_tips() const { return _num_tips; }
+  size_t num_unique_splits() const;
+  /* maximum possible RF distance between two trees, used for normalization */
+  size_t max_rf() const { return 2 * _num_splits; }
+  bool dense() const { return _bitv_len > 0; }
+  /* WRF is only computed if trees have branch lengths (otherwise it is always 0) */
+  bool weighted() const { return _weighted; }
+
+  unsigned int rf(size_t i, size_t j) const;
+  double wrf(size_t i, size_t j) const;
+
+  void all_pairs(size_t num_threads, const PairCallback& cb);
+
+private:
+  typedef uint64_t BitvWord;
+
+  size_t _num_trees;
+  size_t _num_tips;
+  size_t _num_splits;
+  bool _weighted;
+  bitv_hashtable_t * _pll_splits_hash;
+
+  /* per-tree split ids (sorted) and corresponding branch lengths, _num_splits per tree */
+  uintVector _split_ids;
+  doubleVector _split_lengths;
+  /* terminal branch lengths, indexed by tip id */
+  doubleVector _tip_lengths;
+
+  /* packed representation: per-tree bit vector over all distinct splits, and number of
+   * tree splits in all preceding words (= index of the first split of a word in _split_ids) */
+  size_t _bitv_len;
+  std::vector<BitvWord> _bitv;
+  uintVector _bitv_rank;
+
+  void build_bitvectors();
+
+  void distance(size_t i, size_t j, unsigned int& rf, double& wrf) const;
+  void distance_sorted(size_t i, size_t j, unsigned int& rf, double& wrf) const;
+  void distance_bitv(size_t i, size_t j, unsigned int& rf, double& wrf) const;
+  void distance_bitv_popcnt(size_t i, size_t j, unsigned int& rf, double& wrf) const;
+  double tip_wrf(size_t i, size_t j) const;
+};
+
+#endif /* RAXML_BOOTSTRAP_RFDISTCALCULATOR_HPP_ */
@@ -0,0 +1,251 @@
+#include <algorithm>
+
+#include "SplitSet.hpp"
+
+using namespace std;
+
+SplitSet::SplitSet(const TreeTopology& topol, const TreeLayout& layout) :
+    _num_tips(0), _split_len(0)
+{
+  extract(topol, layout);
+}
+
+SplitSet::SplitSet(const pll_utree_t& tree) : _num_tips(0), _split_len(0)
+{
+  extract(tree);
+}
+
+void SplitSet::extract(const TreeTopology& topol, const TreeLayout& layout)
+{
+  const unsigned int NONE = TreeLayout::NONE;
+  const size_t num_subnodes = layout.num_subnodes();
+
+  if (topol.edges.size() * 2 != num_subnodes)
+    throw runtime_error("Incompatible topology!");
+
+  _num_tips = layout.num_tips;
+  _split_len = split_len(_num_tips);
+  _bits.clear();
+  _edge_ids.clear();
+
+  _back.assign(num_subnodes, NONE);
+  _branch.resize(num_subnodes);
+  for (size_t i = 0; i < topol.edges.size(); ++i)
+  {
+    const auto& branch = topol.edges[i];
+    _back.at(branch.left_node_id) = branch.right_node_id;
+    _back.at(branch.right_node_id) = branch.left_node_id;
+    _branch[branch.left_node_id] = _branch[branch.right_node_id] = i;
+  }
+
+  auto inner = [&layout, NONE](unsigned int node) -> bool { return layout.next[node] != NONE; };
+
+  auto root = layout.vroot;
+  if (!inner(root))
+    root = _back[root];
+
+  /* pre-order over inner nodes, each one represented by the subnode pointing to its parent */
+  _order.clear();
+  {
+    auto c = root;
+    do
+    {
+      if (inner(_back[c]))
+        _order.push_back(_back[c]);
+      c = layout.next[c];
+    }
+    while (c != root);
+
+    for (size_t i = 0; i < _order.size(); ++i)
+    {
+      const auto up = _order[i];
+      for (auto c = layout.next[up]; c != up; c = layout.next[c])
+      {
+        if (inner(_back[c]))
+          _order.push_back(_back[c]);
+      }
+    }
+  }
+
+  /* post-order: split of the branch above each inner node = union of its subtrees */
+  _row.assign(num_subnodes, -1);
+  _bits.assign(_order.size() * _split_len, 0);
+  _edge_ids.resize(_order.size());
+  for (size_t i = 0; i < _order.size(); ++i)
+    _row[_order[i]] = i;
+
+  for (size_t i = _order.size(); i-- > 0; )
+  {
+    const auto up = _order[i];
+    SplitWord * split = _bits.data() + i * _split_len;
+    for (auto c = layout.next[up]; c != up; c = layout.next[c])
+    {
+      const auto child = _back[c];
+      if (inner(child))
+      {
+        const SplitWord * child_split = _bits.data() + _row[child] * _split_len;
+        for (size_t w = 0; w < _split_len; ++w)
+          split[w] |= child_split[w];
+      }
+      else
+      {
+        if (child >= _num_tips)
+          throw runtime_error("Invalid tip index in tree layout: " + to_string(child));
+        split[child / WORD_BITS] |= SplitWord(1) << (child % WORD_BITS);
+      }
+    }
+    _edge_ids[i] = _branch[up];
+  }
+
+  normalize();
+}
+
+void SplitSet::extract(const pll_utree_t& tree)
+{
+  _num_tips = tree.tip_count;
+  _split_len = split_len(_num_tips);
+
+  auto root = tree.vroot;
+  if (!root->next)
+    root = root->back;
+
+  /* same as above, but working on the node graph: inner nodes are represented by the subnode
+   * pointing to the parent, _row holds the position of the parent in the pre-order */
+  _nodes.clear();
+  _row.clear();
+  {
+    auto c = root;
+    do
+    {
+      if (c->back->next)
+      {
+        _nodes.push_back(c->back);
+        _row.push_back(-1);
+      }
+      c = c->next;
+    }
+    while (c != root);
+
+    for (size_t i = 0; i < _nodes.size(); ++i)
+    {
+      const auto up = _nodes[i];
+      for (auto c = up->next; c != up; c = c->next)
+      {
+        if (c->back->next)
+        {
+          _nodes.push_back(c->back);
+          _row.push_back(i);
+        }
+      }
+    }
+  }
+
+  _bits.assign(_nodes.size() * _split_len, 0);
+  _edge_ids.resize(_nodes.size());
+
+  for (size_t i = _nodes.size(); i-- > 0; )
+  {
+    const auto up = _nodes[i];
+    SplitWord * split = _bits.data() + i * _split_len;
+    for (auto c = up->next; c != up; c = c->next)
+    {
+      if (!c->back->next)
+      {
+        const auto tip = c->back->node_index;
+        if (tip >= _num_tips)
+          throw runtime_error("Invalid tip index in tree: " + to_string(tip));
+        split[tip / WORD_BITS] |= SplitWord(1) << (tip % WORD_BITS);
+      }
+    }
+
+    /* subtree is complete -> propagate to the parent */
+    if (_row[i] >= 0)
+    {
+      SplitWord * parent_split = _bits.data() + _row[i] * _split_len;
+      for (size_t w = 0; w < _split_len; ++w)
+        parent_split[w] |= split[w];
+    }
+    _edge_ids[i] = up->pmatrix_index;
+  }
+
+  normalize();
+}
+
+void SplitSet::normalize()
+{
+  /* tip 0 is always on the "0" side */
+  const size_t tail_bits = _num_tips % WORD_BITS;
+  const SplitWord tail_mask = tail_bits ? (SplitWord(1) << tail_bits) - 1 : ~SplitWord(0);
+  for (size_t i = 0; i < size(); ++i)
+  {
+    SplitWord * split = _bits.data() + i * _split_len;
+    if (split[0] & 1)
+    {
+      for (size_t w = 0; w < _split_len; ++w)
+        split[w] = ~split[w];
+      split[_split_len - 1] &= tail_mask;
+    }
+  }
+}
+
+static inline uint64_t mix64(uint64_t x)
+{
+  /* splitmix64 finalizer */
+  x ^= x >> 30;
+  x *= 0xbf58476d1ce4e5b9ULL;
+  x ^= x >> 27;
+  x *= 0x94d049bb133111ebULL;
+  x ^= x >> 31;
+  return x;
+}
+
+uint64_t SplitSet::split_hash(const SplitWord * split, size_t len)
+{
+  uint64_t h = 0x9e3779b97f4a7c15ULL;
+  for (size_t w = 0; w < len; ++w)
+    h = mix64(h ^ split[w]) + w;
+  return mix64(h);
+}
+
+uint64_t SplitSet::hash() const
+{
+  /* splits are unique within a tree -> sum of per-split hashes is a set hash */
+  uint64_t result = mix64(_num_tips);
+  for (size_t i = 0; i < size(); ++i)
+    result += split_hash(split(i), _split_len);
+
+  return result;
+}
+
+vector<size_t> SplitSet::sorted_order() const
+{
+  vector<size_t> order(size());
+  for (size_t i = 0; i < order.size(); ++i)
+    order[i] = i;
+
+  std::sort(order.begin(), order.end(),
+            [this](size_t a, size_t b) -> bool
+            {
+              return std::lexicographical_compare(split(a), split(a) + _split_len,
+                                                  split(b), split(b) + _split_len);
+            });
+
+  return order;
+}
+
+bool SplitSet::operator==(const SplitSet& other) const
+{
+  if (_num_tips != other._num_tips || size() != other.size())
+    return false;
+
+  const auto order = sorted_order();
+  const auto other_order = other.sorted_order();
+  for (size_t i = 0; i < order.size(); ++i)
+  {
+    const SplitWord * s = split(order[i]);
+    if (!std::equal(s, s + _split_len, other.split(other_order[i])))
+      return false;
+  }
+
+  return true;
+}
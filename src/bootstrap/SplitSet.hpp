@@ -0,0 +1,66 @@
+#ifndef RAXML_BOOTSTRAP_SPLITSET_HPP_
+#define RAXML_BOOTSTRAP_SPLITSET_HPP_
+
+#include <cstdint>
+
+#include "../Tree.hpp"
+
+typedef uint64_t SplitWord;
+
+/* Non-trivial splits (bipartitions) of a tree as packed bit vectors, extracted directly
+ * from the TreeTopology edge list or from the libpll node graph.
+ * Splits are normalized such that tip 0 is never set. */
+class SplitSet
+{
+public:
+  static const size_t WORD_BITS = 64;
+
+  SplitSet() : _num_tips(0), _split_len(0) {}
+  SplitSet(const TreeTopology& topol, const TreeLayout& layout);
+  SplitSet(const pll_utree_t& tree);
+
+  void extract(const TreeTopology& topol, const TreeLayout& layout);
+  void extract(const pll_utree_t& tree);
+
+  size_t num_tips() const { return _num_tips; }
+  size_t size() const { return _edge_ids.size(); }
+  bool empty() const { return _edge_ids.empty(); }
+
+  /* split length in words */
+  size_t split_len() const { return _split_len; }
+  const SplitWord * split(size_t index) const { return _bits.data() + index * _split_len; }
+
+  /* index of the corresponding branch in TreeTopology::edges */
+  size_t edge_index(size_t index) const { return _edge_ids[index]; }
+
+  /* canonical 64-bit hash of the split set: independent of split order and node layout,
+   * equal for identical topologies (provided tip ids are consistent) */
+  uint64_t hash() const;
+
+  /* exact comparison (independent of split order), e.g. to resolve hash collisions */
+  bool operator==(const SplitSet& other) const;
+  bool operator!=(const SplitSet& other) const { return !(*this == other); }
+
+  /* 64-bit hash of a single split (or any bit vector of len words) */
+  static uint64_t split_hash(const SplitWord * split, size_t len);
+
+  static size_t split_len(size_t num_tips) { return (num_tips + WORD_BITS - 1) / WORD_BITS; }
+
+private:
+  size_t _num_tips;
+  size_t _split_len;
+  std::vector<SplitWord> _bits;
+  IDVector _edge_ids;
+
+  /* working buffers */
+  uintVector _back;
+  uintVector _branch;
+  std::vector<long> _row;
+  uintVector _order;
+  std::vector<const pll_unode_t*> _nodes;
+
+  void normalize();
+  std::vector<size_t> sorted_order() const;
+};
+
+#endif /* RAXML_BOOTSTRAP_SPLITSET_HPP_ */
@@ -45,5 +45,7 @@ const SystemTimer& global_timer();
 
 std::string sysutil_realpath(const std::string& path);
 bool sysutil_file_exists(const std::string& fname, int access_mode = F_OK);
+size_t sysutil_file_size(const std::string& fname);
+void sysutil_truncate_file(const std::string& fname, size_t size);
 
 #endif /* RAXML_COMMON_H_ */
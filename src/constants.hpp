@@ -32,6 +32,23 @@
 #define RAXML_BOOTSTOP_INTERVAL   50
 #define RAXML_BOOTSTOP_PERMUTES   1000
 
+// min. interval between intermediate checkpoints in multi-rank runs (seconds)
+#define RAXML_CKP_MPI_INTERVAL    60.
+
+// default synthetic dataset for the likelihood kernel benchmark (--bench)
+#define RAXML_BENCH_TAXA          50
+#define RAXML_BENCH_SITES         10000
+#define RAXML_BENCH_STATES        4
+
+// min. time to run each kernel in the benchmark (seconds)
+#define RAXML_BENCH_MIN_TIME      1.
+
+// capacity of the per-thread event buffer of the execution tracer (older events are overwritten)
+#define RAXML_TRACE_BUFSIZE       (1 << 18)
+
+// structured event log is written out once the buffer exceeds this size (in bytes)
+#define RAXML_EVENTLOG_BUFSIZE    (1 << 16)
+
 // cpu features
 #define RAXML_CPU_SSE3  (1<<0)
 #define RAXML_CPU_AVX   (1<<1)
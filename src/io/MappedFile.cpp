@@ -0,0 +1,49 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <stdexcept>
+
+#include "MappedFile.hpp"
+
+using namespace std;
+
+MappedFile::MappedFile(const string& fname) : _data(nullptr), _size(0)
+{
+  int fd = open(fname.c_str(), O_RDONLY);
+  if (fd < 0)
+    throw runtime_error("Cannot open file: " + fname);
+
+  struct stat st;
+  if (fstat(fd, &st) != 0)
+  {
+    close(fd);
+    throw runtime_error("Cannot determine size of file: " + fname);
+  }
+
+  _size = (size_t) st.st_size;
+
+  /* mmap() fails for zero-length mappings */
+  if (_size > 0)
+  {
+    void * addr = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (addr == MAP_FAILED)
+    {
+      close(fd);
+      throw runtime_error("Cannot map file into memory: " + fname);
+    }
+
+    madvise(addr, _size, MADV_SEQUENTIAL);
+    _data = (const char *) addr;
+  }
+
+  /* mapping stays valid after the descriptor is closed */
+  close(fd);
+}
+
+MappedFile::~MappedFile()
+{
+  if (_data)
+    munmap((void *) _data, _size);
+}
@@ -0,0 +1,27 @@
+#ifndef RAXML_IO_MAPPEDFILE_HPP_
+#define RAXML_IO_MAPPEDFILE_HPP_
+
+#include <string>
+
+/* Read-only memory mapping of a whole file, e.g. for parsing large text inputs in parallel
+ * without copying them into stream buffers first. NB: data() is NOT null-terminated! */
+class MappedFile
+{
+public:
+  explicit MappedFile(const std::string& fname);
+  ~MappedFile();
+
+  MappedFile(const MappedFile& other) = delete;
+  MappedFile& operator=(const MappedFile& other) = delete;
+
+  const char * data() const { return _data; }
+  const char * end() const { return _data + _size; }
+  size_t size() const { return _size; }
+  bool empty() const { return _size == 0; }
+
+private:
+  const char * _data;
+  size_t _size;
+};
+
+#endif /* RAXML_IO_MAPPEDFILE_HPP_ */
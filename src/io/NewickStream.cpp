@@ -1,23 +1,596 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
 #include "file_io.hpp"
 
 using namespace std;
 
-char * newick_name_cb(const pll_unode_t * node)
+/* powers of 10 which are exactly representable as double */
+static const double pow10_table[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+                                      1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19,
+                                      1e20, 1e21, 1e22 };
+
+/* appends value formatted exactly as printf("%.*lf", precision, value) would do */
+static void append_fixed(std::string& buf, double value, unsigned int precision)
 {
-  return node->label ? strdup(node->label) : strdup("");
+  const double scaled = fabs(value) * pow10_table[std::min(precision, 17u)];
+  const double ival = floor(scaled);
+  const double frac = scaled - ival;
+
+  /* fast path: as long as the scaled value fits into 32 bits, the rounding error of the
+   * multiplication is < 1e-6, so we only fall back to printf when close to a tie */
+  if (precision <= 17 && scaled < 4e9 && fabs(frac - 0.5) > 1e-6)
+  {
+    unsigned long long digits = (unsigned long long) ival + (frac > 0.5 ? 1 : 0);
+
+    char tmp[32];
+    char * end = tmp + sizeof(tmp);
+    char * p = end;
+    for (unsigned int i = 0; i < precision; ++i)
+    {
+      *--p = '0' + (digits % 10);
+      digits /= 10;
+    }
+    if (precision > 0)
+      *--p = '.';
+    do
+    {
+      *--p = '0' + (digits % 10);
+      digits /= 10;
+    }
+    while (digits);
+    if (std::signbit(value))
+      *--p = '-';
+
+    buf.append(p, end - p);
+  }
+  else
+  {
+    int size = snprintf(nullptr, 0, "%.*lf", precision, value);
+    assert(size > 0);
+    auto offset = buf.size();
+    buf.resize(offset + size + 1);
+    snprintf(&buf[offset], size + 1, "%.*lf", precision, value);
+    buf.resize(offset + size);
+  }
 }
 
-char * newick_print_cb(const pll_unode_t * node)
+/* appends a node label, quoting it if it contains Newick control characters or blanks */
+static void append_label(std::string& buf, const char * label)
 {
-  // that's ugly, but cannot find a better solution so far...
-  const unsigned int precision = logger().precision(LogElement::brlen);
+  if (!strpbrk(label, " \t\n\r'():,;[]"))
+  {
+    buf += label;
+    return;
+  }
+
+  /* quoted label: single quotes are doubled */
+  buf += '\'';
+  for (const char * c = label; *c; ++c)
+  {
+    if (*c == '\'')
+      buf += '\'';
+    buf += *c;
+  }
+  buf += '\'';
+}
+
+/* node accessors for write_newick(): libpll tree */
+struct PllNodeView
+{
+  typedef const pll_unode_t * node_type;
+
+  node_type next(node_type node) const { return node->next; }
+  node_type back(node_type node) const { return node->back; }
+  bool inner(node_type node) const { return node->next != nullptr; }
+  const char * label(node_type node) const { return node->label; }
+  double length(node_type node) const { return node->length; }
+};
+
+template <class NodeView>
+static void write_newick(std::string& buf, std::vector<typename NodeView::node_type>& stack,
+                         const NodeView& view, typename NodeView::node_type root,
+                         unsigned int precision)
+{
+  typedef typename NodeView::node_type node_type;
+
+  buf.clear();
+  stack.clear();
+
+  auto append_node_data = [&buf, &view, precision](node_type node)
+      {
+        if (view.label(node))
+          append_label(buf, view.label(node));
+        buf += ':';
+        append_fixed(buf, view.length(node), precision);
+      };
+
+  /* for every inner node on the stack, we keep the subnode to be visited next
+   * (subtrees are printed in the same order as in pll_utree_export_newick) */
+  auto visit = [&buf, &stack, &view, &append_node_data](node_type node)
+      {
+        if (view.inner(node))
+        {
+          buf += '(';
+          stack.push_back(node);
+          stack.push_back(view.next(node));
+        }
+        else
+          append_node_data(node);
+      };
+
+  auto drain = [&buf, &stack, &view, &visit, &append_node_data, root]()
+      {
+        while (!stack.empty())
+        {
+          const node_type cur = stack.back();
+          const node_type node = stack[stack.size() - 2];
+          if (cur == node)
+          {
+            /* all subtrees printed -> close this node (root has no branch length) */
+            stack.resize(stack.size() - 2);
+            buf += ')';
+            if (node != root)
+              append_node_data(node);
+            else if (view.label(node))
+              append_label(buf, view.label(node));
+          }
+          else
+          {
+            if (cur != view.next(node))
+              buf += ',';
+            stack.back() = view.next(cur);
+            visit(view.back(cur));
+          }
+        }
+      };
+
+  buf += '(';
+  visit(view.back(root));
+  drain();
+
+  /* remaining subtrees of the root node, closing bracket is added by drain() */
+  buf += ',';
+  stack.push_back(root);
+  stack.push_back(view.next(root));
+  drain();
+
+  buf += ';';
+}
+
+const std::string& NewickWriter::write(const pll_unode_t& root_node, unsigned int precision)
+{
+  const pll_unode_t * root = root_node.next ? &root_node : root_node.back;
+
+  write_newick(_buf, _stack, PllNodeView(), root, precision);
+
+  return _buf;
+}
+
+void NewickParser::error(const std::string& msg) const
+{
+  throw runtime_error("ERROR reading tree file: " + msg + " (position " + to_string(_pos) + ")");
+}
+
+void NewickParser::skip_whitespace()
+{
+  while (_pos < _len)
+  {
+    const char c = _str[_pos];
+    if (c == ' ' || c == '\t' || c == '\n' || c == '\r')
+      _pos++;
+    else if (c == '[')
+    {
+      /* skip comment */
+      while (_pos < _len && _str[_pos] != ']')
+        _pos++;
+      if (_pos == _len)
+        error("unterminated comment");
+      _pos++;
+    }
+    else
+      break;
+  }
+}
+
+void NewickParser::parse_label(Node& node)
+{
+  skip_whitespace();
+
+  node.label_start = _labels.size();
+  node.label_len = 0;
+
+  if (_pos < _len && _str[_pos] == '\'')
+  {
+    /* quoted label, '' denotes a single quote */
+    _pos++;
+    for (;;)
+    {
+      if (_pos == _len)
+        error("unterminated quoted label");
+      if (_str[_pos] == '\'')
+      {
+        if (_pos + 1 < _len && _str[_pos+1] == '\'')
+          _pos++;
+        else
+          break;
+      }
+      _labels += _str[_pos++];
+    }
+    _pos++;
+  }
+  else
+  {
+    const size_t start = _pos;
+    while (_pos < _len)
+    {
+      const char c = _str[_pos];
+      if (c == '(' || c == ')' || c == ',' || c == ':' || c == ';' || c == '[' ||
+          c == ' ' || c == '\t' || c == '\n' || c == '\r')
+        break;
+      _pos++;
+    }
+    _labels.append(_str + start, _pos - start);
+  }
+
+  node.label_len = _labels.size() - node.label_start;
+  if (node.label_len)
+    _labels += '\0';
+}
+
+void NewickParser::parse_length(Node& node)
+{
+  skip_whitespace();
+
+  if (_pos == _len || _str[_pos] != ':')
+    return;
+
+  _pos++;
+  skip_whitespace();
+
+  const size_t start = _pos;
+
+  /* fast path: <= 15 significant digits and small decimal exponent -> the result is
+   * exactly representable as (integer * or / power of 10), and thus correctly rounded */
+  bool neg = false;
+  if (_pos < _len && (_str[_pos] == '-' || _str[_pos] == '+'))
+    neg = _str[_pos++] == '-';
+
+  unsigned long long mantissa = 0;
+  int num_digits = 0;
+  int exponent = 0;
+  bool any_digits = false;
+  while (_pos < _len && isdigit(_str[_pos]))
+  {
+    if (num_digits || _str[_pos] != '0')
+    {
+      if (num_digits < 19)
+        mantissa = mantissa * 10 + (_str[_pos] - '0');
+      else
+        exponent++;
+      num_digits++;
+    }
+    any_digits = true;
+    _pos++;
+  }
+  if (_pos < _len && _str[_pos] == '.')
+  {
+    _pos++;
+    while (_pos < _len && isdigit(_str[_pos]))
+    {
+      if (num_digits || _str[_pos] != '0')
+      {
+        if (num_digits < 19)
+        {
+          mantissa = mantissa * 10 + (_str[_pos] - '0');
+          exponent--;
+        }
+        num_digits++;
+      }
+      else
+        exponent--;
+      any_digits = true;
+      _pos++;
+    }
+  }
+
+  if (!any_digits)
+    error("invalid branch length");
+
+  if (_pos < _len && (_str[_pos] == 'e' || _str[_pos] == 'E'))
+  {
+    _pos++;
+    bool exp_neg = false;
+    if (_pos < _len && (_str[_pos] == '-' || _str[_pos] == '+'))
+      exp_neg = _str[_pos++] == '-';
+    if (_pos == _len || !isdigit(_str[_pos]))
+      error("invalid branch length");
+    int e = 0;
+    while (_pos < _len && isdigit(_str[_pos]))
+    {
+      if (e < 100000)
+        e = e * 10 + (_str[_pos] - '0');
+      _pos++;
+    }
+    exponent += exp_neg ? -e : e;
+  }
+
+  if (num_digits <= 15 && exponent >= -22 && exponent <= 22)
+  {
+    double value = (double) mantissa;
+    if (exponent < 0)
+      value /= pow10_table[-exponent];
+    else
+      value *= pow10_table[exponent];
+    node.length = neg ? -value : value;
+  }
+  else
+  {
+    /* slow path: strtod() stops at the first non-numeric character */
+    node.length = strtod(_str + start, nullptr);
+  }
+}
+
+pll_utree_t * NewickParser::parse(const char * str, size_t len)
+{
+  _str = str;
+  _len = len;
+  _pos = 0;
+  _nodes.clear();
+  _labels.clear();
+
+  long cur = -1;
+
+  skip_whitespace();
+  if (_pos == _len || _str[_pos] != '(')
+    error("tree must start with '('");
+
+  for (;;)
+  {
+    skip_whitespace();
+    if (_pos == _len)
+      error("unexpected end of tree");
+
+    if (_str[_pos] == '(')
+    {
+      /* new inner node */
+      _pos++;
+      _nodes.push_back(Node{cur, 0, 0, 0, 0.});
+      if (cur >= 0)
+        _nodes[cur].num_children++;
+      cur = (long) _nodes.size() - 1;
+      continue;
+    }
+
+    /* tip node */
+    assert(cur >= 0);
+    _nodes.push_back(Node{cur, 0, 0, 0, 0.});
+    _nodes[cur].num_children++;
+    parse_label(_nodes.back());
+    if (!_nodes.back().label_len)
+      error("missing tip label");
+    parse_length(_nodes.back());
+
+    /* close inner nodes */
+    for (;;)
+    {
+      skip_whitespace();
+      if (_pos == _len)
+        error("unexpected end of tree");
+
+      const char c = _str[_pos++];
+      if (c == ',')
+        break;
+      else if (c == ')')
+      {
+        parse_label(_nodes[cur]);
+        parse_length(_nodes[cur]);
+        cur = _nodes[cur].parent;
+        if (cur < 0)
+          break;
+      }
+      else
+        error(string("unexpected character '") + c + "'");
+    }
+
+    if (cur < 0)
+      break;
+  }
+
+  skip_whitespace();
+  if (_pos < _len && _str[_pos] == ';')
+  {
+    _pos++;
+    skip_whitespace();
+  }
+  if (_pos != _len)
+    error("unexpected characters after the end of tree");
+
+  return build_utree();
+}
+
+pll_utree_t * NewickParser::build_utree()
+{
+  const size_t node_count = _nodes.size();
+  const Node& root = _nodes[0];
+
+  unsigned int tip_count = 0;
+  unsigned int inner_count = 0;
+  for (size_t i = 0; i < node_count; ++i)
+  {
+    if (_nodes[i].num_children)
+    {
+      if (i > 0 && _nodes[i].num_children == 1)
+        error("unifurcations are not supported");
+      inner_count++;
+    }
+    else
+      tip_count++;
+  }
+
+  if (tip_count < 3)
+    error("tree must contain at least 3 taxa");
+
+  if (root.num_children < 2)
+    error("unifurcations are not supported");
+
+  /* rooted tree: remove the root node and connect its two children directly */
+  long left = -1, right = -1;
+  if (root.num_children == 2)
+  {
+    for (size_t i = 1; i < node_count && right < 0; ++i)
+    {
+      if (_nodes[i].parent == 0)
+        (left < 0 ? left : right) = i;
+    }
+    /* make sure new virtual root is an inner node */
+    if (!_nodes[left].num_children)
+      std::swap(left, right);
+    inner_count--;
+  }
+  const bool unroot = left >= 0;
+
+  /* all allocations are tracked, so that they can be released if anything goes wrong */
+  _alloc_nodes.clear();
+  _alloc_labels.clear();
+
+  auto new_node = [this]() -> pll_unode_t *
+      {
+        pll_unode_t * node = (pll_unode_t *) calloc(1, sizeof(pll_unode_t));
+        if (!node)
+          throw std::bad_alloc();
+        _alloc_nodes.push_back(node);
+        return node;
+      };
+
+  auto free_nodes = [this]()
+      {
+        for (auto node: _alloc_nodes)
+          free(node);
+        for (auto label: _alloc_labels)
+          free(label);
+        _alloc_nodes.clear();
+        _alloc_labels.clear();
+      };
+
+  _parent_link.assign(node_count, nullptr);
+  _next_child.assign(node_count, nullptr);
+
+  unsigned int tip_index = 0;
+  unsigned int inner_index = 0;
+  unsigned int node_index = tip_count;
+  pll_unode_t * vroot = nullptr;
+
+  /* create nodes in the pre-order, i.e. tips are numbered in the order of appearance */
+  try
+  {
+    for (size_t i = unroot ? 1 : 0; i < node_count; ++i)
+    {
+      const Node& pnode = _nodes[i];
+      char * label = nullptr;
+      if (pnode.label_len)
+      {
+        label = strdup(_labels.c_str() + pnode.label_start);
+        if (!label)
+          throw std::bad_alloc();
+        _alloc_labels.push_back(label);
+      }
+
+      if (!pnode.num_children)
+      {
+        pll_unode_t * node = new_node();
+        node->label = label;
+        node->clv_index = node->node_index = node->pmatrix_index = tip_index++;
+        node->scaler_index = -1;
+        _parent_link[i] = node;
+      }
+      else
+      {
+        /* subnode ring: link to the parent first (if any), then to the children */
+        const bool has_parent = i > 0;
+        const unsigned int ring_size = pnode.num_children + (has_parent ? 1 : 0);
+        pll_unode_t * first = nullptr;
+        pll_unode_t * prev = nullptr;
+        for (unsigned int j = 0; j < ring_size; ++j)
+        {
+          pll_unode_t * node = new_node();
+          node->label = label;
+          node->clv_index = tip_count + inner_index;
+          node->scaler_index = inner_index;
+          node->node_index = node_index++;
+          if (prev)
+            prev->next = node;
+          else
+            first = node;
+          prev = node;
+        }
+        prev->next = first;
+        inner_index++;
 
-  char * newick;
-  if (asprintf(&newick, "%s:%.*lf",
-           node->label ? node->label : "" , precision, node->length) < 0)
-    return NULL;
+        _parent_link[i] = has_parent ? first : nullptr;
+        _next_child[i] = has_parent ? first->next : first;
 
-  return newick;
+        if (!vroot)
+          vroot = first;
+      }
+    }
+  }
+  catch (...)
+  {
+    free_nodes();
+    throw;
+  }
+
+  assert(tip_index == tip_count && inner_index == inner_count);
+
+  /* connect nodes */
+  unsigned int pmatrix_index = tip_count;
+  auto connect = [&pmatrix_index](pll_unode_t * a, pll_unode_t * b, double length)
+      {
+        a->back = b;
+        b->back = a;
+        a->length = b->length = length;
+        if (!a->next)
+          b->pmatrix_index = a->pmatrix_index;
+        else if (!b->next)
+          a->pmatrix_index = b->pmatrix_index;
+        else
+          a->pmatrix_index = b->pmatrix_index = pmatrix_index++;
+      };
+
+  for (size_t i = 1; i < node_count; ++i)
+  {
+    if ((long) i == left || (long) i == right)
+      continue;
+
+    const auto parent = _nodes[i].parent;
+    pll_unode_t * child_link = _next_child[parent];
+    _next_child[parent] = child_link->next;
+    connect(_parent_link[i], child_link, _nodes[i].length);
+  }
+
+  if (unroot)
+  {
+    connect(_parent_link[left], _parent_link[right], _nodes[left].length + _nodes[right].length);
+    vroot = _parent_link[left];
+  }
+
+  assert(pmatrix_index == tip_count + inner_count - 1);
+
+  pll_utree_t * utree = pll_utree_wraptree_multi(vroot, tip_count, inner_count);
+  if (!utree)
+  {
+    free_nodes();
+    libpll_check_error("ERROR reading tree file");
+    throw runtime_error("ERROR reading tree file: cannot build tree structure");
+  }
+
+  /* nodes are owned by utree now */
+  _alloc_nodes.clear();
+  _alloc_labels.clear();
+
+  return utree;
 }
 
 std::string to_newick_string_rooted(const Tree& tree, double root_brlen)
@@ -31,17 +604,10 @@ std::string to_newick_string_rooted(const Tree& tree, double root_brlen)
 
 NewickStream& operator<<(NewickStream& stream, const pll_unode_t& root)
 {
-  char * newick_str = pll_utree_export_newick(&root, newick_print_cb);
-  if (newick_str)
-  {
-    stream << newick_str << std::endl;
-    free(newick_str);
-  }
-  else
-  {
-    assert(pll_errno);
-    libpll_check_error("Failed to generate Newick");
-  }
+  const unsigned int precision = logger().precision(LogElement::brlen);
+
+  stream << stream.writer().write(root, precision) << std::endl;
+
   return stream;
 }
 
@@ -59,26 +625,28 @@ NewickStream& operator<<(NewickStream& stream, const Tree& tree)
 
 NewickStream& operator>>(NewickStream& stream, Tree& tree)
 {
-  string newick_str;
+  // NB: buffer is re-used across calls to avoid re-allocation
+  auto& newick_str = stream.buffer();
 
   std::getline(stream, newick_str, ';');
 
+  /* ';' inside a quoted label: odd number of quotes so far ('' counts twice) */
+  while (std::count(newick_str.begin(), newick_str.end(), '\'') % 2 && stream.good())
+  {
+    std::string tail;
+    std::getline(stream, tail, ';');
+    newick_str += ';';
+    newick_str += tail;
+  }
+
   // discard any trailing spaces, newlines etc.
   stream >> std::ws;
 
   if (!newick_str.empty())
   {
-    newick_str += ";";
-
-    pll_utree_t * utree = pll_utree_parse_newick_string_unroot(newick_str.c_str());
-
-    libpll_check_error("ERROR reading tree file");
+    PllUTreeUniquePtr utree(stream.parser().parse(newick_str.c_str(), newick_str.size()));
 
-    assert(utree);
-
-    tree = Tree(*utree);
-
-    pll_utree_destroy(utree, nullptr);
+    tree = Tree(std::move(utree));
   }
 
   return stream;
@@ -89,5 +657,3 @@ NewickStream& operator<<(NewickStream& stream, const BootstrapTree& tree)
   stream << tree.pll_utree_root();
   return stream;
 }
-
-
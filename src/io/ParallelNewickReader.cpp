@@ -0,0 +1,265 @@
+#include "ParallelNewickReader.hpp"
+
+using namespace std;
+
+static const size_t READ_CHUNK_SIZE = 1024 * 1024;
+static const size_t RECORDS_PER_WORKER = 4;
+
+ParallelNewickReader::ParallelNewickReader(const std::string& fname, size_t num_workers) :
+    _fname(fname), _num_workers(num_workers), _num_filled(0), _num_parsing(0),
+    _num_consumed(0), _eof(false), _abort(false)
+{
+}
+
+void ParallelNewickReader::split_records(const std::function<std::string*()>& acquire_cb,
+                                         const std::function<void()>& commit_cb)
+{
+  ifstream fs(_fname, std::ios::in | std::ios::binary);
+  if (!fs)
+    throw runtime_error("Cannot open file: " + _fname);
+
+  vector<char> chunk(READ_CHUNK_SIZE);
+  bool in_quotes = false;
+  bool in_comment = false;
+  std::string * text = nullptr;
+
+  while (fs)
+  {
+    fs.read(chunk.data(), chunk.size());
+    const size_t len = fs.gcount();
+    if (!len)
+      break;
+
+    const char * buf = chunk.data();
+    size_t start = 0;
+    for (size_t i = 0; i < len; ++i)
+    {
+      const char c = buf[i];
+      if (in_quotes)
+        in_quotes = (c != '\'');
+      else if (in_comment)
+        in_comment = (c != ']');
+      else if (c == '\'')
+        in_quotes = true;
+      else if (c == '[')
+        in_comment = true;
+      else if (c == ';')
+      {
+        if (!text && !(text = acquire_cb()))
+          return;
+        text->append(buf + start, i + 1 - start);
+        commit_cb();
+        text = nullptr;
+        start = i + 1;
+      }
+    }
+
+    if (start < len)
+    {
+      if (!text && !(text = acquire_cb()))
+        return;
+      text->append(buf + start, len - start);
+    }
+  }
+
+  /* last tree without trailing semicolon */
+  if (text && text->find_first_not_of(" \t\r\n") != std::string::npos)
+    commit_cb();
+}
+
+void ParallelNewickReader::parse_record(NewickParser& parser, size_t index, Record& rec,
+                                        const PrepareCallback& prepare_cb)
+{
+  rec.error = nullptr;
+  try
+  {
+    rec.tree = Tree(PllUTreeUniquePtr(parser.parse(rec.text.c_str(), rec.text.size())));
+
+    if (prepare_cb)
+      prepare_cb(index, rec.tree);
+  }
+  catch (...)
+  {
+    rec.error = current_exception();
+  }
+}
+
+size_t ParallelNewickReader::read(const PrepareCallback& prepare_cb,
+                                  const ConsumeCallback& consume_cb)
+{
+  _num_filled = _num_parsing = _num_consumed = 0;
+  _eof = _abort = false;
+  _read_error = nullptr;
+
+#ifdef _RAXML_PTHREADS
+  if (_num_workers > 1)
+    return read_pipelined(prepare_cb, consume_cb);
+#endif
+
+  return read_sequential(prepare_cb, consume_cb);
+}
+
+size_t ParallelNewickReader::read_sequential(const PrepareCallback& prepare_cb,
+                                             const ConsumeCallback& consume_cb)
+{
+  NewickParser parser;
+  _records.resize(1);
+  Record& rec = _records[0];
+
+  auto acquire_cb = [&rec]() -> std::string *
+      {
+        rec.text.clear();
+        return &rec.text;
+      };
+
+  auto commit_cb = [this, &rec, &parser, &prepare_cb, &consume_cb]()
+      {
+        parse_record(parser, _num_consumed, rec, prepare_cb);
+        if (rec.error)
+          rethrow_exception(rec.error);
+        consume_cb(_num_consumed, rec.tree);
+        _num_consumed++;
+      };
+
+  split_records(acquire_cb, commit_cb);
+
+  return _num_consumed;
+}
+
+#ifdef _RAXML_PTHREADS
+void ParallelNewickReader::split_worker()
+{
+  auto acquire_cb = [this]() -> std::string *
+      {
+        LockType lock(_mutex);
+        _cv_fill.wait(lock, [this]() -> bool
+                      { return _abort || _num_filled - _num_consumed < _records.size(); });
+
+        if (_abort)
+          return nullptr;
+
+        auto& rec = record(_num_filled);
+        rec.text.clear();
+        return &rec.text;
+      };
+
+  auto commit_cb = [this]()
+      {
+        {
+          LockType lock(_mutex);
+          _num_filled++;
+        }
+        _cv_parse.notify_one();
+      };
+
+  try
+  {
+    split_records(acquire_cb, commit_cb);
+  }
+  catch (...)
+  {
+    _read_error = current_exception();
+  }
+
+  {
+    LockType lock(_mutex);
+    _eof = true;
+  }
+  _cv_parse.notify_all();
+  _cv_consume.notify_all();
+}
+
+void ParallelNewickReader::parse_worker(const PrepareCallback& prepare_cb)
+{
+  NewickParser parser;
+
+  for (;;)
+  {
+    LockType lock(_mutex);
+    _cv_parse.wait(lock, [this]() -> bool
+                   { return _abort || _eof || _num_parsing < _num_filled; });
+
+    if (_abort || _num_parsing == _num_filled)
+      return;
+
+    const size_t index = _num_parsing++;
+    auto& rec = record(index);
+    lock.unlock();
+
+    parse_record(parser, index, rec, prepare_cb);
+
+    lock.lock();
+    rec.parsed = true;
+    lock.unlock();
+    _cv_consume.notify_all();
+  }
+}
+
+size_t ParallelNewickReader::read_pipelined(const PrepareCallback& prepare_cb,
+                                            const ConsumeCallback& consume_cb)
+{
+  _records.resize(_num_workers * RECORDS_PER_WORKER);
+  for (auto& rec: _records)
+    rec.parsed = false;
+
+  std::thread splitter(&ParallelNewickReader::split_worker, this);
+  std::vector<std::thread> parsers;
+  for (size_t i = 0; i < _num_workers; ++i)
+    parsers.emplace_back(&ParallelNewickReader::parse_worker, this, std::cref(prepare_cb));
+
+  std::exception_ptr error;
+  try
+  {
+    for (;;)
+    {
+      LockType lock(_mutex);
+      _cv_consume.wait(lock, [this]() -> bool
+                       {
+                         return (_num_consumed < _num_filled && record(_num_consumed).parsed) ||
+                                (_eof && _num_consumed == _num_filled);
+                       });
+
+      if (_num_consumed == _num_filled)
+      {
+        if (_read_error)
+          rethrow_exception(_read_error);
+        break;
+      }
+
+      auto& rec = record(_num_consumed);
+      lock.unlock();
+
+      if (rec.error)
+        rethrow_exception(rec.error);
+
+      consume_cb(_num_consumed, rec.tree);
+
+      lock.lock();
+      rec.parsed = false;
+      _num_consumed++;
+      lock.unlock();
+      _cv_fill.notify_one();
+    }
+  }
+  catch (...)
+  {
+    error = current_exception();
+  }
+
+  {
+    LockType lock(_mutex);
+    _abort = true;
+  }
+  _cv_fill.notify_all();
+  _cv_parse.notify_all();
+
+  splitter.join();
+  for (auto& t: parsers)
+    t.join();
+
+  if (error)
+    rethrow_exception(error);
+
+  return _num_consumed;
+}
+#endif
@@ -0,0 +1,69 @@
+#ifndef RAXML_IO_PARALLELNEWICKREADER_HPP_
+#define RAXML_IO_PARALLELNEWICKREADER_HPP_
+
+#include <condition_variable>
+
+#include "file_io.hpp"
+
+/* Pipelined reader for multi-tree Newick files: one thread splits the file into tree records,
+ * a pool of workers parses them, and parsed trees are handed over to the consumer
+ * (in the calling thread) in the same order as they appear in the file */
+class ParallelNewickReader
+{
+public:
+  /* called in worker threads right after parsing (must be thread-safe) */
+  typedef std::function<void(size_t, Tree&)> PrepareCallback;
+  /* called in the calling thread, in the file order */
+  typedef std::function<void(size_t, const Tree&)> ConsumeCallback;
+
+  ParallelNewickReader(const std::string& fname, size_t num_workers);
+
+  /* returns number of trees read */
+  size_t read(const PrepareCallback& prepare_cb, const ConsumeCallback& consume_cb);
+
+private:
+  struct Record
+  {
+    Record() : parsed(false) {}
+
+    std::string text;
+    Tree tree;
+    std::exception_ptr error;
+    bool parsed;
+  };
+
+  std::string _fname;
+  size_t _num_workers;
+  std::vector<Record> _records;
+
+  /* records are consumed in order: consumed <= parsing <= filled */
+  size_t _num_filled;
+  size_t _num_parsing;
+  size_t _num_consumed;
+  bool _eof;
+  bool _abort;
+  std::exception_ptr _read_error;
+
+#ifdef _RAXML_PTHREADS
+  std::mutex _mutex;
+  std::condition_variable _cv_fill;
+  std::condition_variable _cv_parse;
+  std::condition_variable _cv_consume;
+#endif
+
+  Record& record(size_t index) { return _records[index % _records.size()]; }
+
+  void split_records(const std::function<std::string*()>& acquire_cb,
+                     const std::function<void()>& commit_cb);
+  void parse_record(NewickParser& parser, size_t index, Record& rec,
+                    const PrepareCallback& prepare_cb);
+
+  size_t read_sequential(const PrepareCallback& prepare_cb, const ConsumeCallback& consume_cb);
+#ifdef _RAXML_PTHREADS
+  size_t read_pipelined(const PrepareCallback& prepare_cb, const ConsumeCallback& consume_cb);
+  void split_worker();
+  void parse_worker(const PrepareCallback& prepare_cb);
+#endif
+};
+
+#endif /* RAXML_IO_PARALLELNEWICKREADER_HPP_ */
@@ -239,19 +239,25 @@ BasicBinaryStream& operator>>(BasicBinaryStream& stream, TreeTopology& t)
 
 BasicBinaryStream& operator<<(BasicBinaryStream& stream, const TreeCollection& c)
 {
-  stream << c.size();
-  for (const auto tree: c)
-    stream << tree.first << tree.second;
+  stream << c.num_unique();
+  for (auto it = c.begin(); it != c.end(); ++it)
+  {
+    stream << it->first << c.multiplicity(it) << c.topology_hash(it);
+    stream << it->second;
+  }
   return stream;
 }
 
 BasicBinaryStream& operator>>(BasicBinaryStream& stream, TreeCollection& c)
 {
+  c.clear();
   auto size = stream.get<size_t>();
   for (size_t i = 0; i < size; ++i)
   {
     auto score = stream.get<double>();
-    c.push_back(score, stream.get<TreeTopology>());
+    auto multiplicity = stream.get<size_t>();
+    auto hash = stream.get<uint64_t>();
+    c.push_back(score, stream.get<TreeTopology>(), hash, multiplicity);
   }
   return stream;
 }
@@ -8,12 +8,68 @@
 #include "../bootstrap/BootstrapGenerator.hpp"
 #include "../PartitionedMSAView.hpp"
 
+/* Newick serializer which formats the whole tree into one buffer, re-used across calls */
+class NewickWriter
+{
+public:
+  const std::string& write(const pll_unode_t& root, unsigned int precision);
+
+private:
+  std::string _buf;
+  std::vector<const pll_unode_t*> _stack;
+};
+
+/* Non-recursive Newick parser: all intermediate buffers are re-used across calls,
+ * and memory is only allocated for the resulting pll_utree_t itself */
+class NewickParser
+{
+public:
+  /* parses a single tree from str[0..len) (terminating ';' is optional)
+   * and returns it in the unrooted form */
+  pll_utree_t * parse(const char * str, size_t len);
+
+private:
+  struct Node
+  {
+    long parent;
+    unsigned int num_children;
+    size_t label_start;
+    size_t label_len;
+    double length;
+  };
+
+  const char * _str;
+  size_t _len;
+  size_t _pos;
+  std::vector<Node> _nodes;
+  std::string _labels;
+  std::vector<pll_unode_t *> _parent_link;
+  std::vector<pll_unode_t *> _next_child;
+  std::vector<pll_unode_t *> _alloc_nodes;
+  std::vector<char *> _alloc_labels;
+
+  void skip_whitespace();
+  void parse_label(Node& node);
+  void parse_length(Node& node);
+  pll_utree_t * build_utree();
+  [[noreturn]] void error(const std::string& msg) const;
+};
+
 class NewickStream : public std::fstream
 {
 public:
   NewickStream(std::string fname) : std::fstream(fname, std::ios::out) {};
   NewickStream(std::string fname, std::ios_base::openmode mode) :
     std::fstream(fname, mode) {};
+
+  NewickWriter& writer() { return _writer; }
+  NewickParser& parser() { return _parser; }
+  std::string& buffer() { return _buffer; }
+
+private:
+  NewickWriter _writer;
+  NewickParser _parser;
+  std::string _buffer;
 };
 
 class MSAFileStream
@@ -48,7 +104,21 @@ public:
 class CATGStream : public MSAFileStream
 {
 public:
-  CATGStream(const std::string& fname) : MSAFileStream(fname) {}
+  CATGStream(const std::string& fname, size_t num_threads = 1) :
+    MSAFileStream(fname), _num_threads(num_threads) {}
+
+  /* number of threads for parsing (sites are split into blocks) */
+  size_t num_threads() const { return _num_threads; }
+private:
+  size_t _num_threads;
+};
+
+/* genotypes (GT) of SNP sites are mapped to diploid10 states, invariant and non-SNP
+ * records are skipped, and only distinct site patterns are kept (with weights) */
+class VCFStream : public MSAFileStream
+{
+public:
+  VCFStream(const std::string& fname) : MSAFileStream(fname) {}
 };
 
 class RBAStream : public MSAFileStream
@@ -101,7 +171,9 @@ NewickStream& operator<<(NewickStream& stream, const BootstrapTree& tree);
 PhylipStream& operator>>(PhylipStream& stream, MSA& msa);
 FastaStream& operator>>(FastaStream& stream, MSA& msa);
 CATGStream& operator>>(CATGStream& stream, MSA& msa);
-MSA msa_load_from_file(const std::string &filename, const FileFormat format);
+VCFStream& operator>>(VCFStream& stream, MSA& msa);
+MSA msa_load_from_file(const std::string &filename, const FileFormat format,
+                       size_t num_threads = 1);
 
 PhylipStream& operator<<(PhylipStream& stream, const MSA& msa);
 PhylipStream& operator<<(PhylipStream& stream, const PartitionedMSA& msa);
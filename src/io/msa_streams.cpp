@@ -1,8 +1,17 @@
 #include <stdexcept>
 #include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <functional>
 #include <map>
+#include <unordered_map>
+
+#ifdef _RAXML_PTHREADS
+#include <thread>
+#endif
 
 #include "file_io.hpp"
+#include "MappedFile.hpp"
 
 using namespace std;
 
@@ -158,115 +167,669 @@ PhylipStream& operator<<(PhylipStream& stream, const BootstrapMSA& bs_msa)
   return stream;
 }
 
-CATGStream& operator>>(CATGStream& stream, MSA& msa)
+/* CATG parsing helpers: the whole file is mapped into memory and parsed in-place */
+namespace
 {
-  ifstream fs;
-  fs.open(stream.fname());
 
-  /* read alignment dimensions */
-  size_t taxa_count, site_count;
+const double catg_pow10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+                             1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19,
+                             1e20, 1e21, 1e22};
+
+inline bool catg_space(char c)
+{
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+inline void catg_skip_space(const char *& p, const char * end)
+{
+  while (p < end && catg_space(*p))
+    ++p;
+}
+
+inline const char * catg_token_end(const char * p, const char * end)
+{
+  while (p < end && !catg_space(*p))
+    ++p;
+  return p;
+}
+
+/* locale-independent, allocation-free number parser for [p, end), stops at the first
+ * character that can't be part of a number. Returns false on error. */
+bool catg_parse_double(const char *& p, const char * end, double& value)
+{
+  const char * start = p;
+  bool neg = false;
+  if (p < end && (*p == '-' || *p == '+'))
+    neg = (*p++ == '-');
+
+  unsigned long long mantissa = 0;
+  int num_digits = 0;
+  int exponent = 0;
+  bool any_digits = false;
+
+  for (; p < end && *p >= '0' && *p <= '9'; ++p)
+  {
+    any_digits = true;
+    if (mantissa || *p != '0')
+    {
+      if (num_digits < 19)
+        mantissa = mantissa * 10 + (*p - '0');
+      else
+        exponent++;
+      num_digits++;
+    }
+  }
 
-  try
+  if (p < end && *p == '.')
   {
-    fs >> taxa_count >> site_count;
+    for (++p; p < end && *p >= '0' && *p <= '9'; ++p)
+    {
+      any_digits = true;
+      if (mantissa || *p != '0')
+      {
+        if (num_digits < 19)
+        {
+          mantissa = mantissa * 10 + (*p - '0');
+          exponent--;
+        }
+        num_digits++;
+      }
+      else
+        exponent--;
+    }
+  }
+
+  if (!any_digits)
+    return false;
+
+  if (p < end && (*p == 'e' || *p == 'E'))
+  {
+    ++p;
+    bool exp_neg = false;
+    if (p < end && (*p == '-' || *p == '+'))
+      exp_neg = (*p++ == '-');
+    if (p == end || *p < '0' || *p > '9')
+      return false;
+    int e = 0;
+    for (; p < end && *p >= '0' && *p <= '9'; ++p)
+    {
+      if (e < 100000)
+        e = e * 10 + (*p - '0');
+    }
+    exponent += exp_neg ? -e : e;
+  }
+
+  if (num_digits <= 15 && exponent >= -22 && exponent <= 22)
+  {
+    value = (double) mantissa;
+    if (exponent < 0)
+      value /= catg_pow10[-exponent];
+    else
+      value *= catg_pow10[exponent];
+  }
+  else
+  {
+    /* slow path: strtod() needs a null-terminated string */
+    char buf[64];
+    const size_t len = p - start;
+    if (len >= sizeof(buf))
+      return false;
+    memcpy(buf, start, len);
+    buf[len] = 0;
+    value = strtod(buf, nullptr);
+    return true;
+  }
+
+  if (neg)
+    value = -value;
+
+  return true;
+}
+
+struct CATGMatrix
+{
+  size_t taxa;
+  size_t states;
+  std::vector<char *> seqs;
+  std::vector<double *> probs;
+  std::vector<size_t> state_map;
+};
+
+/* parse sites [first_site, last_site) from [p, end) */
+void catg_parse_sites(const CATGMatrix& m, const char * p, const char * end,
+                      size_t first_site, size_t last_site)
+{
+  for (size_t i = first_site; i < last_site; ++i)
+  {
+    /* consensus sequence */
+    catg_skip_space(p, end);
+    const char * cons_end = catg_token_end(p, end);
+    if ((size_t) (cons_end - p) != m.taxa)
+      throw runtime_error("Wrong length of consensus sequence for site " + to_string(i+1) + "!");
+
+    for (size_t j = 0; j < m.taxa; ++j)
+      m.seqs[j][i] = p[j];
+    p = cons_end;
+
+    /* state probabilities: taxa x "p1,p2,...,pN" */
+    for (size_t j = 0; j < m.taxa; ++j)
+    {
+      catg_skip_space(p, end);
+
+      double * site_probs = m.probs[j] + i * m.states;
+      size_t k = 0;
+      for (;;)
+      {
+        double value;
+        if (!catg_parse_double(p, end, value))
+        {
+          throw runtime_error("Invalid state probability for site " + to_string(i+1) +
+                              ", taxon " + to_string(j+1) + "!");
+        }
+
+        if (k < m.states)
+          site_probs[m.state_map.empty() ? k : m.state_map[k]] = value;
+        ++k;
+
+        if (p < end && *p == ',')
+          ++p;
+        else
+          break;
+      }
+
+      if (k != m.states || (p < end && !catg_space(*p)))
+        throw runtime_error("Wrong number of state probabilities for site " + to_string(i+1) + "!");
+    }
   }
-  catch(exception& e)
+}
+
+/* number of non-empty lines in [p, end) */
+size_t catg_count_lines(const char * p, const char * end)
+{
+  size_t count = 0;
+  bool empty = true;
+  for (; p < end; ++p)
   {
-    LOG_DEBUG << e.what() << endl;
-    taxa_count = site_count = 0;
+    if (*p == '\n')
+    {
+      count += empty ? 0 : 1;
+      empty = true;
+    }
+    else if (!catg_space(*p))
+      empty = false;
   }
+  return count + (empty ? 0 : 1);
+}
+
+}
+
+CATGStream& operator>>(CATGStream& stream, MSA& msa)
+{
+  MappedFile file(stream.fname());
+
+  const char * p = file.data();
+  const char * end = file.end();
+
+  /* read alignment dimensions */
+  auto parse_count = [&p, end]() -> size_t
+      {
+        size_t count = 0;
+        catg_skip_space(p, end);
+        for (; p < end && *p >= '0' && *p <= '9'; ++p)
+          count = count * 10 + (*p - '0');
+        return (p == end || catg_space(*p)) ? count : 0;
+      };
+
+  const size_t taxa_count = parse_count();
+  const size_t site_count = parse_count();
 
   if (!taxa_count || !site_count)
     throw runtime_error("Invalid alignment dimensions!");
 
   LOG_DEBUG << "CATG: taxa: " << taxa_count << ", sites: " << site_count << endl;
 
-  string dummy(site_count, '*');
+  msa = MSA(site_count);
 
   /* read taxa names */
-  try
   {
-    string taxon_name;
+    string dummy(site_count, '*');
     for (size_t i = 0; i < taxa_count; ++i)
     {
-      fs >> taxon_name;
-      msa.append(dummy, taxon_name);
-      LOG_DEBUG << "CATG: taxon " << i << ": " << taxon_name << endl;
+      catg_skip_space(p, end);
+      const char * name_end = catg_token_end(p, end);
+      if (name_end == p)
+        break;
+
+      msa.append(dummy, string(p, name_end));
+      p = name_end;
     }
   }
-  catch (exception& e)
-  {
-    LOG_DEBUG << e.what() << endl;
-  }
 
   if (msa.size() != taxa_count)
     throw runtime_error("Wrong number of taxon labels!");
 
+  /* number of states: count values in the first probability vector (after consensus seq) */
+  {
+    const char * q = p;
+    catg_skip_space(q, end);
+    q = catg_token_end(q, end);
+    catg_skip_space(q, end);
+    const char * q_end = catg_token_end(q, end);
+    if (q == q_end)
+      throw runtime_error("Wrong number of state probabilities for site 1!");
+
+    msa.states(std::count(q, q_end, ',') + 1);
+
+    LOG_DEBUG << "CATG: number of states: " << msa.states() << endl;
+  }
+
+  CATGMatrix m;
+  m.taxa = taxa_count;
+  m.states = msa.states();
+  for (size_t j = 0; j < taxa_count; ++j)
+  {
+    m.seqs.push_back(&msa[j][0]);
+    m.probs.push_back(&(*msa.probs(j, 0)));
+  }
+
   /* this is mapping for DNA: CATG -> ACGT, for other datatypes we assume 1:1 mapping */
-  std::vector<size_t> state_map({1, 0, 3, 2});
+  if (m.states == 4)
+    m.state_map = {1, 0, 3, 2};
+
+  /* Split alignment into blocks of complete lines. If there is exactly one site per line
+   * (which is normally the case), blocks can be parsed independently. */
+  const size_t num_threads = std::max<size_t>(1, stream.num_threads());
+  const size_t min_block_size = 1024 * 1024;
+  const size_t num_blocks = std::min(4 * num_threads,
+                                     std::max<size_t>(1, (end - p) / min_block_size));
+
+  std::vector<const char *> block_start(1, p);
+  for (size_t b = 1; b < num_blocks; ++b)
+  {
+    const char * q = p + (end - p) * b / num_blocks;
+    q = std::max(q, block_start.back());
+    while (q < end && *q != '\n')
+      ++q;
+    block_start.push_back(q);
+  }
+  block_start.push_back(end);
 
-  string cons_str, prob_str;
+  std::vector<size_t> block_sites(num_blocks + 1, 0);
+  std::vector<std::exception_ptr> block_error(num_blocks);
 
-  /* read alignment, remember that the matrix is transposed! */
-  for (size_t i = 0; i < msa.num_sites(); ++i)
+  auto run_blocks = [num_threads, num_blocks](const std::function<void(size_t)>& block_cb)
   {
-    /* read consensus sequences */
-    fs >> cons_str;
+#ifdef _RAXML_PTHREADS
+    if (num_threads > 1 && num_blocks > 1)
+    {
+      std::atomic<size_t> next_block(0);
+      auto worker = [&next_block, num_blocks, &block_cb]()
+          {
+            for (size_t b = next_block++; b < num_blocks; b = next_block++)
+              block_cb(b);
+          };
+
+      std::vector<std::thread> workers;
+      for (size_t t = 1; t < std::min(num_threads, num_blocks); ++t)
+        workers.emplace_back(worker);
+      worker();
+      for (auto& w: workers)
+        w.join();
+      return;
+    }
+#else
+    RAXML_UNUSED(num_threads);
+#endif
+    for (size_t b = 0; b < num_blocks; ++b)
+      block_cb(b);
+  };
 
-    LOG_DEBUG << "CATG: site " << i << " consesus seq: " << cons_str << endl;
+  if (num_blocks > 1)
+  {
+    /* pass 1: count sites per block */
+    run_blocks([&block_start, &block_sites](size_t b)
+               {
+                 block_sites[b+1] = catg_count_lines(block_start[b], block_start[b+1]);
+               });
+
+    for (size_t b = 0; b < num_blocks; ++b)
+      block_sites[b+1] += block_sites[b];
+  }
 
-    if (cons_str.length() != msa.size())
-      throw runtime_error("Wrong length of consensus sequence for site " + to_string(i+1) + "!");
+  if (num_blocks > 1 && block_sites[num_blocks] == site_count)
+  {
+    /* pass 2: parse blocks in parallel */
+    run_blocks([&](size_t b)
+               {
+                 try
+                 {
+                   catg_parse_sites(m, block_start[b], block_start[b+1],
+                                    block_sites[b], block_sites[b+1]);
+                 }
+                 catch (...)
+                 {
+                   block_error[b] = std::current_exception();
+                 }
+               });
+
+    /* report the first error in file order */
+    for (const auto& e: block_error)
+    {
+      if (e)
+        std::rethrow_exception(e);
+    }
+  }
+  else
+  {
+    /* sites spanning multiple lines or a small file: parse sequentially */
+    catg_parse_sites(m, p, end, 0, site_count);
+  }
+
+#ifdef CATG_DEBUG
+  {
+    PhylipStream ps("catgout.phy");
+    ps << msa;
+  }
+#endif
+
+  return stream;
+}
+
+/* VCF parsing helpers: records are parsed one by one from the mapped file, and only
+ * distinct genotype columns (site patterns) are kept in memory */
+namespace
+{
+
+/* unphased diploid genotype -> pll_map_diploid10 character, alleles are ACGT = 0..3 */
+const char vcf_genotype_chars[4][4] = { {'A', 'M', 'R', 'W'},
+                                        {'M', 'C', 'S', 'Y'},
+                                        {'R', 'S', 'G', 'K'},
+                                        {'W', 'Y', 'K', 'T'} };
+const char vcf_missing_char = '-';
+
+inline int vcf_nt_index(char c)
+{
+  switch (c)
+  {
+    case 'A': case 'a': return 0;
+    case 'C': case 'c': return 1;
+    case 'G': case 'g': return 2;
+    case 'T': case 't': return 3;
+    default: return -1;
+  }
+}
+
+inline const char * vcf_field_end(const char * p, const char * end)
+{
+  while (p < end && *p != '\t' && *p != '\n' && *p != '\r')
+    ++p;
+  return p;
+}
+
+inline const char * vcf_line_end(const char * p, const char * end)
+{
+  const char * q = (const char *) memchr(p, '\n', end - p);
+  return q ? q : end;
+}
+
+/* splits the current line into tab-separated fields, returns false on a premature line end */
+bool vcf_split_fields(const char * p, const char * line_end, size_t count,
+                      std::vector<const char *>& fields)
+{
+  fields.clear();
+  for (size_t i = 0; i < count; ++i)
+  {
+    if (p >= line_end)
+      return false;
+    fields.push_back(p);
+    p = vcf_field_end(p, line_end) + 1;
+  }
+  /* sentinel: start of the (non-existent) next field */
+  fields.push_back(p);
+  return true;
+}
+
+/* parses an allele index from GT ('.' = missing), advances p */
+inline int vcf_parse_allele(const char *& p, const char * end)
+{
+  if (p < end && *p == '.')
+  {
+    ++p;
+    return -1;
+  }
+
+  int idx = 0;
+  const char * start = p;
+  for (; p < end && *p >= '0' && *p <= '9'; ++p)
+    idx = idx * 10 + (*p - '0');
+
+  if (p == start)
+    throw runtime_error("Invalid genotype: " + string(start, vcf_field_end(start, end)));
+
+  return idx;
+}
+
+}
+
+VCFStream& operator>>(VCFStream& stream, MSA& msa)
+{
+  MappedFile file(stream.fname());
+
+  const char * p = file.data();
+  const char * end = file.end();
+
+  const string magic = "##fileformat=VCF";
+  if (file.size() < magic.size() || strncmp(p, magic.c_str(), magic.size()) != 0)
+    throw runtime_error("VCF header not found (file must start with " + magic + ")");
+
+  /* skip meta-information lines */
+  size_t line_num = 0;
+  while (p < end && p[0] == '#' && p + 1 < end && p[1] == '#')
+  {
+    p = vcf_line_end(p, end) + 1;
+    line_num++;
+  }
+
+  const size_t fixed_fields = 9;
+  const string header_prefix = "#CHROM";
+  if ((size_t) (end - p) < header_prefix.size() ||
+      strncmp(p, header_prefix.c_str(), header_prefix.size()) != 0)
+    throw runtime_error("VCF header line (#CHROM...) not found!");
+
+  /* header line: fixed fields followed by sample names */
+  NameList samples;
+  {
+    const char * line_end = vcf_line_end(p, end);
+    const char * q = p;
+    for (size_t i = 0; q < line_end; ++i)
+    {
+      const char * f_end = vcf_field_end(q, line_end);
+      if (i >= fixed_fields)
+        samples.emplace_back(q, f_end);
+      q = f_end + 1;
+    }
+    p = line_end + 1;
+    line_num++;
+  }
+
+  const size_t num_samples = samples.size();
+  if (num_samples < 4)
+    throw runtime_error("VCF file must contain genotypes for at least 4 samples!");
+
+  LOG_DEBUG << "VCF: samples: " << num_samples << endl;
+
+  /* distinct genotype columns -> pattern index */
+  std::unordered_map<string, size_t> pattern_map;
+  std::vector<const string *> patterns;
+  WeightVector weights;
+
+  string column(num_samples, vcf_missing_char);
+  std::vector<const char *> fields;
+  std::vector<int> allele_nt;
+  size_t num_records = 0;
+  size_t skipped_nonsnp = 0;
+  size_t skipped_uninf = 0;
 
-    std::vector<double> probs;
+  for (; p < end; p = vcf_line_end(p, end) + 1)
+  {
+    line_num++;
+
+    const char * line_end = vcf_line_end(p, end);
+    if (line_end == p || (line_end == p + 1 && *p == '\r'))
+      continue;
+
+    num_records++;
+
+    if (!vcf_split_fields(p, line_end, fixed_fields + num_samples, fields) ||
+        (fields.back() <= line_end && fields.back()[-1] == '\t'))
+    {
+      throw runtime_error("Wrong number of fields in line " + to_string(line_num) +
+                          " (expected " + to_string(fixed_fields + num_samples) + ")");
+    }
+
+    /* alleles: REF followed by comma-separated ALT, only SNPs can be represented */
+    allele_nt.clear();
+    bool snp = true;
+    for (size_t f = 3; f <= 4 && snp; ++f)
+    {
+      const char * a = fields[f];
+      const char * a_end = fields[f+1] - 1;
+      if (f == 4 && a_end - a == 1 && *a == '.')
+        break;
+      while (a < a_end)
+      {
+        const char * comma = std::find(a, a_end, ',');
+        const int nt = (comma - a == 1) ? vcf_nt_index(*a) : -1;
+        if (nt < 0)
+        {
+          snp = false;
+          break;
+        }
+        allele_nt.push_back(nt);
+        a = comma + 1;
+      }
+    }
 
-    for (size_t j = 0; j < msa.size(); ++j)
+    /* position of GT in FORMAT */
+    int gt_index = -1;
     {
-      msa[j][i] = cons_str[j];
+      const char * fmt = fields[8];
+      const char * fmt_end = fields[9] - 1;
+      for (int i = 0; fmt < fmt_end; ++i)
+      {
+        const char * colon = std::find(fmt, fmt_end, ':');
+        if (colon - fmt == 2 && fmt[0] == 'G' && fmt[1] == 'T')
+        {
+          gt_index = i;
+          break;
+        }
+        fmt = colon + 1;
+      }
+    }
+
+    if (!snp || gt_index < 0)
+    {
+      skipped_nonsnp++;
+      continue;
+    }
 
-      fs >> prob_str;
+    /* genotypes -> diploid10 characters */
+    char first_gt = 0;
+    bool informative = false;
+    for (size_t j = 0; j < num_samples; ++j)
+    {
+      const char * g = fields[fixed_fields + j];
+      const char * g_end = fields[fixed_fields + j + 1] - 1;
+      for (int i = 0; i < gt_index && g < g_end; ++i)
+        g = std::find(g, g_end, ':') + 1;
 
-      if (msa.states() == 0)
+      char gt = vcf_missing_char;
+      if (g < g_end)
       {
-        auto states = std::count_if(prob_str.cbegin(), prob_str.cend(),
-                                    [](char c) -> bool { return c == ','; }) + 1;
-        msa.states(states);
+        const int a1 = vcf_parse_allele(g, g_end);
+        int a2 = a1;
+        if (g < g_end && (*g == '/' || *g == '|'))
+        {
+          ++g;
+          a2 = vcf_parse_allele(g, g_end);
+        }
 
-        /* see above: for datatypes other than DNA we assume 1:1 mapping */
-        if (states != 4)
-          state_map.clear();
+        if (g < g_end && *g != ':')
+        {
+          throw runtime_error("Only haploid and diploid genotypes are supported (line " +
+                              to_string(line_num) + ", sample " + samples[j] + ")");
+        }
 
-        LOG_DEBUG << "CATG: number of states: " << states << endl;
+        if (a1 >= (int) allele_nt.size() || a2 >= (int) allele_nt.size())
+        {
+          throw runtime_error("Invalid allele index in line " + to_string(line_num) +
+                              ", sample " + samples[j]);
+        }
+
+        if (a1 >= 0 && a2 >= 0)
+          gt = vcf_genotype_chars[allele_nt[a1]][allele_nt[a2]];
       }
 
-      auto site_probs = msa.probs(j, i);
+      column[j] = gt;
 
-      istringstream ss(prob_str);
-      size_t k = 0;
-      for (string token; getline(ss, token, ','); ++k)
+      if (gt != vcf_missing_char)
       {
-        if (state_map.empty())
-          site_probs[k] = stod(token);
-        else
-          site_probs[state_map[k]] = stod(token);
+        if (!first_gt)
+          first_gt = gt;
+        else if (gt != first_gt)
+          informative = true;
       }
+    }
 
-      if (k != msa.states())
-        throw runtime_error("Wrong number of state probabilities for site " + to_string(i+1) + "!");
+    /* invariant or all-missing sites carry no information on the tree topology */
+    if (!informative)
+    {
+      skipped_uninf++;
+      continue;
+    }
+
+    auto ins = pattern_map.emplace(column, patterns.size());
+    if (ins.second)
+    {
+      patterns.push_back(&ins.first->first);
+      weights.push_back(1);
     }
+    else
+      weights[ins.first->second]++;
   }
 
-#ifdef CATG_DEBUG
+  LOG_DEBUG << "VCF: records: " << num_records << ", skipped non-SNP: " << skipped_nonsnp <<
+      ", skipped invariant: " << skipped_uninf << ", patterns: " << patterns.size() << endl;
+
+  if (patterns.empty())
+    throw runtime_error("VCF file does not contain any variable SNP sites!");
+
+  if (skipped_nonsnp + skipped_uninf > 0)
   {
-    PhylipStream ps("catgout.phy");
-    ps << msa;
+    LOG_INFO << "NOTE: " << skipped_nonsnp << " non-SNP and " << skipped_uninf <<
+        " invariant VCF records were skipped." << endl;
+    LOG_INFO << "NOTE: Please consider using ascertainment bias correction (e.g. +ASC_LEWIS)."
+        << endl;
+  }
+
+  /* transpose site patterns into sequences */
+  const size_t num_patterns = patterns.size();
+  msa = MSA(num_patterns);
+  string seq(num_patterns, vcf_missing_char);
+  for (size_t j = 0; j < num_samples; ++j)
+  {
+    for (size_t i = 0; i < num_patterns; ++i)
+      seq[i] = (*patterns[i])[j];
+    msa.append(seq, samples[j]);
   }
-#endif
+
+  msa.weights(std::move(weights));
 
   return stream;
 }
 
-MSA msa_load_from_file(const std::string &filename, const FileFormat format)
+MSA msa_load_from_file(const std::string &filename, const FileFormat format,
+                       size_t num_threads)
 {
   MSA msa;
 
@@ -321,7 +884,14 @@ MSA msa_load_from_file(const std::string &filename, const FileFormat format)
         }
         case FileFormat::catg:
         {
-          CATGStream s(filename);
+          CATGStream s(filename, num_threads);
+          s >> msa;
+          return msa;
+          break;
+        }
+        case FileFormat::vcf:
+        {
+          VCFStream s(filename);
           s >> msa;
           return msa;
           break;
@@ -23,7 +23,11 @@ PartitionAssignmentList LoadBalancer::get_all_assignments(const PartitionAssignm
   if (num_procs == 1)
     return PartitionAssignmentList(1, part_sizes);
   else
-    return compute_assignments(part_sizes, num_procs);
+  {
+    auto part_assign = compute_assignments(part_sizes, num_procs);
+    check_assignments(part_sizes, part_assign);
+    return part_assign;
+  }
 }
 
 PartitionAssignment LoadBalancer::get_proc_assignments(const PartitionAssignment& part_sizes,
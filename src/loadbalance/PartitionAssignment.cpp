@@ -1,3 +1,8 @@
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
 #include "PartitionAssignment.hpp"
 
 PartitionAssignmentStats::PartitionAssignmentStats(const PartitionAssignmentList& part_assign)
@@ -22,6 +27,48 @@ PartitionAssignmentStats::PartitionAssignmentStats(const PartitionAssignmentList
   }
 }
 
+void check_assignments(const PartitionAssignment& part_sizes,
+                       const PartitionAssignmentList& part_assign)
+{
+  std::unordered_map<size_t, std::vector<const PartitionRange*>> part_ranges;
+  for (auto const& pa: part_assign)
+  {
+    for (auto const& range: pa)
+    {
+      if (range.length > 0)
+        part_ranges[range.part_id].push_back(&range);
+    }
+  }
+
+  for (auto const& full_range: part_sizes)
+  {
+    const auto part_id = full_range.part_id;
+    auto& ranges = part_ranges[part_id];
+    std::sort(ranges.begin(), ranges.end(),
+              [](const PartitionRange* a, const PartitionRange* b) { return a->start < b->start; });
+
+    /* ranges must be contiguous and span the whole partition */
+    bool valid = true;
+    size_t pos = full_range.start;
+    for (auto range: ranges)
+    {
+      valid = valid && (range->start == pos);
+      pos += range->length;
+    }
+
+    if (!valid || pos != full_range.start + full_range.length)
+    {
+      throw std::runtime_error("Invalid site distribution for partition " +
+                               std::to_string(part_id) + ": sites are missing or overlapping!");
+    }
+
+    part_ranges.erase(part_id);
+  }
+
+  if (!part_ranges.empty())
+    throw std::runtime_error("Invalid site distribution: unknown partition assigned!");
+}
+
 std::ostream& operator<<(std::ostream& stream, const PartitionAssignment& pa)
 {
   stream << "part#\tstart\tlength" << std::endl;
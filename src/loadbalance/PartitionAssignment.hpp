@@ -59,6 +59,11 @@ private:
 
 typedef std::vector<PartitionAssignment> PartitionAssignmentList;
 
+/* check that every site of every partition is assigned to exactly one process,
+ * throws std::runtime_error otherwise */
+void check_assignments(const PartitionAssignment& part_sizes,
+                       const PartitionAssignmentList& part_assign);
+
 struct PartitionAssignmentStats
 {
   PartitionAssignmentStats(const PartitionAssignmentList& part_assign);
@@ -1,5 +1,6 @@
 #include "log.hpp"
 #include "common.h"
+#include "EventLog.hpp"
 
 using namespace std;
 
@@ -138,6 +139,9 @@ LogStream& operator<<(LogStream& logstream, const TimeStamp& ts)
 
 LogStream& operator<<(LogStream& logstream, const ProgressInfo& prog)
 {
+  /* likelihood updates are recorded regardless of the log level */
+  if (EventLog::enabled())
+    EventLog::write(LogEvent("loglh")("loglh", prog.loglh));
 
   logstream << "[" << TimeStamp() << " " << FMT_LH(prog.loglh) << "] ";
 
@@ -20,6 +20,7 @@
 */
 #include <algorithm>
 #include <chrono>
+#include <thread>
 
 #include <memory>
 
@@ -34,13 +35,23 @@
 #include "TreeInfo.hpp"
 #include "io/file_io.hpp"
 #include "io/binary_io.hpp"
+#include "io/ParallelNewickReader.hpp"
 #include "ParallelContext.hpp"
 #include "loadbalance/LoadBalancer.hpp"
 #include "bootstrap/BootstrapGenerator.hpp"
 #include "bootstrap/BootstopCheck.hpp"
+#include "bootstrap/BootstrapScheduler.hpp"
 #include "bootstrap/TransferBootstrapTree.hpp"
+#include "bootstrap/RFDistCalculator.hpp"
 #include "autotune/ResourceEstimator.hpp"
+#include "autotune/KernelBenchmark.hpp"
 #include "ICScoreCalculator.hpp"
+#include "TerraceSignature.hpp"
+#include "Tracer.hpp"
+#include "HotPathStats.hpp"
+#include "EventLog.hpp"
+#include "MemoryBudget.hpp"
+#include "MSAScan.hpp"
 
 #ifdef _RAXML_TERRAPHAST
 #include "terraces/TerraceWrapper.hpp"
@@ -57,6 +68,11 @@ struct RaxmlInstance
   TreeList start_trees;
   BootstrapReplicateList bs_reps;
   TreeList bs_start_trees;
+
+  /* if set, bootstrap replicates store only the random seed, and site weights are re-generated
+   * into bs_weights_buf right before the respective replicate is inferred */
+  bool lazy_bs_weights = false;
+  WeightVectorList bs_weights_buf;
   PartitionAssignmentList proc_part_assign;
   unique_ptr<LoadBalancer> load_balancer;
   map<BranchSupportMetric, shared_ptr<BootstrapTree> > support_trees;
@@ -65,7 +81,7 @@ struct RaxmlInstance
   unique_ptr<BootstopCheckMRE> bootstop_checker;
 
   // mapping taxon name -> tip_id/clv_id in the tree
-  NameIdMap tip_id_map;
+  TaxonIndex tip_id_map;
 
   // mapping tip_id in the tree (array index) -> sequence index in MSA
   IDVector tip_msa_idmap;
@@ -83,6 +99,9 @@ struct RaxmlInstance
 
   /* topological constraint */
   Tree constraint_tree;
+
+  /* terrace fingerprints for terrace-aware search (partitioned, unlinked brlens only) */
+  unique_ptr<TerraceSignature> terrace_sig;
 };
 
 void print_banner()
@@ -217,18 +236,12 @@ bool check_msa(RaxmlInstance& instance)
   LOG_VERB_TS << "Checking the alignment...\n";
 
   auto& parted_msa = *instance.parted_msa;
-  const auto& full_msa = parted_msa.full_msa();
-  const auto pll_msa = full_msa.pll_msa();
   const auto taxon_count = parted_msa.taxon_count();
 
   bool msa_valid = true;
   bool msa_corrected = false;
   PartitionedMSAView parted_msa_view(instance.parted_msa);
 
-  vector<pair<size_t,size_t> > dup_taxa;
-  vector<pair<size_t,size_t> > dup_seqs;
-  std::set<size_t> gap_seqs;
-
   /* check taxa count */
   if (taxon_count < 4)
   {
@@ -252,68 +265,27 @@ bool check_msa(RaxmlInstance& instance)
 
   msa_valid &= parted_msa_view.taxon_name_map().empty();
 
-  unsigned long stats_mask = PLLMOD_MSA_STATS_DUP_TAXA | PLLMOD_MSA_STATS_DUP_SEQS;
-
-  pllmod_msa_stats_t * stats = pllmod_msa_compute_stats(pll_msa,
-                                                        4,
-                                                        pll_map_nt, // map is not used here
-                                                        NULL,
-                                                        stats_mask);
+  /* duplicate taxa/sequences and fully undetermined columns/sequences */
+  auto scan = scan_msa(parted_msa, instance.opts.num_threads);
 
-  libpll_check_error("ERROR computing MSA stats");
-  assert(stats);
-
-  for (unsigned long c = 0; c < stats->dup_taxa_pairs_count; ++c)
-  {
-    dup_taxa.emplace_back(stats->dup_taxa_pairs[c*2],
-                          stats->dup_taxa_pairs[c*2+1]);
-  }
+  const auto& dup_taxa = scan.dup_taxa;
+  const auto& dup_seqs = scan.dup_seqs;
+  const std::set<size_t> gap_seqs(scan.gap_seqs.cbegin(), scan.gap_seqs.cend());
 
   msa_valid &= dup_taxa.empty();
 
-  for (unsigned long c = 0; c < stats->dup_seqs_pairs_count; ++c)
-  {
-    dup_seqs.emplace_back(stats->dup_seqs_pairs[c*2],
-                          stats->dup_seqs_pairs[c*2+1]);
-  }
-
-  pllmod_msa_destroy_stats(stats);
-
   size_t total_gap_cols = 0;
   size_t part_num = 0;
   for (auto& pinfo: parted_msa.part_list())
   {
-    stats_mask = PLLMOD_MSA_STATS_GAP_SEQS | PLLMOD_MSA_STATS_GAP_COLS;
-
-    pllmod_msa_stats_t * stats = pinfo.compute_stats(stats_mask);
-
-    if (stats->gap_cols_count > 0)
+    const auto& gap_cols = scan.gap_cols[part_num];
+    if (!gap_cols.empty())
     {
-      total_gap_cols += stats->gap_cols_count;
-      std::vector<size_t> gap_cols(stats->gap_cols, stats->gap_cols + stats->gap_cols_count);
+      total_gap_cols += gap_cols.size();
       pinfo.msa().remove_sites(gap_cols);
 //      parted_msa_view.exclude_sites(part_num, gap_cols);
     }
 
-    std::set<size_t> cur_gap_seq(stats->gap_seqs, stats->gap_seqs + stats->gap_seqs_count);
-
-    if (!part_num)
-    {
-      gap_seqs = cur_gap_seq;
-    }
-    else
-    {
-      for(auto it = gap_seqs.begin(); it != gap_seqs.end();)
-      {
-        if(cur_gap_seq.find(*it) == cur_gap_seq.end())
-          it = gap_seqs.erase(it);
-        else
-          ++it;
-      }
-    }
-
-    pllmod_msa_destroy_stats(stats);
-
     part_num++;
   }
 
@@ -361,7 +333,7 @@ bool check_msa(RaxmlInstance& instance)
 
   if (!dup_taxa.empty())
   {
-    for (const auto& p: dup_seqs)
+    for (const auto& p: dup_taxa)
     {
       LOG_ERROR << "ERROR: Sequences " << p.first+1 << " and "
                 << p.second+1 << " have identical name: "
@@ -514,22 +486,29 @@ void check_tree(const PartitionedMSA& msa, const Tree& tree)
   else if (msa.taxon_count() != tree.num_tips())
     throw runtime_error("Some taxa are missing from the alignment file");
 
-  unordered_set<string> tree_labels;
-  unordered_set<string> msa_labels(msa.taxon_names().cbegin(), msa.taxon_names().cend());
+  const auto& msa_labels = msa.taxon_index();
+  std::vector<bool> tree_taxa(msa.taxon_count(), false);
+  unordered_set<string> missing_labels;
 
   for (const auto& tip: tree.tip_labels())
   {
-    if (!tree_labels.insert(tip.second).second)
+    const auto taxon_id = msa_labels.find(tip.second);
+    const bool duplicate = (taxon_id == TaxonIndex::npos) ?
+        !missing_labels.insert(tip.second).second : tree_taxa[taxon_id];
+
+    if (duplicate)
     {
       LOG_ERROR << "ERROR: Taxon name appears more than once in the tree: " << tip.second << endl;
       duplicate_taxa++;
     }
 
-    if (msa_labels.count(tip.second) == 0)
+    if (taxon_id == TaxonIndex::npos)
     {
       LOG_ERROR << "ERROR: Taxon name not found in the alignment: " << tip.second << endl;
       missing_taxa++;
     }
+    else
+      tree_taxa[taxon_id] = true;
   }
 
   if (duplicate_taxa > 0)
@@ -556,7 +535,7 @@ void check_options(RaxmlInstance& instance)
     NameList missing_taxa;
     for (const auto& ot: opts.outgroup_taxa)
     {
-      if (!instance.parted_msa->taxon_id_map().count(ot))
+      if (!instance.parted_msa->taxon_index().count(ot))
         missing_taxa.push_back(ot);
     }
 
@@ -571,6 +550,13 @@ void check_options(RaxmlInstance& instance)
     }
   }
 
+  if (opts.bs_farm_ranks > 0 && ParallelContext::num_world_ranks() < 2)
+  {
+    LOG_WARN << "WARNING: Bootstrap farm mode requires at least 2 MPI ranks, "
+        "option --bs-farm will be ignored." << endl << endl;
+    instance.opts.bs_farm_ranks = 0;
+  }
+
   /* following "soft" checks will be ignored in the --force mode */
   if (opts.force_mode)
     return;
@@ -623,22 +609,53 @@ void load_msa(RaxmlInstance& instance)
   LOG_INFO_TS << "Reading alignment from file: " << opts.msa_file << endl;
 
   /* load MSA */
-  auto msa = msa_load_from_file(opts.msa_file, opts.msa_format);
+  auto msa = msa_load_from_file(opts.msa_file, opts.msa_format, opts.num_threads);
 
   LOG_INFO_TS << "Loaded alignment with " << msa.size() << " taxa and " <<
       msa.num_sites() << " sites" << endl;
 
   if (msa.probabilistic() && opts.use_prob_msa)
   {
-    instance.opts.use_pattern_compression = false;
+    /* tip CLVs are set directly from state probabilities */
     instance.opts.use_tip_inner = false;
+    instance.opts.use_repeats = false;
 
-    if (parted_msa.part_count() > 1)
-      throw runtime_error("Partitioned probabilistic alignments are not supported yet, sorry...");
+    /* identical (rounded) probability vectors are merged by pattern compression */
+    if (opts.prob_msa_digits > 0)
+      msa.round_probs(opts.prob_msa_digits);
+
+    for (const auto& pinfo: parted_msa.part_list())
+    {
+      if (pinfo.model().num_states() != msa.states())
+      {
+        throw runtime_error("Model of partition " + pinfo.name() + " has " +
+                            to_string(pinfo.model().num_states()) + " states, but " +
+                            "probabilistic alignment has " + to_string(msa.states()) + "!");
+      }
+    }
   }
   else
+  {
     instance.opts.use_prob_msa = false;
 
+    /* only consensus sequences will be used */
+    if (msa.probabilistic())
+      msa.states(0);
+  }
+
+  /* site ranges can't be applied to an alignment which was compressed while loading (VCF) */
+  if (msa.num_sites() != msa.length())
+  {
+    for (const auto& pinfo: parted_msa.part_list())
+    {
+      if (parted_msa.part_count() > 1 || !pinfo.range_string().empty())
+      {
+        throw runtime_error("Site ranges (partition " + pinfo.name() +
+                            ") are not supported for this alignment format, sorry...");
+      }
+    }
+  }
+
   parted_msa.full_msa(std::move(msa));
 
   LOG_VERB_TS << "Extracting partitions... " << endl;
@@ -685,7 +702,7 @@ void load_msa(RaxmlInstance& instance)
     {
       LOG_INFO << "NOTE: Binary MSA file already exists: " << binary_msa_fname << endl << endl;
     }
-    else if (opts.command != Command::check)
+    else if (opts.command != Command::check && opts.command != Command::bench)
     {
       RBAStream bs(binary_msa_fname);
       bs << parted_msa;
@@ -704,7 +721,9 @@ void load_parted_msa(RaxmlInstance& instance)
     load_msa(instance);
 
   // use MSA sequences IDs as "normalized" tip IDs in all trees
-  instance.tip_id_map = instance.parted_msa->taxon_id_map();
+  instance.tip_id_map = instance.parted_msa->taxon_index();
+
+  MemoryBudget::allocate(MemCategory::msa, msa_mem_size(*instance.parted_msa));
 }
 
 void prepare_tree(const RaxmlInstance& instance, Tree& tree)
@@ -713,7 +732,7 @@ void prepare_tree(const RaxmlInstance& instance, Tree& tree)
   tree.fix_missing_brlens();
 
   /* make sure tip indices are consistent between MSA and pll_tree */
-  assert(!instance.parted_msa->taxon_id_map().empty());
+  assert(!instance.parted_msa->taxon_index().empty());
   tree.reset_tip_ids(instance.tip_id_map);
 }
 
@@ -825,6 +844,9 @@ void load_checkpoint(RaxmlInstance& instance, CheckpointManager& cm)
     // this is a "template" tree, which provides tip labels and node ids
     ckp.tree = instance.random_tree;
 
+    // checkpoint must belong to the same data, but not necessarily to the same parallel setup
+    ckp.data_info = CheckpointDataInfo(*instance.parted_msa);
+
     cm.checkpoint(move(ckp));
   }
 
@@ -844,7 +866,7 @@ void load_checkpoint(RaxmlInstance& instance, CheckpointManager& cm)
     LOG_INFO_TS << "NOTE: Resuming execution from checkpoint " <<
         "(logLH: " << ckp.loglh() <<
         ", ML trees: " << ckp.ml_trees.size() <<
-        ", bootstraps: " << ckp.bs_trees.size() <<
+        ", bootstraps: " << ckp.num_bs_trees() <<
         ")"
         << endl;
   }
@@ -869,7 +891,7 @@ void load_constraint(RaxmlInstance& instance)
       NameList missing_taxa;
       for (const auto& l: cons_tree.tip_labels())
       {
-        if (!parted_msa.taxon_id_map().count(l.second))
+        if (!parted_msa.taxon_index().count(l.second))
           missing_taxa.push_back(l.second);;
       }
 
@@ -888,7 +910,7 @@ void load_constraint(RaxmlInstance& instance)
     {
       // incomplete constraint tree -> adjust tip IDs such that all taxa in the constraint tree
       // go before the remaining free taxa
-      instance.tip_id_map.clear();
+      IdNameVector tip_id_names;
       instance.tip_msa_idmap.resize(parted_msa.taxon_count());
       auto cons_name_map = cons_tree.tip_ids();
       size_t seq_id = 0;
@@ -897,9 +919,10 @@ void load_constraint(RaxmlInstance& instance)
       for (const auto& name: parted_msa.taxon_names())
       {
         auto tip_id = cons_name_map.count(name) ? cons_tip_id++ : free_tip_id++;
-        instance.tip_id_map[name] = tip_id;
+        tip_id_names.emplace_back(tip_id, name);
         instance.tip_msa_idmap[tip_id] = seq_id++;
       }
+      instance.tip_id_map = TaxonIndex(tip_id_names);
       assert(cons_tip_id == cons_tree.num_tips());
       assert(free_tip_id == instance.tip_id_map.size());
       assert(instance.tip_id_map.size() == parted_msa.taxon_count());
@@ -988,6 +1011,8 @@ void build_parsimony_msa(RaxmlInstance& instance)
       pinfo.compress_patterns();
     }
   }
+
+  MemoryBudget::allocate(MemCategory::msa, msa_mem_size(pars_msa));
 }
 
 void build_start_trees(RaxmlInstance& instance, size_t skip_trees)
@@ -1018,8 +1043,18 @@ void build_start_trees(RaxmlInstance& instance, size_t skip_trees)
       case StartingTree::parsimony:
         if (parted_msa.part_count() > 1)
         {
-          LOG_DEBUG_TS << "Generating MSA partitioned by data type for parsimony computation" << endl;
-          build_parsimony_msa(instance);
+          /* uncompressed per-datatype MSA might not fit into memory, in this case
+           * parsimony is computed on the original (partitioned) MSA instead */
+          if (MemoryBudget::fits(parted_msa.taxon_count() * parted_msa.total_sites()))
+          {
+            LOG_DEBUG_TS << "Generating MSA partitioned by data type for parsimony computation" << endl;
+            build_parsimony_msa(instance);
+          }
+          else
+          {
+            LOG_INFO << "NOTE: MSA partitioned by data type would exceed the memory limit, "
+                "using original MSA for parsimony computation." << endl;
+          }
         }
         LOG_INFO_TS << "Generating " << st_tree_count << " parsimony starting tree(s) with "
                     << parted_msa.taxon_count() << " taxa" << endl;
@@ -1053,7 +1088,11 @@ void build_start_trees(RaxmlInstance& instance, size_t skip_trees)
   }
 
   // free memory used for parsimony MSA
-  instance.parted_msa_parsimony.release();
+  if (instance.parted_msa_parsimony)
+  {
+    MemoryBudget::release(MemCategory::msa, msa_mem_size(*instance.parted_msa_parsimony));
+    instance.parted_msa_parsimony.reset();
+  }
 
   if (::ParallelContext::master_rank())
   {
@@ -1063,6 +1102,24 @@ void build_start_trees(RaxmlInstance& instance, size_t skip_trees)
   }
 }
 
+void init_load_balancer(RaxmlInstance& instance)
+{
+  switch(instance.opts.load_balance_method)
+  {
+    case LoadBalancing::naive:
+      instance.load_balancer.reset(new SimpleLoadBalancer());
+      break;
+    case LoadBalancing::kassian:
+      instance.load_balancer.reset(new KassianLoadBalancer());
+      break;
+    case LoadBalancing::benoit:
+      instance.load_balancer.reset(new BenoitLoadBalancer());
+      break;
+    default:
+      assert(0);
+  }
+}
+
 void balance_load(RaxmlInstance& instance)
 {
   PartitionAssignment part_sizes;
@@ -1140,6 +1197,95 @@ void balance_load(RaxmlInstance& instance, WeightVectorList part_site_weights)
 //  LOG_DEBUG << endl << instance.proc_part_assign;
 }
 
+void check_memory_budget(RaxmlInstance& instance, const Checkpoint& checkp)
+{
+  auto& opts = instance.opts;
+  const auto& parted_msa = *instance.parted_msa;
+
+  /* CLVs, p-matrices etc. for all threads of the current rank */
+  auto treeinfo_mem = [&instance, &parted_msa](const Options& o) -> MemoryUsage
+  {
+    MemoryUsage usage;
+    for (size_t i = 0; i < ParallelContext::num_threads(); ++i)
+    {
+      const auto& part_assign = instance.proc_part_assign.at(ParallelContext::proc_id() + i);
+      usage += treeinfo_mem_size(o, parted_msa, part_assign);
+    }
+    return usage;
+  };
+
+  const bool bootstrap = opts.command == Command::bootstrap || opts.command == Command::all;
+  const size_t num_bs = bootstrap && opts.num_bootstraps > checkp.num_bs_trees() ?
+                          opts.num_bootstraps - checkp.num_bs_trees() : 0;
+
+  size_t bs_weights_size = 0;
+  for (const auto& pinfo: parted_msa.part_list())
+    bs_weights_size += pinfo.msa().length() * sizeof(WeightType);
+
+  /* trees and bootstrap weights will be kept in memory until the end of the run */
+  MemoryUsage reserved;
+  reserved[MemCategory::trees] = (instance.start_trees.size() + opts.num_searches + num_bs) *
+                                  tree_mem_size(parted_msa.taxon_count());
+  reserved[MemCategory::bs_weights] = num_bs * bs_weights_size;
+
+  auto required = reserved;
+  required += treeinfo_mem(opts);
+
+  /* try to reduce memory footprint if needed: 1) bootstrap weights */
+  if (!MemoryBudget::fits(required.total()) && num_bs > 1)
+  {
+    instance.lazy_bs_weights = true;
+    required[MemCategory::bs_weights] = reserved[MemCategory::bs_weights] = bs_weights_size;
+
+    LOG_INFO << "NOTE: Bootstrap replicate weights will be generated on-the-fly "
+        "to reduce memory usage." << endl;
+  }
+
+  /* 2) likelihood kernel optimizations: pick the one with the smallest footprint */
+  if (!MemoryBudget::fits(required.total()) && !opts.use_prob_msa)
+  {
+    const vector<pair<bool, bool> > clv_modes = {{true, false}, {false, true}, {false, false}};
+    const char * clv_mode_names[] = {"site repeats", "tip-inner", "none"};
+
+    auto best_mem = treeinfo_mem(opts);
+    size_t best_mode = clv_modes.size();
+    for (size_t i = 0; i < clv_modes.size(); ++i)
+    {
+      Options o = opts;
+      o.use_repeats = clv_modes[i].first;
+      o.use_tip_inner = clv_modes[i].second;
+      auto mem = treeinfo_mem(o);
+      if (mem.total() < best_mem.total())
+      {
+        best_mem = mem;
+        best_mode = i;
+      }
+    }
+
+    if (best_mode < clv_modes.size())
+    {
+      opts.use_repeats = clv_modes[best_mode].first;
+      opts.use_tip_inner = clv_modes[best_mode].second;
+      required = reserved;
+      required += best_mem;
+
+      LOG_INFO << "NOTE: Likelihood kernel optimization was switched to '"
+               << clv_mode_names[best_mode] << "' to reduce memory usage." << endl;
+    }
+  }
+
+  auto total = MemoryBudget::used();
+  total += required;
+
+  if (!MemoryBudget::fits(required.total()))
+    throw MemoryBudgetException(total, MemoryBudget::limit());
+
+  MemoryBudget::allocate(reserved);
+
+  RAXML_LOG(opts.mem_limit ? LogLevel::info : LogLevel::verbose) << "Estimated memory usage: "
+      << total.total() / (1024 * 1024) << " MB (" << total << ")" << endl << endl;
+}
+
 void generate_bootstraps(RaxmlInstance& instance, const Checkpoint& checkp)
 {
   if (instance.opts.command == Command::bootstrap || instance.opts.command == Command::all)
@@ -1151,10 +1297,17 @@ void generate_bootstraps(RaxmlInstance& instance, const Checkpoint& checkp)
       auto seed = rand();
 
       /* check if this BS was already computed in the previous run and saved in checkpoint */
-      if (b < checkp.bs_trees.size())
+      if (b < checkp.num_bs_trees())
         continue;
 
-      instance.bs_reps.emplace_back(bg.generate(*instance.parted_msa, seed));
+      if (instance.lazy_bs_weights)
+      {
+        BootstrapReplicate bs;
+        bs.seed = seed;
+        instance.bs_reps.push_back(bs);
+      }
+      else
+        instance.bs_reps.emplace_back(bg.generate(*instance.parted_msa, seed));
     }
 
     /* generate starting trees for bootstrap searches */
@@ -1162,7 +1315,7 @@ void generate_bootstraps(RaxmlInstance& instance, const Checkpoint& checkp)
     {
       auto tree = generate_tree(instance, StartingTree::random);
 
-      if (b < checkp.bs_trees.size())
+      if (b < checkp.num_bs_trees())
         continue;
 
       instance.bs_start_trees.emplace_back(move(tree));
@@ -1170,6 +1323,22 @@ void generate_bootstraps(RaxmlInstance& instance, const Checkpoint& checkp)
   }
 }
 
+/* re-generate site weights for the replicate if needed (master thread only!) */
+void load_bootstrap_weights(RaxmlInstance& instance, const BootstrapReplicate& bs)
+{
+  if (instance.lazy_bs_weights)
+  {
+    BootstrapGenerator bg;
+    instance.bs_weights_buf = bg.generate(*instance.parted_msa, bs.seed).site_weights;
+  }
+}
+
+const WeightVectorList& bootstrap_weights(const RaxmlInstance& instance,
+                                          const BootstrapReplicate& bs)
+{
+  return instance.lazy_bs_weights ? instance.bs_weights_buf : bs.site_weights;
+}
+
 void reroot_tree_with_outgroup(const Options& opts, Tree& tree, bool add_root_node)
 {
   if (!opts.outgroup_taxa.empty())
@@ -1195,170 +1364,210 @@ void postprocess_tree(const Options& opts, Tree& tree)
   // TODO: regraft previously removed duplicate seqs etc.
 }
 
-void draw_bootstrap_support(RaxmlInstance& instance, Tree& ref_tree, const TreeCollection& bs_trees)
+void init_bootstrap_support(RaxmlInstance& instance, Tree& ref_tree)
 {
   reroot_tree_with_outgroup(instance.opts, ref_tree, false);
 
   for (auto metric: instance.opts.bs_metrics)
   {
       shared_ptr<BootstrapTree> sup_tree;
-      bool support_in_pct = false;
 
       if (metric == BranchSupportMetric::fbp)
-      {
         sup_tree = make_shared<BootstrapTree>(ref_tree);
-        support_in_pct = true;
-      }
       else if (metric == BranchSupportMetric::tbe)
-      {
         sup_tree = make_shared<TransferBootstrapTree>(ref_tree);
-        support_in_pct = false;
-      }
       else
         assert(0);
 
-      Tree tree = ref_tree;
-      for (auto bs: bs_trees)
-      {
-        tree.topology(bs.second);
-        sup_tree->add_bootstrap_tree(tree);
-      }
-      sup_tree->calc_support(support_in_pct);
-
       instance.support_trees[metric] = sup_tree;
   }
 }
 
-bool check_bootstop(const RaxmlInstance& instance, const TreeCollection& bs_trees,
-                    bool print = false)
+void update_bootstrap_support(RaxmlInstance& instance, const Tree& bs_tree)
 {
-  if (!instance.bootstop_checker)
-    return false;
+  for (auto& it: instance.support_trees)
+    it.second->add_bootstrap_tree(bs_tree);
+}
+
+void calc_bootstrap_support(RaxmlInstance& instance)
+{
+  for (auto& it: instance.support_trees)
+  {
+    bool support_in_pct = (it.first == BranchSupportMetric::fbp);
+    it.second->calc_support(support_in_pct);
+  }
+}
 
-  const auto& opts       = instance.opts;
+void print_bootstop_header(const Options& opts)
+{
+  LOG_INFO << "Performing bootstrap convergence assessment using autoMRE criterion"
+           << endl << endl;
+
+  // # Trees     Avg WRF in %    # Perms: wrf <= 2.00 %
+  LOG_INFO << " # trees       "
+           << " avg WRF      "
+           << " avg WRF in %      "
+           << " # perms: wrf <= " << setprecision(2) << opts.bootstop_cutoff * 100 << " %    "
+           << " converged?  " << endl;
+}
+
+bool check_bootstop(const RaxmlInstance& instance, bool print = false)
+{
   auto& bootstop_checker = instance.bootstop_checker;
 
-  if (!bootstop_checker->max_bs_trees())
-    bootstop_checker->max_bs_trees(bs_trees.size());
+  bool converged = bootstop_checker->converged(rand());
 
   if (print)
   {
-    LOG_INFO << "Performing bootstrap convergence assessment using autoMRE criterion"
-             << endl << endl;
-
-    // # Trees     Avg WRF in %    # Perms: wrf <= 2.00 %
-    LOG_INFO << " # trees       "
-             << " avg WRF      "
-             << " avg WRF in %      "
-             << " # perms: wrf <= " << setprecision(2) << opts.bootstop_cutoff * 100 << " %    "
-             << " converged?  " << endl;
+    LOG_INFO << setw(8) << bootstop_checker->num_bs_trees() << " "
+             << setw(14) << setprecision(3) << bootstop_checker->avg_wrf() << "   "
+             << setw(16) << setprecision(3) << bootstop_checker->avg_pct() << "   "
+             << setw(26) << bootstop_checker->num_better() << "        "
+             << (converged ? "YES" : "NO") << endl;
   }
 
-  assert(!instance.random_tree.empty());
+  return converged;
+}
 
-  Tree bs_tree = instance.random_tree;
-  size_t bs_num = 0;
-  bool converged = false;
-  for (auto it: bs_trees)
-  {
-    bs_tree.topology(it.second);
+size_t read_bootstrap_trees(const RaxmlInstance& instance, Tree& ref_tree,
+                            const ParallelNewickReader::ConsumeCallback& consume_cb)
+{
+  const auto& opts = instance.opts;
 
-    bootstop_checker->add_bootstrap_tree(bs_tree);
+  LOG_INFO << "Reading bootstrap trees from file: " << opts.bootstrap_trees_file() << endl;
 
-    bs_num++;
+  if (ref_tree.empty())
+  {
+    NewickStream boots(opts.bootstrap_trees_file(), std::ios::in);
+    boots >> ref_tree;
 
-    if (bs_num % opts.bootstop_interval == 0 || bs_num == bs_trees.size())
-    {
-      converged = bootstop_checker->converged(rand());
+    if (ref_tree.empty())
+      throw runtime_error("You must provide a file with multiple bootstrap trees!");
+  }
 
-      if (print)
+  /* tip name -> id index is built once and shared (read-only) by all parser threads */
+  const TaxonIndex ref_tip_ids = ref_tree.tip_ids();
+
+  auto prepare_cb = [&ref_tip_ids](size_t bs_num, Tree& tree)
       {
-        LOG_INFO << setw(8) << bs_num << " "
-                 << setw(14) << setprecision(3) << bootstop_checker->avg_wrf() << "   "
-                 << setw(16) << setprecision(3) << bootstop_checker->avg_pct() << "   "
-                 << setw(26) << bootstop_checker->num_better() << "        "
-                 << (converged ? "YES" : "NO") << endl;
-      }
+        if (!tree.binary())
+        {
+          throw runtime_error("Bootstrap tree #" + to_string(bs_num+1) +
+                              " contains multifurcations!");
+        }
 
-      if (converged)
-        break;
-    }
-  }
+        try
+        {
+          tree.reset_tip_ids(ref_tip_ids);
+        }
+        catch (out_of_range& e)
+        {
+          throw runtime_error("Bootstrap tree #" + to_string(bs_num+1) +
+                              " contains incompatible taxon name(s)!");
+        }
+        catch (invalid_argument& e)
+        {
+          throw runtime_error("Bootstrap tree #" + to_string(bs_num+1) +
+                              " has wrong number of tips: " + to_string(tree.num_tips()));
+        }
+      };
 
-  if (print)
+  ParallelNewickReader reader(opts.bootstrap_trees_file(), std::max(1u, opts.num_threads));
+  auto num_bs_trees = reader.read(prepare_cb, consume_cb);
+
+  LOG_INFO << "Bootstrap trees found: " << num_bs_trees << endl << endl;
+
+  if (num_bs_trees < 2)
   {
-    LOG_INFO << "Bootstopping test " << (converged ? "converged" : "did not converge")
-             << " after " <<  bootstop_checker->num_bs_trees() << " trees" << endl << endl;
+    throw runtime_error("You must provide a file with multiple bootstrap trees!");
   }
 
-  return converged;
+  return num_bs_trees;
 }
 
-TreeCollection read_bootstrap_trees(const RaxmlInstance& instance, Tree& ref_tree)
+void load_checkpoint_bootstrap_trees(RaxmlInstance& instance, const Checkpoint& checkp)
 {
-  NameIdMap ref_tip_ids;
+  /* bootstrap trees from the previous run(s) are not stored in the checkpoint,
+   * so re-read them from the output file to restore support and bootstopping state */
+  if (!checkp.num_bs_trees() || (!instance.bootstop_checker && instance.support_trees.empty()))
+    return;
+
   const auto& opts = instance.opts;
- NewickStream boots(opts.bootstrap_trees_file(), std::ios::in);
-  TreeCollection bs_trees;
-  unsigned int bs_num = 0;
+  if (opts.bootstrap_trees_file().empty())
+    throw runtime_error("Cannot resume bootstrapping: bootstrap trees file is not available!");
 
-  LOG_INFO << "Reading bootstrap trees from file: " << opts.bootstrap_trees_file() << endl;
+  LOG_DEBUG << "Loading " << checkp.num_bs_trees() << " bootstrap trees from file: "
+            << opts.bootstrap_trees_file() << endl;
 
-  while (boots.peek() != EOF)
+  NewickStream boots(opts.bootstrap_trees_file(), std::ios::in);
+  auto tip_ids = checkp.tree.tip_ids();
+  for (size_t b = 0; b < checkp.num_bs_trees(); ++b)
   {
     Tree tree;
     boots >> tree;
 
-    if (bs_trees.empty())
-    {
-      if (ref_tree.empty())
-        ref_tree = tree;
-      ref_tip_ids = ref_tree.tip_ids();
-    }
+    if (tree.empty())
+      throw runtime_error("Bootstrap trees file is shorter than recorded in the checkpoint!");
 
-    assert(!ref_tip_ids.empty());
+    tree.reset_tip_ids(tip_ids);
 
-    if (!tree.binary())
-    {
-      LOG_DEBUG << "REF #branches: " << ref_tree.num_branches()
-                << ", BS #branches: " << tree.num_branches() << endl;
-      throw runtime_error("Bootstrap tree #" + to_string(bs_num+1) +
-                          " contains multifurcations!");
-    }
+    if (instance.bootstop_checker)
+      instance.bootstop_checker->add_bootstrap_tree(tree);
 
-    try
-    {
-      tree.reset_tip_ids(ref_tip_ids);
-    }
-    catch (out_of_range& e)
-    {
-      throw runtime_error("Bootstrap tree #" + to_string(bs_num+1) +
-                          " contains incompatible taxon name(s)!");
-    }
-    catch (invalid_argument& e)
-    {
-      throw runtime_error("Bootstrap tree #" + to_string(bs_num+1) +
-                          " has wrong number of tips: " + to_string(tree.num_tips()));
-    }
-    bs_trees.push_back(0, tree);
-    bs_num++;
+    if (ParallelContext::master())
+      update_bootstrap_support(instance, tree);
   }
+}
+
+void command_bootstrap_trees(RaxmlInstance& instance, Tree& ref_tree, bool support)
+{
+  auto& bootstop_checker = instance.bootstop_checker;
+  const auto& opts = instance.opts;
+  bool converged = false;
+  size_t last_check = 0;
+
+  if (bootstop_checker)
+    print_bootstop_header(opts);
 
-  LOG_INFO << "Bootstrap trees found: " << bs_trees.size() << endl << endl;
+  if (support)
+    init_bootstrap_support(instance, ref_tree);
 
-  if (bs_trees.size() < 2)
+  /* trees are processed as soon as they are parsed, in the file order */
+  auto consume_cb = [&](size_t, const Tree& tree)
+      {
+        if (support)
+          update_bootstrap_support(instance, tree);
+
+        if (bootstop_checker && !converged)
+        {
+          bootstop_checker->add_bootstrap_tree(tree);
+
+          if (bootstop_checker->num_bs_trees() % opts.bootstop_interval == 0)
+          {
+            converged = check_bootstop(instance, true);
+            last_check = bootstop_checker->num_bs_trees();
+          }
+        }
+      };
+
+  read_bootstrap_trees(instance, ref_tree, consume_cb);
+
+  if (support)
+    calc_bootstrap_support(instance);
+
+  if (bootstop_checker)
   {
-    throw runtime_error("You must provide a file with multiple bootstrap trees!");
-  }
+    if (!converged && last_check < bootstop_checker->num_bs_trees())
+      converged = check_bootstop(instance, true);
 
-  return bs_trees;
+    LOG_INFO << "Bootstopping test " << (converged ? "converged" : "did not converge")
+             << " after " <<  bootstop_checker->num_bs_trees() << " trees" << endl << endl;
+  }
 }
 
 void command_bootstop(RaxmlInstance& instance)
 {
-  auto bs_trees = read_bootstrap_trees(instance, instance.random_tree);
-
-  check_bootstop(instance, bs_trees, true);
+  command_bootstrap_trees(instance, instance.random_tree, false);
 }
 
 void command_support(RaxmlInstance& instance)
@@ -1376,11 +1585,209 @@ void command_support(RaxmlInstance& instance)
 
   LOG_INFO << "Reference tree size: " << to_string(ref_tree.num_tips()) << endl << endl;
 
-  /* read all bootstrap trees from a Newick file */
-  auto bs_trees = read_bootstrap_trees(instance, ref_tree);
+  /* stream bootstrap trees from a Newick file */
+  command_bootstrap_trees(instance, ref_tree, true);
+}
+
+void command_rfdist(RaxmlInstance& instance)
+{
+  const auto& opts = instance.opts;
+
+  LOG_INFO << "Reading trees from file: " << opts.tree_file << endl;
+
+  if (!sysutil_file_exists(opts.tree_file))
+    throw runtime_error("File not found: " + opts.tree_file);
+
+  Tree first_tree;
+  {
+    NewickStream trees(opts.tree_file, std::ios::in);
+    trees >> first_tree;
+  }
+
+  if (first_tree.empty())
+    throw runtime_error("You must provide a file with multiple trees!");
+
+  /* all trees use tip ids of the first one */
+  const TaxonIndex tip_ids = first_tree.tip_ids();
+
+  auto prepare_cb = [&tip_ids](size_t tree_num, Tree& tree)
+      {
+        if (!tree.binary())
+        {
+          throw runtime_error("Tree #" + to_string(tree_num+1) +
+                              " contains multifurcations!");
+        }
+
+        try
+        {
+          tree.reset_tip_ids(tip_ids);
+        }
+        catch (out_of_range& e)
+        {
+          throw runtime_error("Tree #" + to_string(tree_num+1) +
+                              " contains incompatible taxon name(s)!");
+        }
+        catch (invalid_argument& e)
+        {
+          throw runtime_error("Tree #" + to_string(tree_num+1) +
+                              " has wrong number of tips: " + to_string(tree.num_tips()));
+        }
+      };
+
+  RFDistCalculator rfcalc;
+  auto consume_cb = [&rfcalc](size_t, const Tree& tree) { rfcalc.add_tree(tree); };
+
+  ParallelNewickReader reader(opts.tree_file, std::max(1u, opts.num_threads));
+  const auto num_trees = reader.read(prepare_cb, consume_cb);
+
+  if (num_trees < 2)
+    throw runtime_error("You must provide a file with multiple trees!");
+
+  LOG_INFO << "Loaded " << num_trees << " trees with " << rfcalc.num_tips() << " taxa." << endl;
+  LOG_DEBUG << "Distinct splits: " << rfcalc.num_unique_splits() << endl;
+
+  ofstream fs;
+  if (!opts.rfdist_file().empty())
+    fs.open(opts.rfdist_file());
+
+  /* up to 10^8 lines -> format into a large buffer instead of using stream operators */
+  const size_t buf_size = 1024 * 1024;
+  string buf;
+  buf.reserve(buf_size + 256);
+  char line[256];
+
+  const double max_rf = rfcalc.max_rf();
+  double sum_rf = 0., sum_nrf = 0., sum_wrf = 0.;
+  vector<bool> duplicate(num_trees, false);
+
+  auto pair_cb = [&](size_t i, size_t j, unsigned int rf, double wrf)
+      {
+        const double nrf = max_rf > 0. ? rf / max_rf : 0.;
+
+        sum_rf += rf;
+        sum_nrf += nrf;
+        sum_wrf += wrf;
+
+        if (!rf)
+          duplicate[j] = true;
+
+        if (fs.is_open())
+        {
+          buf.append(line, snprintf(line, sizeof(line), "%zu %zu %u %.6f %.6f\n",
+                                    i, j, rf, nrf, wrf));
+          if (buf.size() >= buf_size)
+          {
+            fs.write(buf.data(), buf.size());
+            buf.clear();
+          }
+        }
+      };
+
+  rfcalc.all_pairs(std::max(1u, opts.num_threads), pair_cb);
+
+  if (fs.is_open())
+    fs.write(buf.data(), buf.size());
+
+  const double num_pairs = num_trees * (num_trees - 1) / 2.;
+  const size_t num_unique = std::count(duplicate.cbegin(), duplicate.cend(), false);
 
-  draw_bootstrap_support(instance, ref_tree, bs_trees);
-  check_bootstop(instance, bs_trees, true);
+  LOG_INFO << endl;
+  LOG_INFO << "Average absolute RF distance in this tree set: " << sum_rf / num_pairs << endl;
+  LOG_INFO << "Average relative RF distance in this tree set: " << sum_nrf / num_pairs << endl;
+  if (rfcalc.weighted())
+    LOG_INFO << "Average weighted RF distance in this tree set: " << sum_wrf / num_pairs << endl;
+  LOG_INFO << "Number of unique topologies in this tree set: " << num_unique << endl << endl;
+}
+
+void print_bench_result(const string& kernel, double seconds, double flops, size_t sites)
+{
+  ostringstream ss;
+  ss << "  " << left << setw(16) << (kernel + ":") << right << fixed <<
+      setw(12) << setprecision(4) << seconds * 1000. << " ms/call" <<
+      setw(10) << setprecision(2) << flops / seconds / 1e9 << " GFLOP/s";
+  if (sites > 0)
+    ss << setw(12) << setprecision(2) << sites / seconds / 1e6 << " M sites/s";
+  LOG_INFO << ss.str() << endl;
+}
+
+void command_bench(RaxmlInstance& instance)
+{
+  auto& opts = instance.opts;
+
+  /* ranks would compete for the same cores, so only the master rank runs the benchmark */
+  if (!ParallelContext::master_rank())
+    return;
+
+  if (opts.msa_file.empty())
+  {
+    const string model = opts.model_file.empty() ?
+        random_msa_default_model(opts.bench_states) : opts.model_file;
+
+    LOG_INFO_TS << "Generating random alignment with " << opts.bench_taxa << " taxa, " <<
+        opts.bench_sites << " sites and " << opts.bench_states << " states" << endl << endl;
+
+    instance.parted_msa = std::make_shared<PartitionedMSA>();
+    auto& parted_msa = *instance.parted_msa;
+    parted_msa.emplace_part_info("synthetic", opts.data_type, model);
+    parted_msa.full_msa(random_msa(opts.bench_taxa, opts.bench_sites, opts.bench_states, 0.,
+                                   opts.random_seed));
+    parted_msa.split_msa();
+    if (opts.use_pattern_compression)
+      parted_msa.compress_patterns();
+    parted_msa.set_model_empirical_params();
+
+    instance.tip_id_map = parted_msa.taxon_index();
+    opts.brlen_linkage = PLLMOD_COMMON_BRLEN_LINKED;
+
+    LOG_INFO << parted_msa << endl;
+  }
+  else
+    load_parted_msa(instance);
+
+  init_load_balancer(instance);
+
+  const auto& parted_msa = *instance.parted_msa;
+  const Tree tree = generate_tree(instance, StartingTree::random);
+
+  KernelBenchmark bench(opts, parted_msa, instance.tip_msa_idmap, tree, *instance.load_balancer,
+                        RAXML_BENCH_MIN_TIME);
+
+  /* sweep all SIMD kernels up to --simd, and thread counts (powers of 2) up to --threads */
+  const unsigned int max_simd = opts.simd_arch;
+  vector<unsigned int> simd_archs;
+  for (auto simd_arch: {PLL_ATTRIB_ARCH_CPU, PLL_ATTRIB_ARCH_SSE, PLL_ATTRIB_ARCH_AVX,
+                        PLL_ATTRIB_ARCH_AVX2})
+  {
+    if ((unsigned int) simd_arch <= max_simd)
+      simd_archs.push_back(simd_arch);
+  }
+
+  vector<size_t> thread_counts;
+  for (size_t t = 1; t < opts.num_threads; t *= 2)
+    thread_counts.push_back(t);
+  thread_counts.push_back(opts.num_threads);
+
+  const size_t patterns = bench.num_patterns();
+
+  LOG_INFO << "Benchmarking likelihood kernels on " << parted_msa.taxon_count() << " taxa and " <<
+      patterns << " patterns" << endl << endl;
+
+  for (auto simd_arch: simd_archs)
+  {
+    opts.simd_arch = simd_arch;
+    for (auto num_threads: thread_counts)
+    {
+      auto t = bench.run(simd_arch, num_threads);
+
+      LOG_INFO << "SIMD: " << opts.simd_arch_name() << ", threads: " << num_threads << endl;
+      print_bench_result("full logLH", t.full_loglh, bench.full_loglh_flops(), patterns);
+      print_bench_result("partial logLH", t.partial_loglh, bench.partial_loglh_flops(), patterns);
+      print_bench_result("derivatives", t.derivatives, bench.derivatives_flops(), patterns);
+      print_bench_result("p-matrices", t.pmatrix, bench.pmatrix_flops(), 0);
+      LOG_INFO << endl;
+    }
+  }
+  opts.simd_arch = max_simd;
 }
 
 void check_terrace(const RaxmlInstance& instance, const Tree& tree)
@@ -1399,15 +1806,25 @@ void check_terrace(const RaxmlInstance& instance, const Tree& tree)
         LOG_WARN << "WARNING: Best-found ML tree lies on a terrace of size: "
                  << terrace_size << endl << endl;
 
-        if (!instance.opts.terrace_file().empty())
+        const auto& terrace_fname = instance.opts.terrace_file();
+        if (!terrace_fname.empty())
         {
-          ofstream fs(instance.opts.terrace_file());
-          terrace_wrapper.print_terrace(fs);
-          LOG_INFO << "Tree terrace (in compressed Newick format) was saved to: "
-              << sysutil_realpath(instance.opts.terrace_file()) << endl << endl;
-
-          // TODO partial prints to multiline newick?
-          // if (terrace_size <= instance.opts.terrace_maxsize)
+          ofstream fs(terrace_fname);
+          if (terrace_size <= instance.opts.terrace_maxsize)
+          {
+            /* small terrace: write all trees, one Newick per line */
+            terrace_wrapper.print_terrace_newick(fs);
+            LOG_INFO << "All " << terrace_size << " trees from the terrace (in Newick format) "
+                "were saved to: " << sysutil_realpath(terrace_fname) << endl << endl;
+          }
+          else
+          {
+            terrace_wrapper.print_terrace(fs);
+            LOG_INFO << "Tree terrace (in compressed Newick format) was saved to: "
+                << sysutil_realpath(terrace_fname) << endl;
+            LOG_INFO << "NOTE: Use --terrace-maxsize to save terraces with up to "
+                "this many trees in plain Newick format." << endl << endl;
+          }
         }
       }
       else
@@ -1439,18 +1856,6 @@ void check_terrace(const RaxmlInstance& instance, const Tree& tree)
 #endif
 }
 
-void save_ml_trees(const Options& opts, const Checkpoint& checkp)
-{
-  NewickStream nw(opts.ml_trees_file(), std::ios::out);
-  for (auto topol: checkp.ml_trees)
-  {
-    Tree ml_tree = checkp.tree;
-    ml_tree.topology(topol.second);
-    postprocess_tree(opts, ml_tree);
-    nw << ml_tree;
-  }
-}
-
 void print_ic_scores(const RaxmlInstance& instance, double loglh)
 {
   const auto& parted_msa = *instance.parted_msa;
@@ -1503,6 +1908,12 @@ void print_final_output(const RaxmlInstance& instance, const Checkpoint& checkp)
 
     LOG_INFO << "\nFinal LogLikelihood: " << FMT_LH(best_loglh) << endl << endl;
 
+    if (checkp.ml_trees.size() > 1)
+    {
+      LOG_INFO << "Unique topologies among " << checkp.ml_trees.size() << " ML trees: " <<
+          checkp.ml_trees.num_unique() << endl << endl;
+    }
+
     print_ic_scores(instance, best_loglh);
   }
 
@@ -1510,8 +1921,6 @@ void print_final_output(const RaxmlInstance& instance, const Checkpoint& checkp)
   {
     if (!opts.ml_trees_file().empty())
     {
-      save_ml_trees(opts, checkp);
-
       LOG_INFO << "\nAll optimized tree(s) saved to: " << sysutil_realpath(opts.ml_trees_file()) << endl;
     }
   }
@@ -1534,8 +1943,6 @@ void print_final_output(const RaxmlInstance& instance, const Checkpoint& checkp)
 
     if (checkp.ml_trees.size() > 1 && !opts.ml_trees_file().empty())
     {
-      save_ml_trees(opts, checkp);
-
       LOG_INFO << "All ML trees saved to: " << sysutil_realpath(opts.ml_trees_file()) << endl;
     }
 
@@ -1602,23 +2009,16 @@ void print_final_output(const RaxmlInstance& instance, const Checkpoint& checkp)
     }
   }
 
+  if (opts.command == Command::rfdist && !opts.rfdist_file().empty())
+  {
+    LOG_INFO << "Pairwise RF distances saved to: " << sysutil_realpath(opts.rfdist_file()) << endl;
+  }
+
   if (opts.command == Command::bootstrap || opts.command == Command::all)
   {
-    // TODO now only master process writes the output, this will have to change with
-    // coarse-grained parallelization scheme (parallel start trees/bootstraps)
+    /* bootstrap trees have been already streamed to the file by CheckpointManager */
     if (!opts.bootstrap_trees_file().empty())
     {
-  //    NewickStream nw(opts.bootstrap_trees_file(), std::ios::out | std::ios::app);
-      NewickStream nw(opts.bootstrap_trees_file(), std::ios::out);
-
-      for (auto topol: checkp.bs_trees)
-      {
-        Tree bs_tree = checkp.tree;
-        bs_tree.topology(topol.second);
-        postprocess_tree(opts, bs_tree);
-        nw << bs_tree;
-      }
-
       LOG_INFO << "Bootstrap trees saved to: " << sysutil_realpath(opts.bootstrap_trees_file()) << endl;
     }
   }
@@ -1660,6 +2060,254 @@ void print_resources(const RaxmlInstance& instance)
       << endl << endl;
 }
 
+/* message tags for the bootstrap farm (see thread_bootstrap_farm) */
+enum BootstrapFarmTag
+{
+  bs_tag_request = 100,
+  bs_tag_result,
+  bs_tag_assign
+};
+
+void bootstrap_farm_coordinator(RaxmlInstance& instance, CheckpointManager& cm)
+{
+  auto const& opts = instance.opts;
+  const size_t bs_offset = cm.checkpoint().num_bs_trees();
+  const size_t num_groups = ParallelContext::num_groups();
+
+  LOG_INFO_TS << "Bootstrap farm: " << num_groups << " rank groups with up to "
+              << opts.bs_farm_ranks << " ranks each." << endl << endl;
+
+  BootstrapScheduler sched(instance.bs_reps.size(), num_groups);
+  map<size_t, pair<double, TreeTopology> > results;
+  vector<bool> idle(num_groups, false);
+  size_t active_groups = num_groups;
+  bool bs_converged = false;
+  vector<char> buf;
+
+  while (active_groups > 0)
+  {
+    /* wait for the next message, unless an idle group waits for a straggler to re-assign:
+     * then check every now and then whether one is due */
+    double straggler_wait = -1.;
+    if (std::find(idle.cbegin(), idle.cend(), true) != idle.cend())
+    {
+      const double straggler_time = sched.straggler_time();
+      if (straggler_time >= 0.)
+        straggler_wait = straggler_time - global_timer().elapsed_seconds();
+    }
+
+    size_t src;
+    int tag;
+    if (ParallelContext::mpi_recv(src, tag, buf, straggler_wait < 0.))
+    {
+      BinaryStream bs(buf.data(), buf.size());
+      auto group_id = bs.get<size_t>();
+
+      if (tag == bs_tag_result)
+      {
+        auto rep = bs.get<size_t>();
+        auto loglh = bs.get<double>();
+        TreeTopology topol;
+        bs >> topol;
+
+        if (sched.complete(group_id, rep, global_timer().elapsed_seconds()))
+          results.emplace(rep, make_pair(loglh, move(topol)));
+      }
+
+      idle.at(group_id) = true;
+
+      /* commit replicates in order, exactly as in the sequential mode */
+      while (sched.commit_ready())
+      {
+        auto rep = sched.commit();
+        auto res = results.find(rep);
+        assert(res != results.end());
+
+        if (!bs_converged)
+        {
+          const size_t bs_num = bs_offset + rep + 1;
+
+          cm.save_bs_tree(res->second.second);
+
+          LOG_INFO_TS << "Bootstrap tree #" << bs_num <<
+                      ", logLikelihood: " << FMT_LH(res->second.first) << endl;
+
+          if (EventLog::enabled())
+          {
+            EventLog::write(LogEvent("replicate")("type", "bs")("num", bs_num)
+                            ("loglh", res->second.first)("mem_peak", sysutil_get_memused()),
+                            true);
+          }
+
+          update_bootstrap_support(instance, cm.checkpoint().tree);
+
+          if (instance.bootstop_checker)
+          {
+            instance.bootstop_checker->add_bootstrap_tree(cm.checkpoint().tree);
+
+            if (bs_num % opts.bootstop_interval == 0 || bs_num == opts.num_bootstraps)
+            {
+              bs_converged = instance.bootstop_checker->converged(rand());
+              if (bs_converged)
+              {
+                LOG_INFO_TS << "Bootstrapping converged after " << bs_num << " replicates." << endl;
+                sched.stop();
+              }
+            }
+          }
+        }
+
+        results.erase(res);
+      }
+    }
+    else
+    {
+      const double max_wait = 0.05;
+      std::this_thread::sleep_for(std::chrono::duration<double>(
+          std::max(0.001, std::min(straggler_wait, max_wait))));
+    }
+
+    /* hand out new (or straggling) replicates to idle groups, release them once done */
+    for (size_t g = 0; g < num_groups; ++g)
+    {
+      if (!idle[g])
+        continue;
+
+      size_t rep = sched.assign(g, global_timer().elapsed_seconds());
+      if (rep != BootstrapScheduler::NONE || sched.exhausted())
+      {
+        ParallelContext::mpi_send(ParallelContext::group_master_rank(g), bs_tag_assign,
+                                  &rep, sizeof(size_t));
+        idle[g] = false;
+        if (rep == BootstrapScheduler::NONE)
+          active_groups--;
+      }
+    }
+  }
+
+  if (sched.num_reassigned() > 0)
+  {
+    LOG_VERB << endl << "Bootstrap farm: " << sched.num_reassigned()
+             << " straggling replicates were re-assigned." << endl;
+  }
+}
+
+void bootstrap_farm_worker(RaxmlInstance& instance)
+{
+  auto const& master_msa = *instance.parted_msa;
+  auto const& opts = instance.opts;
+  const size_t group_id = ParallelContext::group_id();
+  const size_t coord_rank = 0;
+
+  /* checkpoint of the whole run is maintained by coordinator */
+  CheckpointManager worker_cm("");
+  worker_cm.disable();
+
+  vector<char> buf;
+  size_t rep = BootstrapScheduler::NONE;
+
+  if (ParallelContext::group_master())
+    ParallelContext::mpi_send(coord_rank, bs_tag_request, &group_id, sizeof(size_t));
+
+  for (;;)
+  {
+    if (ParallelContext::group_master())
+      ParallelContext::mpi_recv(coord_rank, bs_tag_assign, &rep, sizeof(size_t));
+    ParallelContext::broadcast(&rep, sizeof(size_t));
+
+    if (rep == BootstrapScheduler::NONE)
+      break;
+
+    auto const& bs = instance.bs_reps.at(rep);
+
+    // rebalance sites within the rank group
+    if (ParallelContext::master_thread())
+    {
+      load_bootstrap_weights(instance, bs);
+      balance_load(instance, bootstrap_weights(instance, bs));
+    }
+    ParallelContext::thread_barrier();
+
+    auto const& bs_part_assign = instance.proc_part_assign.at(ParallelContext::proc_id());
+
+    TreeInfo treeinfo(opts, instance.bs_start_trees.at(rep), master_msa, instance.tip_msa_idmap,
+                      bs_part_assign, bootstrap_weights(instance, bs));
+    treeinfo.set_topology_constraint(instance.constraint_tree);
+
+    Optimizer optimizer(opts);
+    optimizer.terrace_signature(instance.terrace_sig.get());
+    auto loglh = optimizer.optimize_topology(treeinfo, worker_cm);
+    worker_cm.reset_search_state();
+
+    if (ParallelContext::group_master())
+    {
+      auto topol = treeinfo.tree().topology();
+
+      buf.resize(4 * sizeof(size_t) + sizeof(double) + topol.edges.size() * sizeof(TreeBranch) +
+                 topol.brlens.size() * sizeof(size_t));
+      for (const auto& b: topol.brlens)
+        buf.resize(buf.size() + b.size() * sizeof(double));
+
+      BinaryStream bs(buf.data(), buf.size());
+      bs << group_id << rep << loglh << topol;
+
+      ParallelContext::mpi_send(coord_rank, bs_tag_result, buf.data(), bs.pos());
+    }
+  }
+}
+
+/* MPI master-worker mode for bootstrapping: rank 0 coordinates, all other ranks are split into
+ * groups which pull replicates from the coordinator and infer them independently */
+void thread_bootstrap_farm(RaxmlInstance& instance, CheckpointManager& cm)
+{
+  ParallelContext::split_rank_groups(instance.opts.bs_farm_ranks);
+
+  if (ParallelContext::coordinator())
+  {
+    if (ParallelContext::master_thread())
+      bootstrap_farm_coordinator(instance, cm);
+
+    /* coordinator is single-threaded: other threads of its rank sleep until it is done */
+    ParallelContext::thread_sleep_barrier();
+  }
+  else
+    bootstrap_farm_worker(instance);
+
+  ParallelContext::join_rank_groups();
+}
+
+static void log_phase_event(const char * type, const char * phase)
+{
+  if (EventLog::enabled())
+  {
+    EventLog::write(LogEvent(type)("phase", phase)("mem_peak", sysutil_get_memused()), true);
+  }
+}
+
+/* replicate completion + load imbalance, must be called by all threads of the rank */
+static void log_replicate_event(const char * type, size_t num, double loglh, double start_time,
+                                double start_wait)
+{
+  if (!EventLog::enabled())
+    return;
+
+  /* time each thread spent waiting for the others during this replicate */
+  double wait_min, wait_max, wait_sum;
+  wait_min = wait_max = wait_sum = ParallelContext::barrier_wait_time() - start_wait;
+  ParallelContext::thread_reduce(&wait_min, 1, PLLMOD_COMMON_REDUCE_MIN);
+  ParallelContext::thread_reduce(&wait_max, 1, PLLMOD_COMMON_REDUCE_MAX);
+  ParallelContext::thread_reduce(&wait_sum, 1, PLLMOD_COMMON_REDUCE_SUM);
+
+  const double duration = global_timer().elapsed_seconds() - start_time;
+  const size_t num_threads = ParallelContext::num_threads();
+
+  EventLog::write(LogEvent("thread_imbalance")("type", type)("num", num)
+                  ("threads", num_threads)("duration", duration)("wait_min", wait_min)
+                  ("wait_max", wait_max)("wait_avg", wait_sum / num_threads));
+  EventLog::write(LogEvent("replicate")("type", type)("num", num)("loglh", loglh)
+                  ("duration", duration)("mem_peak", sysutil_get_memused()), true);
+}
+
 void thread_main(RaxmlInstance& instance, CheckpointManager& cm)
 {
   unique_ptr<TreeInfo> treeinfo;
@@ -1675,6 +2323,8 @@ void thread_main(RaxmlInstance& instance, CheckpointManager& cm)
   /* get partitions assigned to the current thread */
   auto const& part_assign = instance.proc_part_assign.at(ParallelContext::proc_id());
 
+  size_t terrace_skips = 0;
+
   bool use_ckp_tree = true;
   if ((opts.command == Command::search || opts.command == Command::all ||
       opts.command == Command::evaluate ) && !instance.start_trees.empty())
@@ -1691,6 +2341,9 @@ void thread_main(RaxmlInstance& instance, CheckpointManager& cm)
           " distinct starting trees" << endl << endl;
     }
 
+    const char * phase = opts.command == Command::evaluate ? "evaluate" : "ml_search";
+    log_phase_event("phase_start", phase);
+
     size_t start_tree_num = cm.checkpoint().ml_trees.size();
     use_ckp_tree = use_ckp_tree && cm.checkpoint().search_state.step != CheckpointStep::start;
     for (const auto& tree: instance.start_trees)
@@ -1699,6 +2352,12 @@ void thread_main(RaxmlInstance& instance, CheckpointManager& cm)
 
       start_tree_num++;
 
+      const double rep_start_time = global_timer().elapsed_seconds();
+      const double rep_start_wait = ParallelContext::barrier_wait_time();
+
+      // free the old TreeInfo first, so that two of them never coexist in memory
+      treeinfo.reset();
+
       if (use_ckp_tree)
       {
         // restore search state from checkpoint (tree + model params)
@@ -1740,16 +2399,23 @@ void thread_main(RaxmlInstance& instance, CheckpointManager& cm)
       }
       else
       {
+        optimizer.terrace_signature(instance.terrace_sig.get());
         optimizer.optimize_topology(*treeinfo, cm);
+        terrace_skips += optimizer.terrace_skips();
         LOG_PROGR << endl;
         LOG_INFO_TS << "ML tree search #" << start_tree_num <<
             ", logLikelihood: " << FMT_LH(cm.checkpoint().loglh()) << endl;
         LOG_PROGR << endl;
       }
 
+      log_replicate_event("ml", start_tree_num, cm.checkpoint().loglh(), rep_start_time,
+                          rep_start_wait);
+
       cm.save_ml_tree();
       cm.reset_search_state();
     }
+
+    log_phase_event("phase_end", phase);
   }
 
   ParallelContext::thread_barrier();
@@ -1765,10 +2431,36 @@ void thread_main(RaxmlInstance& instance, CheckpointManager& cm)
 
     LOG_INFO_TS << "Starting bootstrapping analysis with " << opts.num_bootstraps
              << " replicates." << endl << endl;
+
+    log_phase_event("phase_start", "bootstrap");
+  }
+
+  /* prepare for branch support computation, and restore state from previous run if needed */
+  if (ParallelContext::master_thread())
+  {
+    if (opts.command == Command::all && ParallelContext::master())
+    {
+      auto& checkp = cm.checkpoint();
+      Tree ref_tree = checkp.tree;
+      ref_tree.topology(checkp.ml_trees.best_topology());
+
+      init_bootstrap_support(instance, ref_tree);
+    }
+
+    load_checkpoint_bootstrap_trees(instance, cm.checkpoint());
+  }
+  ParallelContext::thread_barrier();
+
+  if (opts.bs_farm_ranks > 0 && !instance.bs_reps.empty())
+  {
+    thread_bootstrap_farm(instance, cm);
+    log_phase_event("phase_end", "bootstrap");
+    ParallelContext::thread_barrier();
+    return;
   }
 
   /* infer bootstrap trees if needed */
-  size_t bs_num = cm.checkpoint().bs_trees.size();
+  size_t bs_num = cm.checkpoint().num_bs_trees();
   auto bs_start_tree = instance.bs_start_trees.cbegin();
   use_ckp_tree = use_ckp_tree && cm.checkpoint().search_state.step != CheckpointStep::start;
   bool bs_converged = false;
@@ -1776,27 +2468,35 @@ void thread_main(RaxmlInstance& instance, CheckpointManager& cm)
   {
     ++bs_num;
 
+    const double rep_start_time = global_timer().elapsed_seconds();
+    const double rep_start_wait = ParallelContext::barrier_wait_time();
+
     // rebalance sites
     if (ParallelContext::master_thread())
     {
-      balance_load(instance, bs.site_weights);
+      load_bootstrap_weights(instance, bs);
+      balance_load(instance, bootstrap_weights(instance, bs));
     }
     ParallelContext::thread_barrier();
 
     auto const& bs_part_assign = instance.proc_part_assign.at(ParallelContext::proc_id());
+    auto const& bs_weights = bootstrap_weights(instance, bs);
+
+    // free the old TreeInfo first, so that two of them never coexist in memory
+    treeinfo.reset();
 
     if (use_ckp_tree)
     {
       // restore search state from checkpoint (tree + model params)
       treeinfo.reset(new TreeInfo(opts, cm.checkpoint().tree, master_msa, instance.tip_msa_idmap,
-                                  bs_part_assign, bs.site_weights));
+                                  bs_part_assign, bs_weights));
       assign_models(*treeinfo, cm.checkpoint());
       use_ckp_tree = false;
     }
     else
     {
       treeinfo.reset(new TreeInfo(opts, *bs_start_tree, master_msa, instance.tip_msa_idmap,
-                                  bs_part_assign, bs.site_weights));
+                                  bs_part_assign, bs_weights));
     }
 
     treeinfo->set_topology_constraint(instance.constraint_tree);
@@ -1812,17 +2512,24 @@ void thread_main(RaxmlInstance& instance, CheckpointManager& cm)
 //    LOG_INFO << "\n\nTotal BS sites: " << sumw << endl;
 
     Optimizer optimizer(opts);
+    optimizer.terrace_signature(instance.terrace_sig.get());
     optimizer.optimize_topology(*treeinfo, cm);
+    terrace_skips += optimizer.terrace_skips();
 
     LOG_PROGR << endl;
     LOG_INFO_TS << "Bootstrap tree #" << bs_num <<
                 ", logLikelihood: " << FMT_LH(cm.checkpoint().loglh()) << endl;
     LOG_PROGR << endl;
 
+    log_replicate_event("bs", bs_num, cm.checkpoint().loglh(), rep_start_time, rep_start_wait);
+
     cm.save_bs_tree();
     cm.reset_search_state();
     ++bs_start_tree;
 
+    if (ParallelContext::master())
+      update_bootstrap_support(instance, cm.checkpoint().tree);
+
     /* check bootstrapping convergence */
     if (instance.bootstop_checker && ParallelContext::master_thread())
     {
@@ -1844,13 +2551,22 @@ void thread_main(RaxmlInstance& instance, CheckpointManager& cm)
 
   assert(bs_start_tree == instance.bs_start_trees.cend());
 
+  if (!instance.bs_reps.empty())
+    log_phase_event("phase_end", "bootstrap");
+
+  if (instance.terrace_sig && opts.command != Command::evaluate)
+  {
+    LOG_INFO << endl << "Terrace-aware search: " << terrace_skips << " SPR rounds ended on "
+        "an already optimized terrace, branch length optimization was skipped." << endl;
+  }
+
   ParallelContext::thread_barrier();
 }
 
-void master_main(RaxmlInstance& instance, CheckpointManager& cm)
+/* NB: must be called before the worker threads are started, since MSA parser and check_msa()
+ * run multi-threaded on their own */
+void master_load_msa(RaxmlInstance& instance)
 {
-  auto const& opts = instance.opts;
-
   /* if resuming from a checkpoint, use binary MSA (if exists) */
   if (!instance.opts.redo_mode &&
       sysutil_file_exists(instance.opts.checkp_file()) &&
@@ -1861,7 +2577,16 @@ void master_main(RaxmlInstance& instance, CheckpointManager& cm)
     instance.opts.msa_format = FileFormat::binary;
   }
 
+  log_phase_event("phase_start", "load_msa");
   load_parted_msa(instance);
+  assert(instance.parted_msa);
+  log_phase_event("phase_end", "load_msa");
+}
+
+void master_main(RaxmlInstance& instance, CheckpointManager& cm)
+{
+  auto const& opts = instance.opts;
+
   assert(instance.parted_msa);
   auto& parted_msa = *instance.parted_msa;
 
@@ -1894,7 +2619,9 @@ void master_main(RaxmlInstance& instance, CheckpointManager& cm)
         instance.opts.start_tree_file().empty())
     {
       /* only master MPI rank generates starting trees (doesn't work with constrainted search) */
+      log_phase_event("phase_start", "start_trees");
       build_start_trees(instance, cm.checkpoint().ml_trees.size());
+      log_phase_event("phase_end", "start_trees");
       ParallelContext::mpi_barrier();
     }
     else
@@ -1915,6 +2642,9 @@ void master_main(RaxmlInstance& instance, CheckpointManager& cm)
   /* run load balancing algorithm */
   balance_load(instance);
 
+  /* check if we fit into the memory limit, and adjust settings if needed */
+  check_memory_budget(instance, cm.checkpoint());
+
   // TEMP WORKAROUND: here we reset random seed once again to make sure that BS replicates
   // are not affected by the number of ML search starting trees that has been generated before
   srand(instance.opts.random_seed);
@@ -1925,18 +2655,40 @@ void master_main(RaxmlInstance& instance, CheckpointManager& cm)
   if (ParallelContext::master_rank())
     instance.opts.remove_result_files();
 
+  /* ML and bootstrap trees are written to the output files as soon as they are inferred */
+  {
+    const bool save_ml_trees = opts.command == Command::evaluate ||
+        ((opts.command == Command::search || opts.command == Command::all) &&
+         opts.num_searches > 1);
+    const bool save_bs_trees = opts.command == Command::bootstrap ||
+                               opts.command == Command::all;
+
+    /* trees only need to be post-processed (and thus copied) if they must be re-rooted */
+    TreeOutputCallback prepare_cb = nullptr;
+    if (!opts.outgroup_taxa.empty())
+      prepare_cb = [&opts](Tree& tree) { postprocess_tree(opts, tree); };
+
+    cm.open_tree_files(save_ml_trees ? opts.ml_trees_file() : "",
+                       save_bs_trees ? opts.bootstrap_trees_file() : "",
+                       prepare_cb);
+  }
+
+  /* trees on a terrace have identical likelihood, so SPR search can skip them */
+  if (opts.brlen_linkage == PLLMOD_COMMON_BRLEN_UNLINKED && parted_msa.part_count() > 1)
+  {
+    instance.terrace_sig.reset(new TerraceSignature(parted_msa, instance.tip_msa_idmap));
+    if (!instance.terrace_sig->informative())
+      instance.terrace_sig.reset();
+  }
+
   thread_main(instance, cm);
 
+  cm.close_tree_files();
+
   if (ParallelContext::master_rank())
   {
     if (opts.command == Command::all)
-    {
-      auto& checkp = cm.checkpoint();
-      Tree tree = checkp.tree;
-      tree.topology(checkp.ml_trees.best_topology());
-
-      draw_bootstrap_support(instance, tree, checkp.bs_trees);
-    }
+      calc_bootstrap_support(instance);
 
     assert(cm.checkpoint().models.size() == parted_msa.part_count());
     for (size_t p = 0; p < parted_msa.part_count(); ++p)
@@ -1976,6 +2728,8 @@ int internal_main(int argc, char** argv, void* comm)
     return clean_exit(EXIT_FAILURE);
   }
 
+  MemoryBudget::limit(opts.mem_limit);
+
   /* handle trivial commands first */
   switch (opts.command)
   {
@@ -1995,6 +2749,7 @@ int internal_main(int argc, char** argv, void* comm)
     case Command::support:
     case Command::start:
     case Command::terrace:
+    case Command::rfdist:
       if (!opts.redo_mode && opts.result_files_exist())
       {
         LOG_ERROR << endl << "ERROR: Result files for the run with prefix `" <<
@@ -2021,6 +2776,14 @@ int internal_main(int argc, char** argv, void* comm)
     auto mode = !instance.opts.redo_mode && sysutil_file_exists(instance.opts.checkp_file()) ?
         ios::app : ios::out;
     logger().set_log_filename(opts.log_file(), mode);
+
+    if (opts.events_mode && !opts.events_file().empty())
+    {
+      EventLog::open(opts.events_file(), mode);
+      EventLog::write(LogEvent("run_start")("version", RAXML_VERSION)("cmdline", opts.cmdline)
+                      ("threads", opts.num_threads)("ranks", opts.num_ranks)
+                      ("seed", opts.random_seed), true);
+    }
   }
 
   print_banner();
@@ -2073,27 +2836,57 @@ int internal_main(int argc, char** argv, void* comm)
       case Command::bootstrap:
       case Command::all:
       {
-        /* init load balancer */
-        switch(opts.load_balance_method)
+        init_load_balancer(instance);
+
+        if (opts.trace_mode && !opts.trace_file().empty())
         {
-          case LoadBalancing::naive:
-            instance.load_balancer.reset(new SimpleLoadBalancer());
-            break;
-          case LoadBalancing::kassian:
-            instance.load_balancer.reset(new KassianLoadBalancer());
-            break;
-          case LoadBalancing::benoit:
-            instance.load_balancer.reset(new BenoitLoadBalancer());
-            break;
-          default:
-            assert(0);
+          /* start the clock at (roughly) the same time on all ranks */
+          ParallelContext::mpi_barrier();
+          Tracer::enable(opts.num_threads, RAXML_TRACE_BUFSIZE);
         }
 
+        if (opts.stats_mode)
+          HotPathStats::enable(opts.num_threads);
+
+        master_load_msa(instance);
+
         ParallelContext::init_pthreads(opts, std::bind(thread_main,
                                                        std::ref(instance),
                                                        std::ref(cm)));
 
         master_main(instance, cm);
+
+        /* worker threads must not touch trace buffers or counters while they are exported */
+        if (Tracer::enabled() || HotPathStats::enabled())
+          ParallelContext::join_threads();
+
+        if (HotPathStats::enabled())
+        {
+          auto const& parted_msa = *instance.parted_msa;
+          auto totals = HotPathStats::aggregate(parted_msa.part_count());
+
+          NameList part_names;
+          for (const auto& pinfo: parted_msa.part_list())
+            part_names.push_back(pinfo.name());
+
+          LOG_INFO << hotpath_stats_report(totals, part_names) << endl;
+        }
+
+        if (Tracer::enabled())
+        {
+          /* every rank writes its own trace file, so nothing has to be sent over MPI */
+          const auto num_ranks = ParallelContext::num_world_ranks();
+          Tracer::export_json(Tracer::rank_fname(opts.trace_file(),
+                                                 ParallelContext::world_rank_id()));
+
+          LOG_INFO << "Execution trace saved to: " << sysutil_realpath(opts.trace_file()) << endl;
+          if (num_ranks > 1)
+          {
+            LOG_INFO << "NOTE: Traces of MPI ranks 1-" << num_ranks - 1 << " were saved to: "
+                     << Tracer::rank_fname(opts.trace_file(), 1) << " etc." << endl;
+          }
+          LOG_INFO << endl;
+        }
         break;
       }
       case Command::support:
@@ -2102,6 +2895,12 @@ int internal_main(int argc, char** argv, void* comm)
       case Command::bsconverge:
         command_bootstop(instance);
         break;
+      case Command::rfdist:
+        command_rfdist(instance);
+        break;
+      case Command::bench:
+        command_bench(instance);
+        break;
 #ifdef _RAXML_TERRAPHAST
       case Command::terrace:
       {
@@ -2169,9 +2968,20 @@ int internal_main(int argc, char** argv, void* comm)
   catch(exception& e)
   {
     LOG_ERROR << endl << "ERROR: " << e.what() << endl << endl;
+    if (EventLog::enabled())
+      EventLog::write(LogEvent("error")("message", e.what()));
     retval = EXIT_FAILURE;
   }
 
+  if (EventLog::enabled())
+  {
+    EventLog::write(LogEvent("run_end")("success", retval == EXIT_SUCCESS)
+                    ("elapsed", global_timer().elapsed_seconds())
+                    ("mem_peak", sysutil_get_memused())
+                    ("mem_accounted_peak", MemoryBudget::peak()));
+    EventLog::close();
+  }
+
   return clean_exit(retval);
 }
 
@@ -1,6 +1,7 @@
 #include <cpuid.h>
 #include <sys/time.h>
 #include <sys/resource.h>
+#include <sys/stat.h>
 #include <stdarg.h>
 #include <limits.h>
 
@@ -277,6 +278,21 @@ bool sysutil_file_exists(const std::string& fname, int access_mode)
   return access(fname.c_str(), access_mode) == 0;
 }
 
+size_t sysutil_file_size(const std::string& fname)
+{
+  struct stat st;
+  if (stat(fname.c_str(), &st) != 0)
+    throw ios_base::failure("Can't access file: " + fname);
+
+  return st.st_size;
+}
+
+void sysutil_truncate_file(const std::string& fname, size_t size)
+{
+  if (truncate(fname.c_str(), size) != 0)
+    throw ios_base::failure("Can't truncate file: " + fname);
+}
+
 const SystemTimer& global_timer()
 {
   return systimer;
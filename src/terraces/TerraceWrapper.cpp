@@ -79,24 +79,24 @@ TerraceWrapper::TerraceWrapper (const PartitionedMSA& parted_msa, const Tree& tr
   _supertree = create_supertree_data(terra_tree, _bm);
 }
 
-std::uint64_t TerraceWrapper::terrace_size()
+std::uint64_t TerraceWrapper::terrace_size() const
 {
   return count_terrace(_supertree);
 }
 
-void TerraceWrapper::print_terrace_newick(std::ostream& output)
+void TerraceWrapper::print_terrace_newick(std::ostream& output) const
 {
   auto result = terraces::print_terrace(_supertree, _names, output);
   RAXML_UNUSED(result);
 }
 
-void TerraceWrapper::print_terrace_compressed(std::ostream& output)
+void TerraceWrapper::print_terrace_compressed(std::ostream& output) const
 {
   auto result = terraces::print_terrace_compressed(_supertree, _names, output);
   RAXML_UNUSED(result);
 }
 
-void TerraceWrapper::print_terrace(std::ostream& output)
+void TerraceWrapper::print_terrace(std::ostream& output) const
 {
   return print_terrace_compressed(output);
 }
@@ -13,10 +13,10 @@ class TerraceWrapper
 public:
   TerraceWrapper (const PartitionedMSA& part_msa, const Tree& tree);
 
-  std::uint64_t terrace_size();
-  void print_terrace_newick(std::ostream& output);
-  void print_terrace_compressed(std::ostream& output);
-  void print_terrace(std::ostream& output);
+  std::uint64_t terrace_size() const;
+  void print_terrace_newick(std::ostream& output) const;
+  void print_terrace_compressed(std::ostream& output) const;
+  void print_terrace(std::ostream& output) const;
 
 private:
   terraces::bitmatrix _bm;
@@ -32,7 +32,9 @@ enum class Command
   terrace,
   check,
   parse,
-  start
+  start,
+  rfdist,
+  bench
 };
 
 enum class FileFormat
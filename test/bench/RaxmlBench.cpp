@@ -0,0 +1,284 @@
+/*
+ * raxml-bench: end-to-end performance benchmark on a fixed corpus of synthetic alignments.
+ *
+ * Every dataset is generated from a fixed seed, so results are comparable between releases.
+ * Each pipeline stage is timed separately, and the results (min/median over repetitions)
+ * are written as JSON.
+ *
+ * Usage: raxml-bench [-o RESULTS.json] [-r REPETITIONS] [-d DATASET] [-w WORKDIR]
+ */
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+
+#include "src/version.h"
+#include "src/common.h"
+#include "src/PartitionedMSA.hpp"
+#include "src/Tree.hpp"
+#include "src/TreeInfo.hpp"
+#include "src/io/file_io.hpp"
+#include "src/loadbalance/LoadBalancer.hpp"
+#include "src/bootstrap/BootstrapTree.hpp"
+#include "src/bootstrap/BootstopCheck.hpp"
+#include "src/autotune/KernelBenchmark.hpp"
+
+using namespace std;
+
+struct BenchDataset
+{
+  string name;
+  size_t taxa;
+  size_t part_count;
+  size_t part_sites;
+  size_t states;
+  double gap_rate;
+  string model;
+};
+
+/* NB: do not change existing entries, otherwise results won't be comparable with older runs */
+static const vector<BenchDataset> bench_corpus =
+{
+  {"dna",          100,   1, 20000,  4, 0.,  "GTR+G"},
+  {"dna_taxa",     500,   1,  2000,  4, 0.,  "GTR+G"},
+  {"dna_parts",     50, 100,   500,  4, 0.,  "GTR+G"},
+  {"dna_gappy",    100,   1, 20000,  4, 0.5, "GTR+G"},
+  {"aa",            50,   1,  5000, 20, 0.,  "LG+G"},
+  {"multistate",    50,   1,  5000,  8, 0.,  "MULTI8_MK+G"}
+};
+
+static const unsigned int BENCH_SEED = 12345;
+static const size_t BENCH_BS_TREES = 100;
+
+typedef map<string, vector<double>> StageTimings;
+
+class StageTimer
+{
+public:
+  StageTimer(StageTimings& timings, const string& stage) :
+    _timings(timings), _stage(stage), _start(sysutil_gettime()) {}
+  ~StageTimer() { _timings[_stage].push_back(sysutil_gettime() - _start); }
+private:
+  StageTimings& _timings;
+  string _stage;
+  double _start;
+};
+
+static Options bench_options(const BenchDataset& ds)
+{
+  Options opts;
+  opts.simd_arch = sysutil_simd_autodetect();
+  opts.use_tip_inner = false;
+  opts.use_repeats = true;
+  opts.brlen_linkage = ds.part_count > 1 ? PLLMOD_COMMON_BRLEN_SCALED :
+                                           PLLMOD_COMMON_BRLEN_LINKED;
+  return opts;
+}
+
+static void run_pipeline(const BenchDataset& ds, const string& workdir, StageTimings& timings)
+{
+  const string phylip_fname = workdir + "/raxml-bench." + ds.name + ".phy";
+  const string rba_fname = workdir + "/raxml-bench." + ds.name + ".rba";
+  const Options opts = bench_options(ds);
+
+  /* input alignment (not timed) */
+  {
+    PhylipStream ps(phylip_fname);
+    ps << random_msa(ds.taxa, ds.part_count * ds.part_sites, ds.states, ds.gap_rate, BENCH_SEED);
+  }
+
+  MSA msa;
+  {
+    StageTimer t(timings, "msa_load");
+    msa = msa_load_from_file(phylip_fname, FileFormat::phylip);
+  }
+
+  PartitionedMSA parted_msa;
+  for (size_t p = 0; p < ds.part_count; ++p)
+  {
+    const auto start = p * ds.part_sites + 1;
+    const auto end = start + ds.part_sites - 1;
+    parted_msa.emplace_part_info("p" + to_string(p+1), DataType::autodetect, ds.model,
+                                 to_string(start) + "-" + to_string(end));
+  }
+
+  {
+    StageTimer t(timings, "msa_split");
+    parted_msa.full_msa(std::move(msa));
+    parted_msa.split_msa();
+  }
+
+  {
+    StageTimer t(timings, "pattern_compression");
+    parted_msa.compress_patterns();
+  }
+
+  parted_msa.set_model_empirical_params();
+
+  {
+    StageTimer t(timings, "rba_roundtrip");
+    {
+      RBAStream bs(rba_fname);
+      bs << parted_msa;
+    }
+    PartitionedMSA rba_msa;
+    RBAStream bs(rba_fname);
+    bs >> rba_msa;
+  }
+
+  Tree tree;
+  {
+    StageTimer t(timings, "parsimony_tree");
+    unsigned int score;
+    tree = Tree::buildParsimony(parted_msa, BENCH_SEED, opts.simd_arch | PLL_ATTRIB_PATTERN_TIP,
+                                &score);
+  }
+  tree.fix_missing_brlens();
+  tree.reset_tip_ids(parted_msa.taxon_index());
+
+  {
+    /* sequential run: all sites go to a single thread */
+    PartitionAssignment part_sizes;
+    size_t i = 0;
+    for (auto const& pinfo: parted_msa.part_list())
+    {
+      part_sizes.assign_sites(i, 0, pinfo.msa().length(), pinfo.model().clv_entry_size());
+      ++i;
+    }
+    BenoitLoadBalancer balancer;
+    auto part_assign = balancer.get_all_assignments(part_sizes, 1);
+
+    TreeInfo treeinfo(opts, tree, parted_msa, IDVector(), part_assign.at(0));
+    double loglh = treeinfo.optimize_branches(opts.lh_epsilon, 1);
+
+    /* same parameters as the first fast SPR round in the tree search */
+    spr_round_params spr_params;
+    spr_params.thorough = 0;
+    spr_params.radius_min = 1;
+    spr_params.radius_max = 5;
+    spr_params.ntopol_keep = 20;
+    spr_params.subtree_cutoff = opts.spr_cutoff;
+    spr_params.reset_cutoff_info(loglh);
+
+    StageTimer t(timings, "spr_round");
+    treeinfo.spr_round(spr_params);
+  }
+
+  /* replicate trees for support and bootstopping (not timed) */
+  vector<Tree> bs_trees;
+  for (size_t r = 0; r < BENCH_BS_TREES; ++r)
+  {
+    bs_trees.emplace_back(Tree::buildRandom(parted_msa.taxon_names(), BENCH_SEED + r));
+    bs_trees.back().reset_tip_ids(parted_msa.taxon_index());
+  }
+
+  {
+    StageTimer t(timings, "bootstrap_support");
+    BootstrapTree support_tree(tree);
+    for (const auto& bs_tree: bs_trees)
+      support_tree.add_bootstrap_tree(bs_tree);
+    support_tree.calc_support();
+  }
+
+  {
+    StageTimer t(timings, "bootstopping");
+    BootstopCheckMRE bootstop(BENCH_BS_TREES, RAXML_BOOTSTOP_CUTOFF, RAXML_BOOTSTOP_PERMUTES);
+    for (const auto& bs_tree: bs_trees)
+      bootstop.add_bootstrap_tree(bs_tree);
+    bootstop.converged(BENCH_SEED);
+  }
+
+  std::remove(phylip_fname.c_str());
+  std::remove(rba_fname.c_str());
+}
+
+static void print_usage()
+{
+  cerr << "Usage: raxml-bench [-o RESULTS.json] [-r REPETITIONS] [-d DATASET] [-w WORKDIR]\n";
+  cerr << "Datasets:";
+  for (const auto& ds: bench_corpus)
+    cerr << " " << ds.name;
+  cerr << endl;
+}
+
+int main(int argc, char** argv)
+{
+  string results_fname = "raxml-bench.json";
+  string dataset;
+  string workdir = ".";
+  size_t reps = 3;
+
+  for (int i = 1; i < argc; ++i)
+  {
+    const string arg = argv[i];
+    if (i + 1 < argc && arg == "-o")
+      results_fname = argv[++i];
+    else if (i + 1 < argc && arg == "-r")
+      reps = std::max(1, atoi(argv[++i]));
+    else if (i + 1 < argc && arg == "-d")
+      dataset = argv[++i];
+    else if (i + 1 < argc && arg == "-w")
+      workdir = argv[++i];
+    else
+    {
+      print_usage();
+      return EXIT_FAILURE;
+    }
+  }
+
+  ofstream fs(results_fname);
+  if (!fs)
+  {
+    cerr << "ERROR: Unable to open results file: " << results_fname << endl;
+    return EXIT_FAILURE;
+  }
+
+  fs << "{\"version\":\"" << RAXML_VERSION << "\",\"simd\":" << sysutil_simd_autodetect() <<
+        ",\"repetitions\":" << reps << ",\"results\":[";
+
+  bool first = true;
+  for (const auto& ds: bench_corpus)
+  {
+    if (!dataset.empty() && ds.name != dataset)
+      continue;
+
+    cout << "Dataset: " << ds.name << " (" << ds.taxa << " taxa, " <<
+        ds.part_count * ds.part_sites << " sites, " << ds.part_count << " partitions)" << endl;
+
+    StageTimings timings;
+    try
+    {
+      for (size_t r = 0; r < reps; ++r)
+        run_pipeline(ds, workdir, timings);
+    }
+    catch (exception& e)
+    {
+      cerr << "ERROR: " << e.what() << endl;
+      return EXIT_FAILURE;
+    }
+
+    for (auto& it: timings)
+    {
+      auto& t = it.second;
+      sort(t.begin(), t.end());
+      const double min_time = t.front();
+      const double median_time = t[t.size() / 2];
+
+      cout << "  " << left << setw(22) << it.first << right << fixed << setprecision(4) <<
+          setw(10) << median_time << " s" << endl;
+
+      fs << (first ? "" : ",") << "\n{\"dataset\":\"" << ds.name << "\",\"stage\":\"" <<
+          it.first << "\",\"taxa\":" << ds.taxa << ",\"sites\":" << ds.part_count * ds.part_sites <<
+          ",\"partitions\":" << ds.part_count << ",\"states\":" << ds.states <<
+          ",\"min_sec\":" << min_time << ",\"median_sec\":" << median_time << "}";
+      first = false;
+    }
+    cout << endl;
+  }
+
+  fs << "\n]}" << endl;
+
+  cout << "Results saved to: " << results_fname << endl;
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,91 @@
+#include "RaxmlTest.hpp"
+
+#include "src/bootstrap/BootstrapScheduler.hpp"
+
+using namespace std;
+
+static const size_t NONE = BootstrapScheduler::NONE;
+
+TEST(BootstrapSchedulerTest, in_order_commit)
+{
+  BootstrapScheduler sched(4, 2);
+
+  EXPECT_EQ(0, sched.assign(0, 0.));
+  EXPECT_EQ(1, sched.assign(1, 0.));
+
+  // replicate 1 finishes first, but can not be committed before replicate 0
+  EXPECT_TRUE(sched.complete(1, 1, 1.));
+  EXPECT_FALSE(sched.commit_ready());
+  EXPECT_EQ(2, sched.assign(1, 1.));
+
+  EXPECT_TRUE(sched.complete(0, 0, 2.));
+  ASSERT_TRUE(sched.commit_ready());
+  EXPECT_EQ(0, sched.commit());
+  ASSERT_TRUE(sched.commit_ready());
+  EXPECT_EQ(1, sched.commit());
+  EXPECT_FALSE(sched.commit_ready());
+
+  EXPECT_EQ(3, sched.assign(0, 2.));
+  EXPECT_TRUE(sched.complete(1, 2, 3.));
+  EXPECT_TRUE(sched.complete(0, 3, 3.));
+  EXPECT_EQ(2, sched.commit());
+  EXPECT_EQ(3, sched.commit());
+
+  EXPECT_TRUE(sched.exhausted());
+  EXPECT_EQ(NONE, sched.assign(0, 3.));
+  EXPECT_EQ(4, sched.num_committed());
+  EXPECT_EQ(0, sched.num_reassigned());
+
+  // replicate must be assigned to the worker which reports it
+  EXPECT_ANY_THROW(sched.complete(1, 3, 4.));
+}
+
+TEST(BootstrapSchedulerTest, straggler)
+{
+  BootstrapScheduler sched(3, 2, 2.);
+
+  EXPECT_EQ(0, sched.assign(0, 0.));
+  EXPECT_EQ(1, sched.assign(1, 0.));
+  EXPECT_TRUE(sched.complete(1, 1, 1.));
+  EXPECT_EQ(2, sched.assign(1, 1.));
+  EXPECT_TRUE(sched.complete(1, 2, 2.));
+
+  // average runtime is 1s -> replicate 0 is not a straggler yet
+  EXPECT_EQ(NONE, sched.assign(1, 2.));
+  EXPECT_FALSE(sched.exhausted());
+  EXPECT_DOUBLE_EQ(2., sched.straggler_time());
+
+  // ... but now it is: duplicate it on the idle worker
+  EXPECT_EQ(0, sched.assign(1, 2.5));
+  EXPECT_EQ(1, sched.num_reassigned());
+  EXPECT_LT(sched.straggler_time(), 0.);
+
+  // first result wins, the second one is discarded
+  EXPECT_TRUE(sched.complete(1, 0, 3.));
+  EXPECT_TRUE(sched.exhausted());
+  EXPECT_EQ(0, sched.commit());
+  EXPECT_FALSE(sched.complete(0, 0, 4.));
+  EXPECT_EQ(1, sched.commit());
+  EXPECT_EQ(2, sched.commit());
+  EXPECT_FALSE(sched.commit_ready());
+}
+
+TEST(BootstrapSchedulerTest, stop)
+{
+  BootstrapScheduler sched(10, 3);
+
+  for (size_t w = 0; w < 3; ++w)
+    EXPECT_EQ(w, sched.assign(w, 0.));
+
+  EXPECT_TRUE(sched.complete(0, 0, 1.));
+  EXPECT_EQ(0, sched.commit());
+  sched.stop();
+
+  EXPECT_TRUE(sched.exhausted());
+  EXPECT_EQ(NONE, sched.assign(0, 1.));
+
+  // running replicates can still be reported
+  EXPECT_TRUE(sched.complete(1, 1, 2.));
+  EXPECT_TRUE(sched.complete(2, 2, 2.));
+  EXPECT_EQ(3, sched.num_completed());
+}
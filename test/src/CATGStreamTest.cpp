@@ -0,0 +1,149 @@
+#include "RaxmlTest.hpp"
+
+#include "src/io/file_io.hpp"
+
+using namespace std;
+
+static const string catg_fname = "CATGStreamTest.catg";
+
+static void write_file(const string& fname, const string& text)
+{
+  ofstream fs(fname);
+  fs << text;
+}
+
+static MSA load_catg(const string& fname, size_t num_threads = 1)
+{
+  MSA msa;
+  CATGStream s(fname, num_threads);
+  s >> msa;
+  return msa;
+}
+
+TEST(CATGStreamTest, basic)
+{
+  write_file(catg_fname,
+             "3 2\n"
+             "taxon1 taxon2   taxon3\n"
+             "ACG 0.1,0.2,0.3,0.4 1,0,0,0 0.25,0.25,0.25,0.25\r\n"
+             "TTN 0,0,0,1 1e-3,0,0.5,0.499 .5,0.5,0.,0\n");
+
+  auto msa = load_catg(catg_fname);
+
+  ASSERT_EQ(3, msa.size());
+  ASSERT_EQ(2, msa.length());
+  EXPECT_EQ(4, msa.states());
+  EXPECT_EQ("taxon3", msa.label(2));
+  EXPECT_EQ("AT", msa.at(0));
+  EXPECT_EQ("CT", msa.at(1));
+  EXPECT_EQ("GN", msa.at(2));
+
+  // CATG -> ACGT
+  const auto& p0 = msa.probs(0);
+  EXPECT_DOUBLE_EQ(0.2, p0[0]);
+  EXPECT_DOUBLE_EQ(0.1, p0[1]);
+  EXPECT_DOUBLE_EQ(0.4, p0[2]);
+  EXPECT_DOUBLE_EQ(0.3, p0[3]);
+
+  const auto& p1 = msa.probs(1);
+  EXPECT_EQ(1., p1[1]);
+  EXPECT_DOUBLE_EQ(1e-3, p1[4 + 1]);
+  EXPECT_DOUBLE_EQ(0.499, p1[4 + 2]);
+
+  const auto& p2 = msa.probs(2);
+  EXPECT_EQ(0.5, p2[4 + 0]);
+  EXPECT_EQ(0.5, p2[4 + 1]);
+
+  std::remove(catg_fname.c_str());
+}
+
+TEST(CATGStreamTest, multiline_sites)
+{
+  // sites are not required to be on separate lines
+  write_file(catg_fname,
+             "2 2 t1 t2\n"
+             "AC 1,0\n0,1\n"
+             "CA 0.5,0.5 1,0");
+
+  auto msa = load_catg(catg_fname, 4);
+
+  EXPECT_EQ(2, msa.states());
+  EXPECT_EQ("AC", msa.at(0));
+  EXPECT_EQ("CA", msa.at(1));
+  EXPECT_EQ(0.5, msa.probs(0)[2]);
+  EXPECT_EQ(1., msa.probs(1)[1]);
+  EXPECT_EQ(1., msa.probs(1)[2]);
+
+  std::remove(catg_fname.c_str());
+}
+
+TEST(CATGStreamTest, errors)
+{
+  write_file(catg_fname, "2 1\nt1 t2\nAC 1,0,0,0 1,0,0\n");
+  EXPECT_THROW(load_catg(catg_fname), runtime_error);
+
+  write_file(catg_fname, "2 1\nt1 t2\nACG 1,0,0,0 1,0,0,0\n");
+  EXPECT_THROW(load_catg(catg_fname), runtime_error);
+
+  write_file(catg_fname, "2 1\nt1 t2\nAC 1,0,0,0 1,x,0,0\n");
+  EXPECT_THROW(load_catg(catg_fname), runtime_error);
+
+  write_file(catg_fname, "2 2\nt1 t2\nAC 1,0,0,0 1,0,0,0\n");
+  EXPECT_THROW(load_catg(catg_fname), runtime_error);
+
+  write_file(catg_fname, "0 2\n");
+  EXPECT_THROW(load_catg(catg_fname), runtime_error);
+
+  // too many digits for the strtod() fallback
+  write_file(catg_fname, "2 1\nt1 t2\nAC 1,0,0,0 0." + string(70, '1') + ",0,0,0\n");
+  EXPECT_THROW(load_catg(catg_fname), runtime_error);
+
+  std::remove(catg_fname.c_str());
+}
+
+TEST(CATGStreamTest, parallel)
+{
+  const size_t taxa = 10;
+  const size_t sites = 6000;
+
+  RandomGenerator gen(42);
+  std::uniform_int_distribution<unsigned int> distr(0, 999999);
+
+  ostringstream ss;
+  ss << taxa << " " << sites << "\n";
+  for (size_t j = 0; j < taxa; ++j)
+    ss << "taxon" << j << " ";
+  ss << "\n";
+
+  for (size_t i = 0; i < sites; ++i)
+  {
+    ss << string(taxa, "ACGT"[i % 4]);
+    for (size_t j = 0; j < taxa; ++j)
+    {
+      ss << " ";
+      for (size_t k = 0; k < 4; ++k)
+        ss << (k ? "," : "") << "0." << setw(6) << setfill('0') << distr(gen);
+    }
+    ss << "\n";
+  }
+
+  write_file(catg_fname, ss.str());
+
+  auto msa1 = load_catg(catg_fname, 1);
+  auto msa4 = load_catg(catg_fname, 4);
+
+  ASSERT_EQ(sites, msa4.length());
+  for (size_t j = 0; j < taxa; ++j)
+  {
+    EXPECT_EQ(msa1.at(j), msa4.at(j));
+    EXPECT_EQ(msa1.probs(j), msa4.probs(j));
+  }
+
+  // spot check against the reference parser
+  EXPECT_EQ('T', msa4.at(3)[sites - 1]);
+  auto last_line = ss.str();
+  last_line = last_line.substr(last_line.rfind(' ', last_line.size() - 2) + 1);
+  EXPECT_EQ(stod(last_line.substr(0, 8)), msa4.probs(taxa - 1)[sites * 4 - 3]);
+
+  std::remove(catg_fname.c_str());
+}
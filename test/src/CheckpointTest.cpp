@@ -0,0 +1,88 @@
+#include "RaxmlTest.hpp"
+
+#include <random>
+
+#include "src/Checkpoint.hpp"
+
+using namespace std;
+
+static const NameList taxa = {"a", "b", "c", "d", "e", "f", "g"};
+
+static Checkpoint template_checkpoint(const CheckpointDataInfo& data_info)
+{
+  Checkpoint ckp;
+  ckp.data_info = data_info;
+  ckp.tree = Tree::buildRandom(taxa, 1);
+  ckp.models[0] = Model(DataType::autodetect, "GTR+G");
+  ckp.models[1] = Model(DataType::autodetect, "HKY");
+  return ckp;
+}
+
+TEST(CheckpointTest, resume_random_steps)
+{
+  // buildup
+  const std::string ckp_fname = "resume_test.ckp";
+  CheckpointDataInfo data_info;
+  data_info.taxon_count = taxa.size();
+  data_info.part_count = 2;
+  data_info.hash = 0x1234;
+
+  std::mt19937 gen(42);
+  std::uniform_int_distribution<int> distr_step((int) CheckpointStep::start,
+                                                (int) CheckpointStep::finish);
+
+  for (size_t r = 0; r < 20; ++r)
+  {
+    // "interrupted" run: write checkpoint at a random step
+    {
+      CheckpointManager cm(ckp_fname);
+      auto ckp = template_checkpoint(data_info);
+      ckp.search_state.step = (CheckpointStep) distr_step(gen);
+      ckp.search_state.loglh = -1000. - r;
+      ckp.search_state.iteration = (int) r;
+      ckp.search_state.fast_spr_radius = 5;
+      ckp.tree = Tree::buildRandom(taxa, r + 100);
+      ckp.bs_trees_file.tree_count = r;
+      cm.checkpoint(std::move(ckp));
+      cm.write();
+    }
+
+    // resumed run: read it into a fresh template
+    CheckpointManager cm(ckp_fname);
+    cm.checkpoint(template_checkpoint(data_info));
+    ASSERT_TRUE(cm.read());
+
+    const auto& ckp = cm.checkpoint();
+    auto ref_tree = Tree::buildRandom(taxa, r + 100);
+    const auto topol = ckp.tree.topology();
+    const auto ref_topol = ref_tree.topology();
+
+    // tests
+    EXPECT_EQ(CKP_VERSION, ckp.version);
+    EXPECT_DOUBLE_EQ(-1000. - r, ckp.loglh());
+    EXPECT_EQ((int) r, ckp.search_state.iteration);
+    EXPECT_EQ(5, ckp.search_state.fast_spr_radius);
+    EXPECT_EQ(r, ckp.num_bs_trees());
+    EXPECT_EQ(2, ckp.models.size());
+    ASSERT_EQ(ref_topol.edges.size(), topol.edges.size());
+    for (size_t i = 0; i < topol.edges.size(); ++i)
+    {
+      EXPECT_EQ(ref_topol.edges[i].left_node_id, topol.edges[i].left_node_id);
+      EXPECT_EQ(ref_topol.edges[i].right_node_id, topol.edges[i].right_node_id);
+    }
+  }
+
+  // checkpoint must not be resumed with different data
+  auto other_info = data_info;
+  other_info.hash++;
+  CheckpointManager cm(ckp_fname);
+  cm.checkpoint(template_checkpoint(other_info));
+  EXPECT_THROW(cm.read(), CheckpointMismatchException);
+
+  // ... but can be read without expectations
+  cm.checkpoint(template_checkpoint(CheckpointDataInfo()));
+  EXPECT_TRUE(cm.read());
+  EXPECT_TRUE(cm.checkpoint().data_info == data_info);
+
+  cm.remove();
+}
@@ -201,3 +201,19 @@ TEST(CommandLineParserTest, eval_complex)
   EXPECT_DOUBLE_EQ(0.02, options.lh_epsilon);
 }
 
+
+TEST(CommandLineParserTest, trace)
+{
+  // buildup
+  CommandLineParser parser;
+  Options options;
+
+  string cmd = "raxml-ng --bootstrap --msa data.fa --model GTR --trace";
+  parse_options(cmd, parser, options, false);
+  EXPECT_TRUE(options.trace_mode);
+
+  // wrong: execution trace is not supported for other commands
+  Options options2;
+  cmd = "raxml-ng --evaluate --msa data.fa --model GTR --tree start.tre --trace";
+  parse_options(cmd, parser, options2, true);
+}
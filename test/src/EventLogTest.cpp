@@ -0,0 +1,57 @@
+#include "RaxmlTest.hpp"
+
+#include "src/EventLog.hpp"
+
+using namespace std;
+
+static vector<string> read_lines(const string& fname)
+{
+  vector<string> lines;
+  ifstream fs(fname);
+  string line;
+  while (getline(fs, line))
+    lines.push_back(line);
+  return lines;
+}
+
+TEST(EventLogTest, format)
+{
+  auto json = LogEvent("test")("name", "a \"quoted\"\tname\n")("count", (size_t) 42)
+      ("neg", -1)("loglh", -1234.5)("nan", std::nan(""))("flag", true).str();
+
+  EXPECT_EQ(0, json.find("{\"time\":"));
+  EXPECT_NE(string::npos, json.find(",\"event\":\"test\",\"name\":\"a \\\"quoted\\\"\\tname\\n\""));
+  EXPECT_NE(string::npos, json.find(",\"count\":42,\"neg\":-1,\"loglh\":-1234.5,\"nan\":null,"
+                                    "\"flag\":true}"));
+}
+
+TEST(EventLogTest, buffering)
+{
+  const string fname = "EventLogTest.jsonl";
+
+  EventLog::open(fname);
+  EXPECT_TRUE(EventLog::enabled());
+
+  // frequent events are kept in memory...
+  EventLog::write(LogEvent("loglh")("loglh", -100.));
+  EventLog::write(LogEvent("loglh")("loglh", -90.));
+  EXPECT_TRUE(read_lines(fname).empty());
+
+  // ...until a milestone event is written
+  EventLog::write(LogEvent("checkpoint"), true);
+  auto lines = read_lines(fname);
+  ASSERT_EQ(3, lines.size());
+  EXPECT_NE(string::npos, lines[0].find("\"loglh\":-100"));
+  EXPECT_NE(string::npos, lines[2].find("\"event\":\"checkpoint\""));
+
+  EventLog::write(LogEvent("run_end"));
+  EventLog::close();
+  EXPECT_FALSE(EventLog::enabled());
+  EXPECT_EQ(4, read_lines(fname).size());
+
+  // disabled: events are dropped
+  EventLog::write(LogEvent("ignored"), true);
+  EXPECT_EQ(4, read_lines(fname).size());
+
+  std::remove(fname.c_str());
+}
@@ -0,0 +1,136 @@
+#include "RaxmlTest.hpp"
+
+#include "src/HotPathStats.hpp"
+
+using namespace std;
+
+/* unrooted 4-taxon tree ((t1,t2),(t3,t4)), rooted at the inner branch */
+struct QuartetTree
+{
+  pll_unode_t tips[4];
+  pll_unode_t inner[6];
+
+  QuartetTree() : tips(), inner()
+  {
+    for (unsigned int i = 0; i < 4; ++i)
+    {
+      tips[i].clv_index = tips[i].node_index = tips[i].pmatrix_index = i;
+      tips[i].scaler_index = PLL_SCALE_BUFFER_NONE;
+    }
+
+    for (unsigned int n = 0; n < 2; ++n)
+    {
+      for (unsigned int j = 0; j < 3; ++j)
+      {
+        auto& node = inner[3*n + j];
+        node.clv_index = 4 + n;
+        node.node_index = 4 + 3*n + j;
+        node.scaler_index = n;
+        node.next = &inner[3*n + (j+1) % 3];
+      }
+    }
+
+    link(inner[0], inner[3], 4);
+    link(inner[1], tips[0], 0);
+    link(inner[2], tips[1], 1);
+    link(inner[4], tips[2], 2);
+    link(inner[5], tips[3], 3);
+  }
+
+  static void link(pll_unode_t& a, pll_unode_t& b, unsigned int pmatrix_index)
+  {
+    a.back = &b;
+    b.back = &a;
+    a.pmatrix_index = b.pmatrix_index = pmatrix_index;
+  }
+};
+
+TEST(HotPathStatsTest, count_loglh)
+{
+  QuartetTree tree;
+
+  unsigned int scalers[2][4] = {{0, 1, 0, 0}, {2, 0, 1, 0}};
+  unsigned int * scale_buffer[2] = {scalers[0], scalers[1]};
+
+  unsigned int pernode_ids[6] = {0, 0, 0, 0, 3, 0};
+  unsigned int perscale_ids[2] = {0, 0};
+  pll_repeats_t repeats = pll_repeats_t();
+  repeats.pernode_ids = pernode_ids;
+  repeats.perscale_ids = perscale_ids;
+
+  pll_partition_t partition = pll_partition_t();
+  partition.sites = 4;
+  partition.rate_cats = 4;
+  partition.attributes = PLL_ATTRIB_SITE_REPEATS;
+  partition.scale_buffer = scale_buffer;
+  partition.repeats = &repeats;
+  pll_partition_t * partitions[1] = {&partition};
+
+  char clv_valid[6] = {1, 1, 1, 1, 0, 0};
+  char pmatrix_valid[5] = {0, 0, 0, 0, 0};
+  char * clv_valid_ptr[1] = {clv_valid};
+  char * pmatrix_valid_ptr[1] = {pmatrix_valid};
+
+  pllmod_treeinfo_t treeinfo = pllmod_treeinfo_t();
+  treeinfo.partition_count = 1;
+  treeinfo.root = &tree.inner[0];
+  treeinfo.partitions = partitions;
+  treeinfo.clv_valid = clv_valid_ptr;
+  treeinfo.pmatrix_valid = pmatrix_valid_ptr;
+
+  HotPathStats::enable(1);
+
+  // full traversal: 2 tip-tip CLVs, all 5 p-matrices
+  HotPathStats::count_loglh_begin(treeinfo, false);
+  HotPathStats::count_loglh_end(treeinfo);
+
+  auto pc = HotPathStats::counters(0).at(0);
+  EXPECT_EQ(2, pc.clv_tip_tip);
+  EXPECT_EQ(0, pc.clv_tip_inner);
+  EXPECT_EQ(0, pc.clv_inner_inner);
+  EXPECT_EQ(5, pc.pmatrix_updates);
+  EXPECT_EQ(3, pc.scaled_sites);
+  EXPECT_EQ(8, pc.repeats_sites);
+  EXPECT_EQ(7, pc.repeats_computed);
+
+  // incremental: only the CLV and p-matrices invalidated next to the root are recomputed
+  clv_valid[4] = 1;
+  pmatrix_valid[0] = pmatrix_valid[1] = pmatrix_valid[4] = 1;
+  HotPathStats::count_loglh_begin(treeinfo, true);
+  HotPathStats::count_loglh_end(treeinfo);
+
+  pc = HotPathStats::counters(0).at(0);
+  EXPECT_EQ(3, pc.clv_updates());
+  EXPECT_EQ(7, pc.pmatrix_updates);
+  EXPECT_EQ(5, pc.scaled_sites);
+
+  // optimizer calls are counted at the call site
+  for (size_t i = 0; i < 3; ++i)
+    HotPathStats::RoutineScope scope(OptRoutine::spr_round);
+  {
+    HotPathStats::RoutineScope scope(OptRoutine::brlen);
+  }
+
+  const auto& rc = HotPathStats::routine_counters(0);
+  EXPECT_EQ(3, rc[(size_t) OptRoutine::spr_round].calls);
+  EXPECT_EQ(1, rc[(size_t) OptRoutine::brlen].calls);
+  EXPECT_EQ(0, rc[(size_t) OptRoutine::alpha].calls);
+  EXPECT_GE(rc[(size_t) OptRoutine::spr_round].seconds, 0.);
+
+  auto total = HotPathStats::aggregate(1);
+  ASSERT_EQ(1, total.parts.size());
+  EXPECT_EQ(3, total.parts[0].clv_tip_tip);
+  EXPECT_DOUBLE_EQ(1. / 12., total.parts[0].repeats_hit_rate());
+  EXPECT_EQ(3, total.routines[(size_t) OptRoutine::spr_round].calls);
+
+  auto report = hotpath_stats_report(total, {"p1"});
+  EXPECT_NE(string::npos, report.find("p1"));
+  EXPECT_NE(string::npos, report.find(opt_routine_name(OptRoutine::spr_round)));
+  EXPECT_EQ(string::npos, report.find(opt_routine_name(OptRoutine::alpha)));
+
+  // nothing is counted while disabled
+  HotPathStats::disable();
+  {
+    HotPathStats::RoutineScope scope(OptRoutine::brlen);
+  }
+}
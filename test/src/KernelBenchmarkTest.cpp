@@ -0,0 +1,35 @@
+#include "RaxmlTest.hpp"
+
+#include "src/autotune/KernelBenchmark.hpp"
+
+using namespace std;
+
+TEST(KernelBenchmarkTest, random_msa)
+{
+  auto msa = random_msa(10, 500, 4, 0., 42);
+
+  ASSERT_EQ(10, msa.size());
+  EXPECT_EQ(500, msa.length());
+  EXPECT_EQ("T1", msa.label(0));
+  EXPECT_EQ("T10", msa.label(9));
+  for (const auto& seq: msa)
+    EXPECT_EQ(string::npos, seq.find_first_not_of("ACGT"));
+
+  // same seed -> same alignment
+  auto msa2 = random_msa(10, 500, 4, 0., 42);
+  for (size_t i = 0; i < msa.size(); ++i)
+    EXPECT_EQ(msa[i], msa2[i]);
+
+  // multistate with gaps
+  auto msa3 = random_msa(4, 1000, 8, 0.5, 1);
+  size_t gaps = 0;
+  for (const auto& seq: msa3)
+  {
+    EXPECT_EQ(string::npos, seq.find_first_not_of("01234567-"));
+    gaps += count(seq.begin(), seq.end(), '-');
+  }
+  EXPECT_GT(gaps, 1000);
+  EXPECT_LT(gaps, 3000);
+
+  EXPECT_THROW(random_msa(4, 10, 33, 0., 1), runtime_error);
+}
@@ -161,3 +161,36 @@ TEST(LoadBalanceTest, testLARGE)
     check_assignment_all(part_sizes, 1999);
   }
 }
+
+TEST(LoadBalanceTest, check_assignments)
+{
+  // buildup
+  PartitionAssignment part_sizes;
+  part_sizes.assign_sites(0, 0, 100);
+  part_sizes.assign_sites(1, 0, 50);
+
+  PartitionAssignmentList pa_list(2);
+  pa_list[0].assign_sites(0, 0, 60);
+  pa_list[1].assign_sites(0, 60, 40);
+  pa_list[1].assign_sites(1, 0, 50);
+
+  // tests
+  EXPECT_NO_THROW(check_assignments(part_sizes, pa_list));
+
+  // overlapping ranges
+  auto overlap = pa_list;
+  overlap[0].assign_sites(1, 49, 1);
+  EXPECT_THROW(check_assignments(part_sizes, overlap), std::runtime_error);
+
+  // missing sites
+  PartitionAssignmentList missing(2);
+  missing[0].assign_sites(0, 0, 60);
+  missing[1].assign_sites(0, 61, 39);
+  missing[1].assign_sites(1, 0, 50);
+  EXPECT_THROW(check_assignments(part_sizes, missing), std::runtime_error);
+
+  // unknown partition
+  auto unknown = pa_list;
+  unknown[1].assign_sites(2, 0, 10);
+  EXPECT_THROW(check_assignments(part_sizes, unknown), std::runtime_error);
+}
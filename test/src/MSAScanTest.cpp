@@ -0,0 +1,106 @@
+#include "RaxmlTest.hpp"
+
+#include "src/MSAScan.hpp"
+
+using namespace std;
+
+static PartitionedMSA make_parted_msa(const NameList& names, const vector<string>& seqs,
+                                      const vector<string>& ranges)
+{
+  MSA msa;
+  for (size_t i = 0; i < seqs.size(); ++i)
+    msa.append(seqs[i], names[i]);
+
+  PartitionedMSA parted_msa;
+  for (size_t p = 0; p < ranges.size(); ++p)
+    parted_msa.emplace_part_info("p" + to_string(p), DataType::dna, "GTR", ranges[p]);
+  parted_msa.full_msa(std::move(msa));
+  parted_msa.split_msa();
+
+  return parted_msa;
+}
+
+TEST(MSAScanTest, duplicates)
+{
+  auto parted_msa = make_parted_msa({"t1", "t2", "t3", "t1", "t5", "t6"},
+                                    {"ACGTACGTAC", "ACGTACGTAA", "ACGTACGTAC",
+                                     "CCCCCCCCCC", "ACGTACGTAC", "ACGTACGTAA"},
+                                    {"1-10"});
+
+  for (size_t threads: {1, 4})
+  {
+    auto scan = scan_msa(parted_msa, threads);
+
+    EXPECT_EQ(IndexPairList({{0, 3}}), scan.dup_taxa);
+    EXPECT_EQ(IndexPairList({{0, 2}, {0, 4}, {1, 5}}), scan.dup_seqs);
+    EXPECT_TRUE(scan.gap_seqs.empty());
+    ASSERT_EQ(1, scan.gap_cols.size());
+    EXPECT_TRUE(scan.gap_cols[0].empty());
+  }
+}
+
+TEST(MSAScanTest, gaps)
+{
+  // column 3 is undetermined, t4 only in partition p0 and t5 in all partitions
+  auto parted_msa = make_parted_msa({"t1", "t2", "t3", "t4", "t5"},
+                                    {"AC-TA", "AGNTA", "ACNT-", "--?-G", "-----"},
+                                    {"1-4", "5"});
+
+  auto scan = scan_msa(parted_msa, 2);
+
+  ASSERT_EQ(2, scan.gap_cols.size());
+  EXPECT_EQ(vector<size_t>({2}), scan.gap_cols[0]);
+  EXPECT_TRUE(scan.gap_cols[1].empty());
+  EXPECT_EQ(vector<size_t>({4}), scan.gap_seqs);
+  EXPECT_TRUE(scan.dup_seqs.empty());
+}
+
+TEST(MSAScanTest, large)
+{
+  // several blocks of taxa and columns
+  const size_t taxa = 200;
+  const size_t sites = 10000;
+
+  RandomGenerator gen(42);
+  std::uniform_int_distribution<unsigned int> distr(0, 3);
+
+  NameList names;
+  vector<string> seqs;
+  for (size_t i = 0; i < taxa; ++i)
+  {
+    names.push_back("t" + to_string(i));
+    seqs.emplace_back(sites, 'A');
+    for (auto& c: seqs.back())
+      c = "ACGT"[distr(gen)];
+  }
+
+  // duplicates across taxon blocks
+  seqs[150] = seqs[3];
+  seqs[199] = seqs[70];
+  names[130] = names[5];
+
+  // gap-only sequence
+  seqs[100] = string(sites, '-');
+
+  // undetermined columns: one in each partition, and one only determined in taxon 198
+  for (size_t i = 0; i < taxa; ++i)
+  {
+    seqs[i][17] = seqs[i][9000] = 'N';
+    if (i != 198)
+      seqs[i][5000] = '-';
+  }
+
+  auto parted_msa = make_parted_msa(names, seqs, {"1-6000", "6001-10000"});
+
+  for (size_t threads: {1, 4})
+  {
+    auto scan = scan_msa(parted_msa, threads);
+
+    EXPECT_EQ(IndexPairList({{5, 130}}), scan.dup_taxa);
+    EXPECT_EQ(IndexPairList({{3, 150}, {70, 199}}), scan.dup_seqs);
+    EXPECT_EQ(vector<size_t>({100}), scan.gap_seqs);
+    ASSERT_EQ(2, scan.gap_cols.size());
+    EXPECT_EQ(vector<size_t>({17}), scan.gap_cols[0]);
+    EXPECT_EQ(vector<size_t>({3000}), scan.gap_cols[1]);
+  }
+}
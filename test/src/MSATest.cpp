@@ -0,0 +1,55 @@
+#include "RaxmlTest.hpp"
+
+#include "src/MSA.hpp"
+
+using namespace std;
+
+static MSA prob_msa(const vector<string>& seqs, const vector<ProbVector>& probs)
+{
+  MSA msa;
+  for (size_t j = 0; j < seqs.size(); ++j)
+    msa.append(seqs[j], "t" + to_string(j));
+
+  msa.states(2);
+  for (size_t j = 0; j < seqs.size(); ++j)
+    std::copy(probs[j].cbegin(), probs[j].cend(), msa.probs(j, 0));
+
+  return msa;
+}
+
+TEST(MSATest, compress_prob_patterns)
+{
+  // sites 0, 2 and 3 are identical, site 1 differs only in probabilities
+  auto msa = prob_msa({"AAAA", "CCCC"},
+                      {{1., 0., 1., 0., 1., 0., 1., 0.},
+                       {.2, .8, .3, .7, .2, .8, .2, .8}});
+
+  msa.compress_patterns(nullptr);
+
+  ASSERT_EQ(2, msa.length());
+  EXPECT_EQ(WeightVector({3, 1}), msa.weights());
+  EXPECT_EQ("AA", msa.at(0));
+  EXPECT_EQ("CC", msa.at(1));
+  EXPECT_EQ(ProbVector({.2, .8, .3, .7}), msa.probs(1));
+
+  // frequencies are computed over all sites, not patterns
+  auto freqs = msa.state_freqs();
+  EXPECT_DOUBLE_EQ((4. + .9) / 8., freqs[0]);
+}
+
+TEST(MSATest, round_probs)
+{
+  auto msa = prob_msa({"AAA", "CCC"},
+                      {{.5, .5, .5004, .4996, .51, .49},
+                       {1., 0., 1., 0., 1., 0.}});
+
+  msa.round_probs(2);
+  msa.compress_patterns(nullptr);
+
+  ASSERT_EQ(2, msa.length());
+  EXPECT_EQ(WeightVector({2, 1}), msa.weights());
+  EXPECT_EQ(.51, msa.probs(0)[2]);
+
+  msa.states(0);
+  EXPECT_FALSE(msa.probabilistic());
+}
@@ -0,0 +1,78 @@
+#include "RaxmlTest.hpp"
+
+#include "src/MemoryBudget.hpp"
+
+using namespace std;
+
+TEST(MemoryBudgetTest, accounting)
+{
+  MemoryBudget::reset();
+  MemoryBudget::limit(0);
+
+  MemoryUsage usage;
+  usage[MemCategory::clv] = 1000;
+  usage[MemCategory::pmatrix] = 24;
+  EXPECT_EQ(1024, usage.total());
+
+  MemoryBudget::allocate(usage);
+  MemoryBudget::allocate(MemCategory::msa, 500);
+  EXPECT_EQ(1000, MemoryBudget::used()[MemCategory::clv]);
+  EXPECT_EQ(500, MemoryBudget::used()[MemCategory::msa]);
+  EXPECT_EQ(1524, MemoryBudget::used().total());
+
+  MemoryBudget::release(usage);
+  EXPECT_EQ(500, MemoryBudget::used().total());
+  EXPECT_EQ(0, MemoryBudget::used()[MemCategory::clv]);
+
+  // high-water mark is retained after release
+  EXPECT_EQ(1524, MemoryBudget::peak());
+
+  MemoryBudget::release(MemCategory::msa, 500);
+  EXPECT_EQ(0, MemoryBudget::used().total());
+}
+
+TEST(MemoryBudgetTest, limit)
+{
+  MemoryBudget::reset();
+  MemoryBudget::limit(1000);
+
+  MemoryBudget::allocate(MemCategory::trees, 600);
+  EXPECT_TRUE(MemoryBudget::fits(400));
+  EXPECT_FALSE(MemoryBudget::fits(401));
+
+  EXPECT_THROW(MemoryBudget::allocate(MemCategory::clv, 401), MemoryBudgetException);
+
+  // failed allocation must not be accounted for
+  EXPECT_EQ(600, MemoryBudget::used().total());
+  EXPECT_EQ(600, MemoryBudget::peak());
+
+  MemoryBudget::allocate(MemCategory::clv, 400);
+  EXPECT_EQ(1000, MemoryBudget::used().total());
+
+  MemoryBudget::limit(0);
+  MemoryBudget::reset();
+}
+
+TEST(MemoryBudgetTest, partition_size)
+{
+  // 10 taxa, 1000 sites, DNA+G4, AVX
+  const size_t tips = 10, inner = 8, branches = 17, sites = 1000, rates = 4;
+  const unsigned int attrs = PLL_ATTRIB_ARCH_AVX;
+
+  auto usage = pll_partition_mem_size(tips, inner, 4, sites, branches, rates, inner, attrs);
+  const size_t clv_size = sites * rates * 4 * sizeof(double);
+  EXPECT_EQ(inner * clv_size + inner * sites * sizeof(unsigned int), usage[MemCategory::clv]);
+  EXPECT_EQ(tips * clv_size, usage[MemCategory::tipbuf]);
+  EXPECT_EQ(branches * rates * 4 * 4 * sizeof(double), usage[MemCategory::pmatrix]);
+
+  // tip-inner: tip CLVs are replaced by 1 byte per character
+  auto usage_ti = pll_partition_mem_size(tips, inner, 4, sites, branches, rates, inner,
+                                         attrs | PLL_ATTRIB_PATTERN_TIP);
+  EXPECT_LT(usage_ti[MemCategory::tipbuf], usage[MemCategory::tipbuf]);
+  EXPECT_EQ(usage[MemCategory::clv], usage_ti[MemCategory::clv]);
+
+  // site repeats: additional site->repeat maps
+  auto usage_rep = pll_partition_mem_size(tips, inner, 4, sites, branches, rates, inner,
+                                          attrs | PLL_ATTRIB_SITE_REPEATS);
+  EXPECT_GT(usage_rep[MemCategory::clv], usage[MemCategory::clv]);
+}
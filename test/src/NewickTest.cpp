@@ -0,0 +1,196 @@
+#include "RaxmlTest.hpp"
+
+#include <chrono>
+#include <random>
+
+#include "src/io/file_io.hpp"
+#include "src/io/ParallelNewickReader.hpp"
+
+using namespace std;
+
+static string parse_and_write(const string& newick, unsigned int precision = 6)
+{
+  NewickParser parser;
+  NewickWriter writer;
+
+  PllUTreeUniquePtr utree(parser.parse(newick.c_str(), newick.size()));
+
+  return writer.write(*utree->vroot, precision);
+}
+
+static string random_newick(size_t num_tips, unsigned int seed)
+{
+  mt19937 rng(seed);
+  uniform_real_distribution<double> brlen(0., 0.5);
+
+  NameList subtrees;
+  for (size_t i = 0; i < num_tips; ++i)
+    subtrees.push_back("taxon" + to_string(i) + ":" + to_string(brlen(rng)));
+
+  while (subtrees.size() > 3)
+  {
+    auto a = subtrees.begin() + rng() % subtrees.size();
+    string left = *a;
+    subtrees.erase(a);
+    auto b = subtrees.begin() + rng() % subtrees.size();
+    string right = *b;
+    subtrees.erase(b);
+    subtrees.push_back("(" + left + "," + right + "):" + to_string(brlen(rng)));
+  }
+
+  return "(" + subtrees[0] + "," + subtrees[1] + "," + subtrees[2] + ");";
+}
+
+TEST(NewickTest, unrooted)
+{
+  EXPECT_EQ(parse_and_write("(A:0.1,B:0.2,(C:0.3,D:0.4)0.95:0.5);"),
+            "(A:0.100000,B:0.200000,(C:0.300000,D:0.400000)0.95:0.500000);");
+  EXPECT_EQ(parse_and_write("(A,B,(C,D));", 2),
+            "(A:0.00,B:0.00,(C:0.00,D:0.00):0.00);");
+}
+
+TEST(NewickTest, rooted)
+{
+  // root node is removed and its branches are merged
+  EXPECT_EQ(parse_and_write("((A:0.1,B:0.2):0.05,(C:0.3,D:0.4):0.5);"),
+            "((C:0.300000,D:0.400000):0.550000,A:0.100000,B:0.200000);");
+  EXPECT_EQ(parse_and_write("(A:1,(B:1,(C:1,D:1):1):1);", 1),
+            "(A:2.0,B:1.0,(C:1.0,D:1.0):1.0);");
+}
+
+TEST(NewickTest, multifurcating)
+{
+  NewickParser parser;
+  const string newick = "(A,B,C,(D,E,F));";
+  PllUTreeUniquePtr utree(parser.parse(newick.c_str(), newick.size()));
+
+  EXPECT_EQ(utree->tip_count, 6);
+  EXPECT_EQ(utree->inner_count, 2);
+  EXPECT_FALSE(utree->binary);
+}
+
+TEST(NewickTest, labels_and_lengths)
+{
+  EXPECT_EQ(parse_and_write("('x y''z':1e-3, B:2.5E2 ,C:-4e-7,[comment]D:12345.6789012345)lab:0;"),
+            "('x y''z':0.001000,B:250.000000,C:-0.000000,D:12345.678901)lab;");
+}
+
+TEST(NewickTest, quoted_labels)
+{
+  const string fname = "quoted_labels_test.nw";
+  const NameList labels = {"a b", "it's", "x:y", "p,q", "(r)", "s;t", "plain"};
+
+  string newick = "(";
+  for (size_t i = 0; i < labels.size(); ++i)
+  {
+    string quoted = "'";
+    for (auto c: labels[i])
+      quoted += (c == '\'') ? string("''") : string(1, c);
+    newick += (i ? "," : "") + quoted + "'";
+  }
+  newick += ");";
+
+  // writer must quote labels, so that they are parsed back unchanged
+  const auto written = parse_and_write(newick);
+  EXPECT_EQ(written, parse_and_write(written));
+
+  NewickParser parser;
+  PllUTreeUniquePtr utree(parser.parse(written.c_str(), written.size()));
+  for (size_t i = 0; i < labels.size(); ++i)
+    EXPECT_EQ(labels[i], utree->nodes[i]->label);
+
+  // NewickStream must not split trees at ';' inside quoted labels
+  {
+    ofstream fs(fname);
+    fs << written << endl << written << endl;
+  }
+  NewickStream ns(fname, std::ios::in);
+  for (size_t t = 0; t < 2; ++t)
+  {
+    Tree tree;
+    ns >> tree;
+    EXPECT_EQ(NewickWriter().write(tree.pll_utree_root(), 6), written);
+  }
+
+  remove(fname.c_str());
+}
+
+TEST(NewickTest, errors)
+{
+  EXPECT_THROW(parse_and_write("(A,B,C"), runtime_error);
+  EXPECT_THROW(parse_and_write("(A,B,C));"), runtime_error);
+  EXPECT_THROW(parse_and_write("(A,B,(C,D):x);"), runtime_error);
+  EXPECT_THROW(parse_and_write("(A,B,(C,));"), runtime_error);
+  EXPECT_THROW(parse_and_write("(A,(B));"), runtime_error);
+  EXPECT_THROW(parse_and_write("(A,B);"), runtime_error);
+}
+
+TEST(NewickTest, throughput)
+{
+  const size_t num_tips = 5000;
+  const size_t num_trees = 20;
+  const string newick = random_newick(num_tips, 42);
+
+  NewickParser parser;
+  NewickWriter writer;
+  PllUTreeUniquePtr utree(parser.parse(newick.c_str(), newick.size()));
+  const auto ref_str = writer.write(*utree->vroot, 6);
+
+  auto start = chrono::steady_clock::now();
+  size_t bytes = 0;
+  for (size_t i = 0; i < num_trees; ++i)
+    bytes += writer.write(*utree->vroot, 6).size();
+  auto write_sec = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+  start = chrono::steady_clock::now();
+  for (size_t i = 0; i < num_trees; ++i)
+    utree.reset(parser.parse(ref_str.c_str(), ref_str.size()));
+  auto parse_sec = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+  EXPECT_EQ(writer.write(*utree->vroot, 6), ref_str);
+
+  cout << "[ BENCH    ] Newick write: " << num_trees / write_sec << " trees/s, "
+       << bytes / write_sec / 1e6 << " MB/s" << endl;
+  cout << "[ BENCH    ] Newick parse: " << num_trees / parse_sec << " trees/s, "
+       << bytes / parse_sec / 1e6 << " MB/s" << endl;
+}
+
+TEST(NewickTest, parallel_reader)
+{
+  const size_t num_trees = 200;
+  const string fname = "parallel_reader_test.nw";
+
+  NameList newicks;
+  {
+    ofstream fs(fname);
+    for (size_t i = 0; i < num_trees; ++i)
+    {
+      newicks.push_back(random_newick(50, i));
+      fs << newicks.back() << endl;
+    }
+  }
+
+  for (size_t num_workers: {1, 4})
+  {
+    NewickWriter writer;
+    size_t next = 0;
+    ParallelNewickReader reader(fname, num_workers);
+    auto count = reader.read(nullptr, [&](size_t index, const Tree& tree)
+        {
+          EXPECT_EQ(index, next++);
+          EXPECT_EQ(writer.write(tree.pll_utree_root(), 6), parse_and_write(newicks[index]));
+        });
+    EXPECT_EQ(count, num_trees);
+
+    auto prepare_cb = [](size_t index, Tree&)
+        {
+          if (index == 100)
+            throw runtime_error("bad tree");
+        };
+    next = 0;
+    EXPECT_THROW(reader.read(prepare_cb, [&](size_t, const Tree&) { next++; }), runtime_error);
+    EXPECT_EQ(next, 100);
+  }
+
+  remove(fname.c_str());
+}
@@ -0,0 +1,91 @@
+#include "RaxmlTest.hpp"
+
+#include "src/Optimizer.hpp"
+#include "src/autotune/KernelBenchmark.hpp"
+#include "src/bootstrap/SplitSet.hpp"
+
+using namespace std;
+
+/* gappy partitions with unlinked branch lengths -> non-trivial terraces */
+static void gappy_msa(PartitionedMSA& parted_msa)
+{
+  const size_t num_taxa = 16;
+  const size_t part_sites = 300;
+  const size_t part_count = 3;
+
+  auto msa = random_msa(num_taxa, part_count * part_sites, 4, 0., 7);
+
+  /* partition p: taxa [4*p, 4*p+4) have no data */
+  for (size_t p = 0; p < part_count; ++p)
+  {
+    for (size_t t = 4 * p; t < 4 * p + 4; ++t)
+      msa[t].replace(p * part_sites, part_sites, part_sites, '-');
+
+    const auto start = p * part_sites + 1;
+    parted_msa.emplace_part_info("p" + to_string(p+1), DataType::autodetect, "GTR+G",
+                                 to_string(start) + "-" + to_string(start + part_sites - 1));
+  }
+
+  parted_msa.full_msa(std::move(msa));
+  parted_msa.split_msa();
+  parted_msa.compress_patterns();
+  parted_msa.set_model_empirical_params();
+}
+
+static double search(const Options& opts, const PartitionedMSA& parted_msa, const Tree& start_tree,
+                     const TerraceSignature * terrace_sig, Tree& result, size_t& terrace_skips)
+{
+  PartitionAssignment part_assign;
+  for (size_t p = 0; p < parted_msa.part_count(); ++p)
+  {
+    const auto& pinfo = parted_msa.part_info(p);
+    part_assign.assign_sites(p, 0, pinfo.msa().length(), pinfo.model().clv_entry_size());
+  }
+
+  CheckpointManager cm("");
+  cm.disable();
+
+  TreeInfo treeinfo(opts, start_tree, parted_msa, IDVector(), part_assign);
+  Optimizer optimizer(opts);
+  optimizer.terrace_signature(terrace_sig);
+
+  const double loglh = optimizer.optimize_topology(treeinfo, cm);
+  result = treeinfo.tree();
+  terrace_skips = optimizer.terrace_skips();
+
+  return loglh;
+}
+
+TEST(OptimizerTest, terrace_aware_search)
+{
+  PartitionedMSA parted_msa;
+  gappy_msa(parted_msa);
+
+  Options opts;
+  opts.simd_arch = sysutil_simd_autodetect();
+  opts.brlen_linkage = PLLMOD_COMMON_BRLEN_UNLINKED;
+
+  TerraceSignature terrace_sig(parted_msa, IDVector());
+  ASSERT_TRUE(terrace_sig.informative());
+
+  for (unsigned int seed = 1; seed <= 3; ++seed)
+  {
+    Tree start_tree = Tree::buildRandom(parted_msa.taxon_names(), seed);
+    start_tree.reset_tip_ids(parted_msa.taxon_index());
+    start_tree.fix_missing_brlens();
+
+    Tree tree, terrace_tree;
+    size_t skips, terrace_skips;
+    const double loglh = search(opts, parted_msa, start_tree, nullptr, tree, skips);
+    const double terrace_loglh = search(opts, parted_msa, start_tree, &terrace_sig,
+                                        terrace_tree, terrace_skips);
+
+    EXPECT_EQ(0, skips);
+    RecordProperty("terrace_skips_" + to_string(seed), (int) terrace_skips);
+
+    // shortcut must not change the search result
+    EXPECT_NEAR(loglh, terrace_loglh, opts.lh_epsilon);
+    EXPECT_EQ(terrace_sig.hash(tree), terrace_sig.hash(terrace_tree));
+    EXPECT_TRUE(SplitSet(tree.pll_utree()) == SplitSet(terrace_tree.pll_utree()));
+  }
+}
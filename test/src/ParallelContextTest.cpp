@@ -0,0 +1,114 @@
+#include "RaxmlTest.hpp"
+
+#include "src/ParallelContext.hpp"
+
+using namespace std;
+
+#ifdef _RAXML_PTHREADS
+
+TEST(ParallelContextTest, independent_thread_groups)
+{
+  const size_t num_groups = 2;
+  const size_t group_threads = 3;
+  const size_t num_iters = 100;
+
+  vector<unique_ptr<ParallelContext>> contexts;
+  for (size_t g = 0; g < num_groups; ++g)
+    contexts.emplace_back(new ParallelContext(group_threads));
+
+  vector<double> sums(num_groups * group_threads, 0.);
+  vector<size_t> bcast(num_groups * group_threads, 0);
+  vector<size_t> procs(num_groups * group_threads, 0);
+  atomic<size_t> masters(0);
+
+  auto thread_main = [&](size_t g, size_t t)
+    {
+      ParallelContext::ThreadScope scope(*contexts[g], t);
+
+      procs[g * group_threads + t] = ParallelContext::num_procs();
+      if (ParallelContext::master())
+        masters++;
+
+      for (size_t i = 0; i < num_iters; ++i)
+      {
+        // groups do a different number of barriers per iteration -> must not interfere
+        for (size_t k = 0; k < g; ++k)
+          ParallelContext::thread_barrier();
+
+        double val[2] = { (double) (g + 1), (double) t };
+        ParallelContext::parallel_reduce_cb(&ParallelContext::current(), val, 2,
+                                            PLLMOD_COMMON_REDUCE_SUM);
+        sums[g * group_threads + t] += val[0] + val[1];
+
+        size_t x = ParallelContext::master_thread() ? g * num_iters + i : 0;
+        ParallelContext::thread_broadcast(0, &x, sizeof(size_t));
+        if (x == g * num_iters + i)
+          bcast[g * group_threads + t]++;
+      }
+    };
+
+  vector<thread> threads;
+  for (size_t g = 0; g < num_groups; ++g)
+    for (size_t t = 0; t < group_threads; ++t)
+      threads.emplace_back(thread_main, g, t);
+
+  for (auto& t: threads)
+    t.join();
+
+  const double tsum = group_threads * (group_threads - 1) / 2;
+  for (size_t g = 0; g < num_groups; ++g)
+  {
+    for (size_t t = 0; t < group_threads; ++t)
+    {
+      EXPECT_EQ(group_threads, procs[g * group_threads + t]);
+      EXPECT_DOUBLE_EQ(num_iters * ((g + 1) * group_threads + tsum), sums[g * group_threads + t]);
+      EXPECT_EQ(num_iters, bcast[g * group_threads + t]);
+    }
+  }
+
+  // scoped threads never pass for the I/O master, even as thread 0 of their group
+  EXPECT_EQ(0, masters.load());
+  EXPECT_TRUE(ParallelContext::master());
+
+  // binding is restored after leaving the scope
+  EXPECT_EQ(&ParallelContext::world(), &ParallelContext::current());
+}
+
+TEST(ParallelContextTest, sleep_barrier)
+{
+  const size_t num_threads = 4;
+  const size_t num_iters = 50;
+
+  ParallelContext ctx(num_threads);
+  atomic<size_t> counter(0);
+  vector<size_t> errors(num_threads, 0);
+
+  auto thread_main = [&](size_t t)
+    {
+      ParallelContext::ThreadScope scope(ctx, t);
+
+      for (size_t i = 0; i < num_iters; ++i)
+      {
+        counter++;
+        ParallelContext::thread_sleep_barrier();
+
+        // all threads have arrived
+        if (counter.load() != (i + 1) * num_threads)
+          errors[t]++;
+        ParallelContext::thread_sleep_barrier();
+      }
+    };
+
+  vector<thread> threads;
+  for (size_t t = 0; t < num_threads; ++t)
+    threads.emplace_back(thread_main, t);
+
+  for (auto& t: threads)
+    t.join();
+
+  EXPECT_EQ(num_iters * num_threads, counter.load());
+  for (auto e: errors)
+    EXPECT_EQ(0, e);
+}
+
+#endif
@@ -0,0 +1,39 @@
+#include "RaxmlTest.hpp"
+
+#include "src/PartitionedMSA.hpp"
+
+using namespace std;
+
+TEST(PartitionedMSATest, split_probs)
+{
+  MSA msa;
+  msa.append("ACGTA", "t1");
+  msa.append("CGTAC", "t2");
+  msa.states(4);
+  for (size_t j = 0; j < msa.size(); ++j)
+  {
+    // probability of state 0 encodes taxon and site
+    for (size_t i = 0; i < msa.length(); ++i)
+      *msa.probs(j, i) = 10. * j + i;
+  }
+
+  PartitionedMSA parted_msa;
+  parted_msa.emplace_part_info("p1", DataType::dna, "GTR", "1-3/2");
+  parted_msa.emplace_part_info("p2", DataType::dna, "GTR", "2,4-5");
+  parted_msa.full_msa(std::move(msa));
+  parted_msa.split_msa();
+
+  const auto& msa1 = parted_msa.part_info(0).msa();
+  const auto& msa2 = parted_msa.part_info(1).msa();
+
+  ASSERT_EQ(4, msa1.states());
+  ASSERT_EQ(4, msa2.states());
+  EXPECT_EQ("AG", msa1.at(0));
+  EXPECT_EQ("CTA", msa2.at(0));
+  EXPECT_EQ(2 * 4, msa1.probs(1).size());
+
+  EXPECT_EQ(10., *msa1.probs(1, 0));
+  EXPECT_EQ(12., *msa1.probs(1, 1));
+  EXPECT_EQ(1., *msa2.probs(0, 0));
+  EXPECT_EQ(14., *msa2.probs(1, 2));
+}
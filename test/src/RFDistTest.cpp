@@ -0,0 +1,215 @@
+#include "RaxmlTest.hpp"
+
+#include <chrono>
+#include <map>
+#include <random>
+
+#include "src/io/file_io.hpp"
+#include "src/bootstrap/RFDistCalculator.hpp"
+#include "src/bootstrap/SplitSet.hpp"
+
+using namespace std;
+
+static Tree random_tree(const TaxonIndex& tip_ids, size_t num_tips, unsigned int seed,
+                        bool brlens = true)
+{
+  mt19937 rng(seed);
+  auto brlen = [&rng, brlens]() { return brlens ? ":0." + to_string(1 + rng() % 9) : string(); };
+
+  NameList subtrees;
+  for (size_t i = 0; i < num_tips; ++i)
+    subtrees.push_back("t" + to_string(i) + brlen());
+
+  while (subtrees.size() > 3)
+  {
+    auto a = subtrees.begin() + rng() % subtrees.size();
+    string left = *a;
+    subtrees.erase(a);
+    auto b = subtrees.begin() + rng() % subtrees.size();
+    subtrees.push_back("(" + left + "," + *b + ")" + brlen());
+    subtrees.erase(b);
+  }
+
+  const string newick = "(" + subtrees[0] + "," + subtrees[1] + "," + subtrees[2] + ");";
+
+  NewickParser parser;
+  Tree tree(PllUTreeUniquePtr(parser.parse(newick.c_str(), newick.size())));
+  tree.reset_tip_ids(tip_ids);
+  return tree;
+}
+
+/* reference implementation: split -> branch length maps, terminal branches are keyed
+ * by tip id (they are present in all trees, so they only contribute to WRF) */
+typedef map<vector<SplitWord>, double> SplitLengthMap;
+
+static SplitLengthMap split_lengths(const Tree& tree)
+{
+  const auto topol = tree.topology();
+  SplitSet splits(topol, tree.layout());
+
+  SplitLengthMap result;
+  for (size_t i = 0; i < splits.size(); ++i)
+  {
+    vector<SplitWord> key(splits.split(i), splits.split(i) + splits.split_len());
+    result[key] = topol.edges[splits.edge_index(i)].length;
+  }
+
+  /* terminal branches */
+  const auto layout = tree.layout();
+  for (const auto& edge: topol.edges)
+  {
+    for (auto node: {edge.left_node_id, edge.right_node_id})
+    {
+      if (layout.next[node] == TreeLayout::NONE)
+      {
+        vector<SplitWord> key(splits.split_len() + 1, 0);
+        key.back() = node;
+        result[key] = edge.length;
+      }
+    }
+  }
+
+  return result;
+}
+
+static void naive_distance(const SplitLengthMap& a, const SplitLengthMap& b,
+                           unsigned int& rf, double& wrf)
+{
+  rf = 0;
+  wrf = 0.;
+  for (const auto& s: a)
+  {
+    auto it = b.find(s.first);
+    if (it == b.end())
+    {
+      rf++;
+      wrf += s.second;
+    }
+    else
+      wrf += fabs(s.second - it->second);
+  }
+  for (const auto& s: b)
+  {
+    if (!a.count(s.first))
+    {
+      rf++;
+      wrf += s.second;
+    }
+  }
+}
+
+static void check_all_pairs(const vector<Tree>& trees, bool dense)
+{
+  RFDistCalculator rfcalc;
+  vector<SplitLengthMap> ref_splits;
+  for (const auto& tree: trees)
+  {
+    rfcalc.add_tree(tree);
+    ref_splits.push_back(split_lengths(tree));
+  }
+
+  const size_t num_trees = trees.size();
+  vector<unsigned int> rf(num_trees * num_trees, 0);
+  vector<double> wrf(num_trees * num_trees, 0.);
+  size_t last_i = 0, last_j = 0, num_pairs = 0;
+
+  // single pair queries before packing (sorted split lists)
+  EXPECT_EQ(rfcalc.rf(0, 1), rfcalc.rf(1, 0));
+  EXPECT_EQ(rfcalc.rf(0, 0), 0);
+
+  rfcalc.all_pairs(4, [&](size_t i, size_t j, unsigned int d, double wd)
+      {
+        EXPECT_LT(i, j);
+        EXPECT_TRUE(i > last_i || (i == last_i && j > last_j) || !num_pairs);
+        last_i = i;
+        last_j = j;
+        num_pairs++;
+        rf[i * num_trees + j] = d;
+        wrf[i * num_trees + j] = wd;
+      });
+
+  EXPECT_EQ(rfcalc.dense(), dense);
+  EXPECT_EQ(num_pairs, num_trees * (num_trees - 1) / 2);
+
+  size_t errors = 0;
+  for (size_t i = 0; i < num_trees; ++i)
+  {
+    for (size_t j = i + 1; j < num_trees; ++j)
+    {
+      unsigned int ref_rf;
+      double ref_wrf;
+      naive_distance(ref_splits[i], ref_splits[j], ref_rf, ref_wrf);
+      errors += (rf[i * num_trees + j] != ref_rf);
+      errors += (fabs(wrf[i * num_trees + j] - ref_wrf) > 1e-9);
+      errors += (rfcalc.rf(i, j) != ref_rf);
+    }
+  }
+  EXPECT_EQ(errors, 0);
+}
+
+TEST(RFDistTest, dense)
+{
+  const size_t num_tips = 40;
+  NameList taxa;
+  for (size_t i = 0; i < num_tips; ++i)
+    taxa.push_back("t" + to_string(i));
+  TaxonIndex tip_ids(taxa);
+
+  // few distinct topologies -> packed bit vectors
+  vector<Tree> trees;
+  for (size_t i = 0; i < 150; ++i)
+    trees.push_back(random_tree(tip_ids, num_tips, i % 20));
+
+  check_all_pairs(trees, true);
+}
+
+TEST(RFDistTest, sparse)
+{
+  const size_t num_tips = 20;
+  NameList taxa;
+  for (size_t i = 0; i < num_tips; ++i)
+    taxa.push_back("t" + to_string(i));
+  TaxonIndex tip_ids(taxa);
+
+  // many distinct splits -> sorted split id lists
+  vector<Tree> trees;
+  for (size_t i = 0; i < 300; ++i)
+    trees.push_back(random_tree(tip_ids, num_tips, i));
+
+  check_all_pairs(trees, false);
+}
+
+TEST(RFDistTest, throughput)
+{
+  const size_t num_tips = 100;
+  const size_t num_trees = 1000;
+  NameList taxa;
+  for (size_t i = 0; i < num_tips; ++i)
+    taxa.push_back("t" + to_string(i));
+  TaxonIndex tip_ids(taxa);
+
+  for (bool brlens: {false, true})
+  {
+    RFDistCalculator rfcalc;
+    for (size_t i = 0; i < num_trees; ++i)
+      rfcalc.add_tree(random_tree(tip_ids, num_tips, i % 50, brlens));
+
+    EXPECT_EQ(rfcalc.weighted(), brlens);
+
+    double sum_rf = 0., sum_wrf = 0.;
+    auto start = chrono::steady_clock::now();
+    rfcalc.all_pairs(1, [&sum_rf, &sum_wrf](size_t, size_t, unsigned int rf, double wrf)
+        {
+          sum_rf += rf;
+          sum_wrf += wrf;
+        });
+    auto sec = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    EXPECT_GT(sum_rf, 0.);
+    EXPECT_EQ(sum_wrf > 0., brlens);
+
+    cout << "[ BENCH    ] " << (brlens ? "WRF" : "RF") << " distance (" << num_tips << " taxa, "
+         << (rfcalc.dense() ? "packed" : "sorted") << "): "
+         << num_trees * (num_trees - 1) / 2 / sec / 1e6 << " M pairs/s" << endl;
+  }
+}
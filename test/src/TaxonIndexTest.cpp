@@ -0,0 +1,56 @@
+#include "RaxmlTest.hpp"
+
+#include <chrono>
+
+#include "src/TaxonIndex.hpp"
+
+using namespace std;
+
+TEST(TaxonIndexTest, basic)
+{
+  TaxonIndex empty_index;
+  EXPECT_TRUE(empty_index.empty());
+  EXPECT_EQ(empty_index.find("A"), TaxonIndex::npos);
+
+  TaxonIndex index(NameList{"A", "B", "long_taxon_name_12345", "", "A"});
+
+  // duplicates: last occurrence wins
+  EXPECT_EQ(index.size(), 4);
+  EXPECT_EQ(index.at("A"), 4);
+  EXPECT_EQ(index.at("B"), 1);
+  EXPECT_EQ(index.at("long_taxon_name_12345"), 2);
+  EXPECT_EQ(index.at(""), 3);
+  EXPECT_EQ(index.count("B"), 1);
+  EXPECT_EQ(index.count("C"), 0);
+  EXPECT_EQ(index.find("long_taxon_name_1234"), TaxonIndex::npos);
+  EXPECT_THROW(index.at("C"), out_of_range);
+
+  TaxonIndex id_index(IdNameVector{{7, "X"}, {3, "Y"}});
+  EXPECT_EQ(id_index.at("X"), 7);
+  EXPECT_EQ(id_index.at("Y"), 3);
+}
+
+TEST(TaxonIndexTest, large)
+{
+  const size_t num_taxa = 100000;
+
+  NameList names;
+  for (size_t i = 0; i < num_taxa; ++i)
+    names.push_back("taxon_" + to_string(i * 7919));
+
+  auto start = chrono::steady_clock::now();
+  TaxonIndex index(names);
+  auto build_sec = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+  start = chrono::steady_clock::now();
+  size_t errors = 0;
+  for (size_t i = 0; i < num_taxa; ++i)
+    errors += (index.find(names[i]) != i);
+  auto lookup_sec = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+  EXPECT_EQ(errors, 0);
+  EXPECT_EQ(index.find("taxon_1"), TaxonIndex::npos);
+
+  cout << "[ BENCH    ] TaxonIndex build: " << build_sec * 1e3 << " ms, lookup: "
+       << lookup_sec * 1e9 / num_taxa << " ns/taxon" << endl;
+}
@@ -0,0 +1,64 @@
+#include "RaxmlTest.hpp"
+
+#include "src/Tracer.hpp"
+
+using namespace std;
+
+TEST(TracerTest, ring_buffer)
+{
+  Tracer::enable(1, 4);
+
+  const char * names[] = {"e0", "e1", "e2", "e3", "e4", "e5"};
+  for (size_t i = 0; i < 6; ++i)
+    Tracer::record(names[i], i, i + 0.5);
+
+  // oldest events are overwritten once the buffer is full
+  auto events = Tracer::events(0);
+  ASSERT_EQ(4, events.size());
+  EXPECT_EQ(2, Tracer::dropped(0));
+  for (size_t i = 0; i < 4; ++i)
+  {
+    EXPECT_STREQ(names[i + 2], events[i].name);
+    EXPECT_DOUBLE_EQ(i + 2., events[i].start);
+    EXPECT_DOUBLE_EQ(0.5, events[i].duration);
+  }
+
+  Tracer::disable();
+  EXPECT_TRUE(Tracer::events(0).empty());
+}
+
+TEST(TracerTest, span)
+{
+  {
+    RAXML_TRACE_SPAN("disabled");
+  }
+
+  Tracer::enable(1, 16);
+  {
+    RAXML_TRACE_SPAN("outer");
+    {
+      RAXML_TRACE_SPAN("inner");
+    }
+  }
+
+  // spans are recorded when they end, so the inner one comes first
+  auto events = Tracer::events(0);
+  ASSERT_EQ(2, events.size());
+  EXPECT_STREQ("inner", events[0].name);
+  EXPECT_STREQ("outer", events[1].name);
+  EXPECT_LE(events[1].start, events[0].start);
+  EXPECT_GE(events[1].duration, events[0].duration);
+
+  auto json = Tracer::serialize(3);
+  EXPECT_NE(string::npos, json.find("\"name\":\"outer\",\"ph\":\"X\",\"pid\":3,\"tid\":0"));
+  EXPECT_EQ(string::npos, json.find("disabled"));
+
+  Tracer::disable();
+}
+
+TEST(TracerTest, rank_fname)
+{
+  EXPECT_EQ("run.raxml.trace.json", Tracer::rank_fname("run.raxml.trace.json", 0));
+  EXPECT_EQ("run.raxml.trace.rank2.json", Tracer::rank_fname("run.raxml.trace.json", 2));
+  EXPECT_EQ("trace.rank1.json", Tracer::rank_fname("trace", 1));
+}
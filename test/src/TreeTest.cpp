@@ -0,0 +1,286 @@
+#include "RaxmlTest.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <set>
+
+#include "src/io/file_io.hpp"
+#include "src/bootstrap/SplitSet.hpp"
+#include "src/TerraceSignature.hpp"
+
+using namespace std;
+
+static Tree random_tree(size_t num_tips, unsigned int seed)
+{
+  mt19937 rng(seed);
+
+  NameList subtrees;
+  for (size_t i = 0; i < num_tips; ++i)
+    subtrees.push_back("t" + to_string(i) + ":0.1");
+
+  while (subtrees.size() > 3)
+  {
+    auto a = subtrees.begin() + rng() % subtrees.size();
+    string left = *a;
+    subtrees.erase(a);
+    auto b = subtrees.begin() + rng() % subtrees.size();
+    subtrees.push_back("(" + left + "," + *b + "):0.2");
+    subtrees.erase(b);
+  }
+
+  const string newick = "(" + subtrees[0] + "," + subtrees[1] + "," + subtrees[2] + ");";
+
+  NewickParser parser;
+  return Tree(PllUTreeUniquePtr(parser.parse(newick.c_str(), newick.size())));
+}
+
+static string to_newick(const Tree& tree)
+{
+  NewickWriter writer;
+  return writer.write(tree.pll_utree_root(), 6);
+}
+
+TEST(TreeTest, contiguous_copy)
+{
+  Tree tree = random_tree(100, 1);
+  EXPECT_FALSE(tree.contiguous());
+
+  // libpll tree -> contiguous block
+  Tree copy1(tree);
+  EXPECT_TRUE(copy1.contiguous());
+  EXPECT_EQ(to_newick(copy1), to_newick(tree));
+  EXPECT_EQ(copy1.num_branches(), tree.num_branches());
+
+  // contiguous block -> contiguous block
+  Tree copy2 = copy1;
+  EXPECT_TRUE(copy2.contiguous());
+  EXPECT_EQ(to_newick(copy2), to_newick(tree));
+
+  // copies are independent
+  copy1.reset_brlens(1.0);
+  EXPECT_EQ(to_newick(copy2), to_newick(tree));
+  EXPECT_NE(to_newick(copy1), to_newick(tree));
+
+  // topology can be transferred between copies
+  NameList taxa;
+  for (size_t i = 0; i < 100; ++i)
+    taxa.push_back("t" + to_string(i));
+  TaxonIndex tip_ids(taxa);
+
+  Tree other = random_tree(100, 2);
+  other.reset_tip_ids(tip_ids);
+  Tree copy3(tree);
+  copy3.reset_tip_ids(tip_ids);
+  copy3.topology(other.topology());
+
+  const auto topol = copy3.topology();
+  const auto other_topol = other.topology();
+  ASSERT_EQ(topol.edges.size(), other_topol.edges.size());
+  for (size_t i = 0; i < topol.edges.size(); ++i)
+  {
+    EXPECT_EQ(topol.edges[i].left_node_id, other_topol.edges[i].left_node_id);
+    EXPECT_EQ(topol.edges[i].right_node_id, other_topol.edges[i].right_node_id);
+  }
+
+  Tree moved(std::move(copy2));
+  EXPECT_TRUE(moved.contiguous());
+  EXPECT_EQ(to_newick(moved), to_newick(tree));
+}
+
+static vector<vector<SplitWord>> sorted_splits(const SplitSet& splits)
+{
+  vector<vector<SplitWord>> result;
+  for (size_t i = 0; i < splits.size(); ++i)
+    result.emplace_back(splits.split(i), splits.split(i) + splits.split_len());
+  sort(result.begin(), result.end());
+  return result;
+}
+
+TEST(TreeTest, topology_consumers)
+{
+  const size_t num_tips = 150;
+
+  NameList taxa;
+  for (size_t i = 0; i < num_tips; ++i)
+    taxa.push_back("t" + to_string(i));
+  TaxonIndex tip_ids(taxa);
+
+  Tree tree = random_tree(num_tips, 7);
+  tree.reset_tip_ids(tip_ids);
+  Tree other = random_tree(num_tips, 8);
+  other.reset_tip_ids(tip_ids);
+
+  const auto layout = tree.layout();
+  EXPECT_EQ(layout.num_tips, num_tips);
+  EXPECT_EQ(layout.num_subnodes(), tree.num_branches() * 2);
+
+  const auto topol = other.topology();
+  Tree materialized(tree);
+  materialized.topology(topol);
+
+  // binary tree: n-3 non-trivial splits
+  SplitSet splits(topol, layout);
+  EXPECT_EQ(splits.size(), num_tips - 3);
+  EXPECT_EQ(splits.split_len(), SplitSet::split_len(num_tips));
+
+  // splits do not depend on the node layout the topology is expressed in
+  SplitSet other_splits(topol, other.layout());
+  EXPECT_EQ(sorted_splits(splits), sorted_splits(other_splits));
+
+  SplitSet own_splits(tree.topology(), layout);
+  EXPECT_NE(sorted_splits(splits), sorted_splits(own_splits));
+
+  // exact comparison, and extraction from the libpll node graph
+  SplitSet graph_splits(materialized.pll_utree());
+  EXPECT_EQ(sorted_splits(graph_splits), sorted_splits(splits));
+  EXPECT_EQ(graph_splits.hash(), splits.hash());
+  EXPECT_TRUE(graph_splits == other_splits);
+  EXPECT_TRUE(splits != own_splits);
+  EXPECT_TRUE(SplitSet(tree.pll_utree()) == own_splits);
+
+  for (size_t i = 0; i < splits.size(); ++i)
+  {
+    EXPECT_EQ(splits.split(i)[0] & 1, 0u);
+    EXPECT_LT(splits.edge_index(i), topol.edges.size());
+  }
+}
+
+TEST(TreeTest, collection_dedup)
+{
+  const size_t num_tips = 50;
+
+  NameList taxa;
+  for (size_t i = 0; i < num_tips; ++i)
+    taxa.push_back("t" + to_string(i));
+  TaxonIndex tip_ids(taxa);
+
+  Tree tree1 = random_tree(num_tips, 11);
+  tree1.reset_tip_ids(tip_ids);
+  Tree tree2 = random_tree(num_tips, 12);
+  tree2.reset_tip_ids(tip_ids);
+
+  // same topology as tree1, but different branch lengths and node layout
+  Tree tree1b(tree2);
+  tree1b.topology(tree1.topology());
+  tree1b.reset_brlens(0.5);
+
+  TreeCollection trees;
+  trees.push_back(-100., tree1);
+  trees.push_back(-200., tree2);
+  trees.push_back(-50., tree1b);
+  trees.push_back(-300., tree1);
+
+  EXPECT_EQ(trees.size(), 4);
+  EXPECT_EQ(trees.num_unique(), 2);
+
+  auto best = trees.best();
+  EXPECT_EQ(best->first, -50.);
+  EXPECT_EQ(trees.multiplicity(best), 3);
+  EXPECT_EQ(trees.multiplicity(best + 1), 1);
+  EXPECT_NE(trees.topology_hash(best), trees.topology_hash(best + 1));
+
+  // best-scoring copy is kept
+  for (const auto& branch: best->second.edges)
+    EXPECT_EQ(branch.length, 0.5);
+
+  trees.clear();
+  EXPECT_EQ(trees.size(), 0);
+  EXPECT_TRUE(trees.empty());
+}
+
+/* reference: per-partition sets of induced non-trivial splits, as sorted taxon lists */
+typedef vector<set<vector<size_t>>> InducedSplits;
+
+static InducedSplits induced_splits(const Tree& tree, const vector<IDVector>& absent_tips)
+{
+  const auto topol = tree.topology();
+  SplitSet splits(topol, tree.layout());
+
+  InducedSplits result(absent_tips.size());
+  for (size_t p = 0; p < absent_tips.size(); ++p)
+  {
+    vector<size_t> taxa;
+    for (size_t t = 0; t < tree.num_tips(); ++t)
+      if (find(absent_tips[p].begin(), absent_tips[p].end(), t) == absent_tips[p].end())
+        taxa.push_back(t);
+
+    for (size_t i = 0; i < splits.size(); ++i)
+    {
+      vector<size_t> side, other;
+      for (auto t: taxa)
+        ((splits.split(i)[t / 64] >> (t % 64)) & 1 ? side : other).push_back(t);
+      if (side.size() >= 2 && other.size() >= 2)
+        result[p].insert(side[0] == taxa[0] ? side : other);
+    }
+  }
+
+  return result;
+}
+
+TEST(TreeTest, terrace_signature)
+{
+  const size_t num_tips = 8;
+
+  NameList taxa;
+  for (size_t i = 0; i < num_tips; ++i)
+    taxa.push_back("t" + to_string(i));
+  TaxonIndex tip_ids(taxa);
+
+  // gappy partitions sharing only few taxa -> many trees per terrace
+  const vector<IDVector> absent_tips = { {0, 1, 2}, {5, 6, 7}, {0, 3, 7} };
+  TerraceSignature sig(num_tips, absent_tips);
+  EXPECT_TRUE(sig.informative());
+  EXPECT_FALSE(TerraceSignature(num_tips, { {0, 1}, {} }).informative());
+  EXPECT_FALSE(TerraceSignature(num_tips, { {0, 1} }).informative());
+
+  vector<Tree> trees;
+  vector<InducedSplits> ref;
+  vector<uint64_t> hashes;
+  for (size_t i = 0; i < 200; ++i)
+  {
+    trees.push_back(random_tree(num_tips, i));
+    trees.back().reset_tip_ids(tip_ids);
+    ref.push_back(induced_splits(trees.back(), absent_tips));
+    hashes.push_back(sig.hash(trees.back()));
+  }
+
+  size_t same_terrace = 0, errors = 0;
+  for (size_t i = 0; i < trees.size(); ++i)
+  {
+    for (size_t j = i + 1; j < trees.size(); ++j)
+    {
+      const bool same = ref[i] == ref[j];
+      same_terrace += same;
+      errors += same != (hashes[i] == hashes[j]);
+    }
+  }
+
+  EXPECT_GT(same_terrace, 0);
+  EXPECT_EQ(errors, 0);
+
+  // hash does not depend on the node layout
+  Tree copy(trees[1]);
+  copy.topology(trees[0].topology());
+  EXPECT_EQ(sig.hash(copy), hashes[0]);
+}
+
+TEST(TreeTest, copy_throughput)
+{
+  const size_t num_copies = 200;
+  Tree tree = random_tree(5000, 42);
+  Tree contig(tree);
+
+  auto start = chrono::steady_clock::now();
+  for (size_t i = 0; i < num_copies; ++i)
+    PllUTreeUniquePtr copy(tree.pll_utree_copy());
+  auto pll_sec = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+  start = chrono::steady_clock::now();
+  for (size_t i = 0; i < num_copies; ++i)
+    Tree copy(contig);
+  auto contig_sec = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+  cout << "[ BENCH    ] Tree copy (5000 taxa): libpll " << num_copies / pll_sec
+       << " trees/s, contiguous " << num_copies / contig_sec << " trees/s" << endl;
+}
@@ -0,0 +1,80 @@
+#include "RaxmlTest.hpp"
+
+#include "src/io/file_io.hpp"
+
+using namespace std;
+
+static const string vcf_fname = "VCFStreamTest.vcf";
+
+static void write_file(const string& fname, const string& text)
+{
+  ofstream fs(fname);
+  fs << text;
+}
+
+static MSA load_vcf(const string& fname)
+{
+  MSA msa;
+  VCFStream s(fname);
+  s >> msa;
+  return msa;
+}
+
+static const string vcf_header =
+    "##fileformat=VCFv4.2\n"
+    "##FORMAT=<ID=GT,Number=1,Type=String,Description=\"Genotype\">\n"
+    "#CHROM\tPOS\tID\tREF\tALT\tQUAL\tFILTER\tINFO\tFORMAT\ts1\ts2\ts3\ts4\n";
+
+TEST(VCFStreamTest, basic)
+{
+  write_file(vcf_fname, vcf_header +
+             "1\t100\t.\tA\tG\t50\tPASS\t.\tGT\t0/0\t0/1\t1|1\t./.\n"
+             "1\t200\t.\tC\tT,A\t50\tPASS\t.\tGT:DP\t0/0:3\t1/2:5\t2/2:1\t0/1:7\n"
+             "1\t300\t.\tA\tG\t50\tPASS\t.\tGT\t0/0\t1/0\t1/1\t.\n"
+             // invariant, indel, all missing
+             "1\t400\t.\tA\tG\t50\tPASS\t.\tGT\t1/1\t1/1\t1/1\t1/1\n"
+             "1\t500\t.\tA\tAT\t50\tPASS\t.\tGT\t0/0\t0/1\t1/1\t0/1\n"
+             "1\t600\t.\tT\tC\t50\tPASS\t.\tGT\t./.\t./.\t./.\t./.\r\n");
+
+  auto msa = load_vcf(vcf_fname);
+
+  ASSERT_EQ(4, msa.size());
+  EXPECT_EQ("s3", msa.label(2));
+
+  // sites 1 and 3 are merged into one pattern
+  ASSERT_EQ(2, msa.length());
+  EXPECT_EQ(3, msa.num_sites());
+  EXPECT_EQ(WeightVector({2, 1}), msa.weights());
+
+  EXPECT_EQ("AC", msa.at(0));
+  EXPECT_EQ("RW", msa.at(1));
+  EXPECT_EQ("GA", msa.at(2));
+  EXPECT_EQ("-Y", msa.at(3));
+
+  // already compressed patterns must keep their weights
+  msa.compress_patterns(nullptr);
+  EXPECT_EQ(2, msa.length());
+  EXPECT_EQ(3, msa.num_sites());
+
+  std::remove(vcf_fname.c_str());
+}
+
+TEST(VCFStreamTest, errors)
+{
+  write_file(vcf_fname, "#CHROM\tPOS\tID\tREF\tALT\tQUAL\tFILTER\tINFO\tFORMAT\ts1\ts2\ts3\ts4\n");
+  EXPECT_THROW(load_vcf(vcf_fname), runtime_error);
+
+  // wrong number of samples
+  write_file(vcf_fname, vcf_header + "1\t100\t.\tA\tG\t50\tPASS\t.\tGT\t0/0\t0/1\t1/1\n");
+  EXPECT_THROW(load_vcf(vcf_fname), runtime_error);
+
+  // allele index out of range
+  write_file(vcf_fname, vcf_header + "1\t100\t.\tA\tG\t50\tPASS\t.\tGT\t0/0\t0/2\t1/1\t0/0\n");
+  EXPECT_THROW(load_vcf(vcf_fname), runtime_error);
+
+  // no variable sites
+  write_file(vcf_fname, vcf_header + "1\t100\t.\tA\tG\t50\tPASS\t.\tGT\t0/0\t0/0\t0/0\t0/0\n");
+  EXPECT_THROW(load_vcf(vcf_fname), runtime_error);
+
+  std::remove(vcf_fname.c_str());
+}